@@ -2,6 +2,45 @@
 
 //#define NUM_POINTS 10000
 
+// Limite de erro relativo do determinante de orientação em double (Shewchuk, ccwerrboundA)
+#define ORIENT_ERRBOUND ((3.0 + 8.0 * DBL_EPSILON) * DBL_EPSILON / 2.0)
+
+/**
+ * @brief Exact sign of the orientation determinant, used when the floating-point filter is inconclusive.
+ *
+ * The determinant is expanded into six products of input coordinates. Each product is split exactly
+ * with fma and the twelve terms are accumulated into a non-overlapping expansion (two_sum), whose
+ * most significant nonzero component has the sign of the exact result.
+ *
+ * @param p First point of the triplet.
+ * @param q Second point of the triplet.
+ * @param r Third point of the triplet.
+ * @return 0 if p, q, and r are colinear, 1 if clockwise, 2 if counterclockwise.
+ */
+int orientation_exact(Point p, Point q, Point r) {
+    double a[6] = {q.y, -p.y, p.y, -q.x, p.x, -p.x};
+    double b[6] = {r.x, r.x, q.x, r.y, r.y, q.y};
+    double e[12];
+    int m = 0;
+
+    for (int k = 0; k < 12; k++) {
+        double product = a[k / 2] * b[k / 2];
+        double term = (k % 2 == 0) ? product : fma(a[k / 2], b[k / 2], -product);
+        for (int i = 0; i < m; i++) {
+            double s = term + e[i];
+            double bv = s - term;
+            e[i] = (term - (s - bv)) + (e[i] - bv);
+            term = s;
+        }
+        e[m++] = term;
+    }
+
+    for (int i = m - 1; i >= 0; i--) {
+        if (e[i] != 0.0) return (e[i] > 0) ? 1 : 2;
+    }
+    return 0;
+}
+
 /**
  * @brief Determines the orientation of an ordered triplet (p, q, r).
  * @param p First point of the triplet.
@@ -10,10 +49,15 @@
  * @return 0 if p, q, and r are colinear, 1 if clockwise, 2 if counterclockwise.
  */
 int orientation(Point p, Point q, Point r) {
-    double val = (q.y - p.y) * (r.x - q.x) - (q.x - p.x) * (r.y - q.y);
-
-    if (val == 0) return 0;
-    return (val > 0)? 1: 2;
+    double left = (q.y - p.y) * (r.x - q.x);
+    double right = (q.x - p.x) * (r.y - q.y);
+    double val = left - right;
+
+    // Filtro: o sinal em double é garantido fora do limite de erro; caso contrário, aritmética exata
+    double bound = ORIENT_ERRBOUND * (fabs(left) + fabs(right));
+    if (val > bound) return 1;
+    if (-val > bound) return 2;
+    return orientation_exact(p, q, r);
 }
 
 /**
@@ -13,6 +13,7 @@
 #include <unistd.h>
 #include <fcntl.h>
 #include <math.h>
+#include <float.h>
 #include <string.h>
 #include <errno.h>
 #include <sys/types.h>
@@ -1,17 +1,115 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdint.h>
 #include <stdbool.h>
 #include <time.h>
 #include <unistd.h>
 #include <fcntl.h>
 #include <math.h>
+#include <float.h>
 #include <sys/wait.h>
+#include <sys/mman.h>
+#include <sys/uio.h>
+#include <sys/stat.h>
+#include <limits.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+#include <pthread.h>
 #include <string.h>
+#include <errno.h>
+
+#define RESULTS_MAGIC 0x5352434dU /* "MCRS" */
+#define SINK_BLOCK (256 * 1024)
+#define SINK_BATCH 64
+
+// Limite de erro relativo do determinante de orientação em double (Shewchuk, ccwerrboundA)
+#define ORIENT_ERRBOUND ((3.0 + 8.0 * DBL_EPSILON) * DBL_EPSILON / 2.0)
 
 typedef struct {
     double x;
     double y;
 } Point;
+
+// Cabeçalho do ficheiro binário de resultados, seguido de um registo por filho
+typedef struct {
+    uint32_t magic;
+    uint32_t num_slots;
+} ResultsHeader;
+
+typedef struct {
+    int32_t pid;
+    int32_t done;
+    int64_t processed;
+    int64_t inside;
+} ResultSlot;
+
+// Anel io_uring mínimo, configurado com as chamadas de sistema diretas
+typedef struct {
+    int fd;
+    void *sq_ptr, *cq_ptr;
+    size_t sq_len, cq_len, sqes_len;
+    unsigned *sq_tail, *sq_mask, *sq_array;
+    unsigned *cq_head, *cq_tail, *cq_mask;
+    struct io_uring_sqe *sqes;
+    struct io_uring_cqe *cqes;
+} Ring;
+
+typedef struct SinkBlock {
+    struct SinkBlock *next;
+    size_t len;
+    char data[SINK_BLOCK];
+} SinkBlock;
+
+// Saída assíncrona de um trabalhador: blocos preenchidos pelo trabalhador, escritos por ordem por uma thread
+typedef struct {
+    int fd;
+    SinkBlock *current;                 // Bloco a ser preenchido pelo trabalhador
+    SinkBlock *queue_head, *queue_tail; // Blocos cheios à espera de escrita, por ordem
+    SinkBlock *free_list;               // Blocos já escritos, para reutilizar
+    bool closing;
+    bool use_ring;
+    bool line_chunks;                   // Destino partilhado que não é ficheiro regular: escritas de até PIPE_BUF
+    Ring ring;
+    pthread_t thread;
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+} OutSink;
+/**
+ * @brief Exact sign of the orientation determinant, used when the floating-point filter is inconclusive.
+ *
+ * The determinant is expanded into six products of input coordinates. Each product is split exactly
+ * with fma and the twelve terms are accumulated into a non-overlapping expansion (two_sum), whose
+ * most significant nonzero component has the sign of the exact result.
+ *
+ * @param p First point of the triplet.
+ * @param q Second point of the triplet.
+ * @param r Third point of the triplet.
+ * @return 0 if p, q, and r are colinear, 1 if clockwise, 2 if counterclockwise.
+ */
+int orientation_exact(Point p, Point q, Point r) {
+    double a[6] = {q.y, -p.y, p.y, -q.x, p.x, -p.x};
+    double b[6] = {r.x, r.x, q.x, r.y, r.y, q.y};
+    double e[12];
+    int m = 0;
+
+    for (int k = 0; k < 12; k++) {
+        double product = a[k / 2] * b[k / 2];
+        double term = (k % 2 == 0) ? product : fma(a[k / 2], b[k / 2], -product);
+        for (int i = 0; i < m; i++) {
+            double s = term + e[i];
+            double bv = s - term;
+            e[i] = (term - (s - bv)) + (e[i] - bv);
+            term = s;
+        }
+        e[m++] = term;
+    }
+
+    for (int i = m - 1; i >= 0; i--) {
+        if (e[i] != 0.0) return (e[i] > 0) ? 1 : 2;
+    }
+    return 0;
+}
+
 /**
  * @brief Determines the orientation of an ordered triplet (p, q, r).
  * @param p First point of the triplet.
@@ -20,9 +118,15 @@ typedef struct {
  * @return 0 if p, q, and r are colinear, 1 if clockwise, 2 if counterclockwise.
  */
 int orientation(Point p, Point q, Point r) {
-    double val = (q.y - p.y) * (r.x - q.x) - (q.x - p.x) * (r.y - q.y);
-    if (val == 0) return 0;
-    return (val > 0)? 1: 2;
+    double left = (q.y - p.y) * (r.x - q.x);
+    double right = (q.x - p.x) * (r.y - q.y);
+    double val = left - right;
+
+    // Filtro: o sinal em double é garantido fora do limite de erro; caso contrário, aritmética exata
+    double bound = ORIENT_ERRBOUND * (fabs(left) + fabs(right));
+    if (val > bound) return 1;
+    if (-val > bound) return 2;
+    return orientation_exact(p, q, r);
 }
 /**
  * @brief Checks if point q lies on line segment pr.
@@ -85,6 +189,338 @@ bool isInsidePolygon(Point polygon[], int n, Point p) {
     return count & 1;
 }
 
+/**
+ * @brief Writes v with six decimal places, rounded exactly like printf("%.6f").
+ *
+ * The product v * 1e6 is split with fma into its rounded value and exact residual, so the
+ * rounding decision is taken on the exact scaled value instead of the rounded product.
+ *
+ * @param out Output buffer (at least 32 bytes).
+ * @param v Value to format.
+ * @return Number of characters written.
+ */
+int format_fixed6(char *out, double v) {
+    if (!(fabs(v) < 1e9)) return sprintf(out, "%.6f", v);
+
+    char *p = out;
+    if (signbit(v)) {
+        *p++ = '-';
+        v = -v;
+    }
+    double scaled = v * 1e6;
+    double residual = fma(v, 1e6, -scaled);
+    double k = floor(scaled);
+    double d = (scaled - k) - 0.5;
+    // Acima de meio (ou exatamente meio com resíduo positivo, ou empate exato com k ímpar): arredonda para cima
+    if (d > 0 || (d == 0 && (residual > 0 || (residual == 0 && fmod(k, 2.0) != 0)))) k += 1;
+
+    unsigned long long q = (unsigned long long) k;
+    unsigned long long integer = q / 1000000, fraction = q % 1000000;
+    char digits[20];
+    int nd = 0;
+    do {
+        digits[nd++] = (char) ('0' + integer % 10);
+        integer /= 10;
+    } while (integer > 0);
+    while (nd > 0) *p++ = digits[--nd];
+    *p++ = '.';
+    for (int i = 5; i >= 0; i--) {
+        p[i] = (char) ('0' + fraction % 10);
+        fraction /= 10;
+    }
+    return (int) (p + 6 - out);
+}
+
+/**
+ * @brief Sets up an io_uring instance through the raw system calls (no liburing).
+ * @param ring Ring to fill.
+ * @param entries Number of submission entries.
+ * @return true on success; false if io_uring is unavailable or lacks current-position writes.
+ */
+bool ring_setup(Ring *ring, unsigned entries) {
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    ring->fd = (int) syscall(__NR_io_uring_setup, entries, &params);
+    if (ring->fd < 0) return false;
+    if (!(params.features & IORING_FEAT_RW_CUR_POS)) {
+        close(ring->fd);
+        return false;
+    }
+
+    ring->sq_len = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    ring->cq_len = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        if (ring->cq_len > ring->sq_len) ring->sq_len = ring->cq_len;
+        ring->cq_len = ring->sq_len;
+    }
+    ring->sqes_len = params.sq_entries * sizeof(struct io_uring_sqe);
+
+    ring->sq_ptr = mmap(NULL, ring->sq_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd,
+                        IORING_OFF_SQ_RING);
+    ring->cq_ptr = (params.features & IORING_FEAT_SINGLE_MMAP) ? ring->sq_ptr :
+                   mmap(NULL, ring->cq_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd,
+                        IORING_OFF_CQ_RING);
+    ring->sqes = mmap(NULL, ring->sqes_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd,
+                      IORING_OFF_SQES);
+    if (ring->sq_ptr == MAP_FAILED || ring->cq_ptr == MAP_FAILED || ring->sqes == MAP_FAILED) {
+        close(ring->fd);
+        return false;
+    }
+
+    char *sq = ring->sq_ptr, *cq = ring->cq_ptr;
+    ring->sq_tail = (unsigned *) (sq + params.sq_off.tail);
+    ring->sq_mask = (unsigned *) (sq + params.sq_off.ring_mask);
+    ring->sq_array = (unsigned *) (sq + params.sq_off.array);
+    ring->cq_head = (unsigned *) (cq + params.cq_off.head);
+    ring->cq_tail = (unsigned *) (cq + params.cq_off.tail);
+    ring->cq_mask = (unsigned *) (cq + params.cq_off.ring_mask);
+    ring->cqes = (struct io_uring_cqe *) (cq + params.cq_off.cqes);
+    return true;
+}
+
+void ring_close(Ring *ring) {
+    munmap(ring->sqes, ring->sqes_len);
+    if (ring->cq_ptr != ring->sq_ptr) munmap(ring->cq_ptr, ring->cq_len);
+    munmap(ring->sq_ptr, ring->sq_len);
+    close(ring->fd);
+}
+
+/**
+ * @brief Submits one IORING_OP_WRITEV at the current file position and waits for its completion.
+ * @param ring Ring set up by ring_setup.
+ * @param fd Destination descriptor.
+ * @param iov Buffers to write.
+ * @param iovcnt Number of buffers.
+ * @return Bytes written, or -errno.
+ */
+ssize_t ring_writev(Ring *ring, int fd, const struct iovec *iov, int iovcnt) {
+    unsigned tail = *ring->sq_tail;
+    unsigned index = tail & *ring->sq_mask;
+    struct io_uring_sqe *sqe = &ring->sqes[index];
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = IORING_OP_WRITEV;
+    sqe->fd = fd;
+    sqe->addr = (uint64_t) (uintptr_t) iov;
+    sqe->len = (unsigned) iovcnt;
+    sqe->off = (uint64_t) -1; // Posição atual do ficheiro, como write()
+    ring->sq_array[index] = index;
+    __atomic_store_n(ring->sq_tail, tail + 1, __ATOMIC_RELEASE);
+
+    int submitted;
+    do {
+        submitted = (int) syscall(__NR_io_uring_enter, ring->fd, 1, 1, IORING_ENTER_GETEVENTS, NULL, 0);
+    } while (submitted < 0 && errno == EINTR);
+    if (submitted < 0) return -errno;
+
+    unsigned head = *ring->cq_head;
+    while (head == __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE)) {
+        if (syscall(__NR_io_uring_enter, ring->fd, 0, 1, IORING_ENTER_GETEVENTS, NULL, 0) < 0 && errno != EINTR)
+            return -errno;
+    }
+    ssize_t result = ring->cqes[head & *ring->cq_mask].res;
+    __atomic_store_n(ring->cq_head, head + 1, __ATOMIC_RELEASE);
+    return result;
+}
+
+/**
+ * @brief Writes the whole iovec array, resuming after short writes; io_uring first, writev as fallback.
+ * @param sink Output sink.
+ * @param iov Buffers to write (modified as they are consumed).
+ * @param iovcnt Number of buffers.
+ */
+void sink_write_all(OutSink *sink, struct iovec *iov, int iovcnt) {
+    while (iovcnt > 0) {
+        ssize_t written;
+        if (sink->use_ring) {
+            written = ring_writev(&sink->ring, sink->fd, iov, iovcnt);
+            if (written < 0 && written != -EINTR && written != -EAGAIN) {
+                // O kernel recusou a operação: o resto da saída segue por writev
+                sink->use_ring = false;
+                continue;
+            }
+        } else {
+            written = writev(sink->fd, iov, iovcnt);
+            if (written < 0 && errno != EINTR && errno != EAGAIN) return;
+        }
+        if (written < 0) continue;
+
+        while (iovcnt > 0 && (size_t) written >= iov->iov_len) {
+            written -= iov->iov_len;
+            iov++;
+            iovcnt--;
+        }
+        if (iovcnt > 0) {
+            iov->iov_base = (char *) iov->iov_base + written;
+            iov->iov_len -= written;
+        }
+    }
+}
+
+/**
+ * @brief Writes a block in pieces of at most PIPE_BUF bytes, each ending at a line break.
+ *
+ * Several processes share the same pipe or terminal; a pipe write of at most PIPE_BUF bytes is atomic,
+ * so whole lines of different children never get mixed.
+ *
+ * @param sink Output sink.
+ * @param data Whole lines to write.
+ * @param len Number of bytes.
+ */
+void sink_write_lines(OutSink *sink, char *data, size_t len) {
+    while (len > 0) {
+        size_t chunk = len;
+        if (chunk > PIPE_BUF) {
+            chunk = PIPE_BUF;
+            while (chunk > 0 && data[chunk - 1] != '\n') chunk--;
+            if (chunk == 0) chunk = PIPE_BUF;
+        }
+        struct iovec iov = {data, chunk};
+        sink_write_all(sink, &iov, 1);
+        data += chunk;
+        len -= chunk;
+    }
+}
+
+// Thread de escrita: esvazia a fila de blocos cheios, por ordem, em lotes de até SINK_BATCH blocos
+void *sink_thread(void *arg) {
+    OutSink *sink = (OutSink *) arg;
+    struct iovec iov[SINK_BATCH];
+
+    pthread_mutex_lock(&sink->mutex);
+    for (;;) {
+        while (sink->queue_head == NULL && !sink->closing) pthread_cond_wait(&sink->cond, &sink->mutex);
+        if (sink->queue_head == NULL) break;
+        SinkBlock *batch = sink->queue_head;
+        sink->queue_head = sink->queue_tail = NULL;
+        pthread_mutex_unlock(&sink->mutex);
+
+        SinkBlock *block = batch, *last = batch;
+        for (; sink->line_chunks && block != NULL; block = block->next) {
+            sink_write_lines(sink, block->data, block->len);
+            last = block;
+        }
+        while (block != NULL) {
+            int count = 0;
+            for (; block != NULL && count < SINK_BATCH; block = block->next) {
+                iov[count].iov_base = block->data;
+                iov[count].iov_len = block->len;
+                count++;
+                last = block;
+            }
+            sink_write_all(sink, iov, count);
+        }
+
+        pthread_mutex_lock(&sink->mutex);
+        last->next = sink->free_list;
+        sink->free_list = batch;
+        pthread_cond_broadcast(&sink->cond);
+    }
+    pthread_mutex_unlock(&sink->mutex);
+    return NULL;
+}
+
+/**
+ * @brief Opens an asynchronous output sink on fd, with its own writer thread.
+ * @param sink Sink to initialize.
+ * @param fd Destination descriptor (usually STDOUT_FILENO).
+ * @return true on success, else false.
+ */
+bool sink_open(OutSink *sink, int fd) {
+    memset(sink, 0, sizeof(*sink));
+    sink->fd = fd;
+    // Blocos grandes só num ficheiro regular; pipes e terminais recebem linhas inteiras em escritas atómicas
+    struct stat st;
+    sink->line_chunks = fstat(fd, &st) < 0 || !S_ISREG(st.st_mode);
+    sink->current = malloc(sizeof(SinkBlock));
+    if (sink->current == NULL) return false;
+    sink->current->len = 0;
+    sink->current->next = NULL;
+    sink->use_ring = ring_setup(&sink->ring, 8);
+    pthread_mutex_init(&sink->mutex, NULL);
+    pthread_cond_init(&sink->cond, NULL);
+    if (pthread_create(&sink->thread, NULL, sink_thread, sink) != 0) {
+        if (sink->use_ring) ring_close(&sink->ring);
+        free(sink->current);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Returns room for at least len bytes in the current block, queueing the block if it is full.
+ *
+ * Full blocks go to the writer thread and a free (or new) block takes their place, so the
+ * worker never waits for the terminal or the disk; it only waits if memory runs out.
+ *
+ * @param sink Output sink.
+ * @param len Bytes about to be written (at most SINK_BLOCK).
+ * @return Where to write; confirm with sink_commit.
+ */
+char *sink_reserve(OutSink *sink, size_t len) {
+    if (sink->current->len + len > SINK_BLOCK) {
+        pthread_mutex_lock(&sink->mutex);
+        if (sink->queue_tail != NULL)
+            sink->queue_tail->next = sink->current;
+        else
+            sink->queue_head = sink->current;
+        sink->queue_tail = sink->current;
+        pthread_cond_broadcast(&sink->cond);
+
+        SinkBlock *block = sink->free_list;
+        if (block != NULL) sink->free_list = block->next;
+        pthread_mutex_unlock(&sink->mutex);
+
+        if (block == NULL) block = malloc(sizeof(SinkBlock));
+        if (block == NULL) {
+            pthread_mutex_lock(&sink->mutex);
+            while (sink->free_list == NULL) pthread_cond_wait(&sink->cond, &sink->mutex);
+            block = sink->free_list;
+            sink->free_list = block->next;
+            pthread_mutex_unlock(&sink->mutex);
+        }
+        block->len = 0;
+        block->next = NULL;
+        sink->current = block;
+    }
+    return sink->current->data + sink->current->len;
+}
+
+void sink_commit(OutSink *sink, size_t len) {
+    sink->current->len += len;
+}
+
+/**
+ * @brief Queues the last block, waits for the writer thread to drain everything and frees the sink.
+ * @param sink Output sink.
+ */
+void sink_close(OutSink *sink) {
+    pthread_mutex_lock(&sink->mutex);
+    if (sink->current->len > 0) {
+        if (sink->queue_tail != NULL)
+            sink->queue_tail->next = sink->current;
+        else
+            sink->queue_head = sink->current;
+        sink->queue_tail = sink->current;
+    } else {
+        sink->current->next = sink->free_list;
+        sink->free_list = sink->current;
+    }
+    sink->current = NULL;
+    sink->closing = true;
+    pthread_cond_broadcast(&sink->cond);
+    pthread_mutex_unlock(&sink->mutex);
+    pthread_join(sink->thread, NULL);
+
+    while (sink->free_list != NULL) {
+        SinkBlock *next = sink->free_list->next;
+        free(sink->free_list);
+        sink->free_list = next;
+    }
+    if (sink->use_ring) ring_close(&sink->ring);
+    pthread_mutex_destroy(&sink->mutex);
+    pthread_cond_destroy(&sink->cond);
+}
+
 int main(int argc, char* argv[]) {
     srand((unsigned int) time(NULL));
 
@@ -116,12 +552,19 @@ int main(int argc, char* argv[]) {
     int capacity = 100;
     int n = 0;
     char buffer[128];
+    size_t pending = 0;
     ssize_t bytesRead;
     char *line, *saveptr;
 
     //lê os pontos do polígono a partir de um arquivo e armazena esses pontos em um array dinâmico.
-    while ((bytesRead = read(arquivo, buffer, sizeof(buffer) - 1)) > 0) {
-        buffer[bytesRead] = '\0';
+    // Uma linha partida entre duas leituras fica no início do buffer e é completada pela leitura seguinte
+    while ((bytesRead = read(arquivo, buffer + pending, sizeof(buffer) - 1 - pending)) >= 0) {
+        size_t len = pending + bytesRead;
+        buffer[len] = '\0';
+        char *cut = bytesRead > 0 ? strrchr(buffer, '\n') : NULL;
+        size_t used = cut != NULL ? (size_t) (cut - buffer) + 1 : len;
+        char saved = buffer[used];
+        buffer[used] = '\0';
         line = strtok_r(buffer, "\n", &saveptr);
         while (line != NULL) {
             if (sscanf(line, "%lf %lf", &polygon[n].x, &polygon[n].y) == 2) {
@@ -133,6 +576,10 @@ int main(int argc, char* argv[]) {
             }
             line = strtok_r(NULL, "\n", &saveptr);
         }
+        if (bytesRead == 0) break;
+        buffer[used] = saved;
+        pending = len - used;
+        memmove(buffer, buffer + used, pending);
     }
 
     close(arquivo);
@@ -150,14 +597,34 @@ int main(int argc, char* argv[]) {
         pontos[i].y = (double) rand() / RAND_MAX * 2.0 - 1.0;
     }
 
-    int fd = open("resultados.txt", O_WRONLY | O_CREAT | O_TRUNC, 0666);
+    // Ficheiro de resultados pré-alocado com um registo de tamanho fixo por filho, partilhado via mmap:
+    // cada filho escreve apenas no seu registo, sem locks nem O_APPEND
+    size_t results_size = sizeof(ResultsHeader) + num_processos_filho * sizeof(ResultSlot);
+    int fd = open("resultados.bin", O_RDWR | O_CREAT | O_TRUNC, 0666);
     if (fd < 0) {
         perror("Erro ao abrir/criar o arquivo de resultados");
         free(polygon);
         free(pontos);
         exit(EXIT_FAILURE);
     }
+    if (ftruncate(fd, results_size) < 0) {
+        perror("Erro ao dimensionar o arquivo de resultados");
+        close(fd);
+        free(polygon);
+        free(pontos);
+        exit(EXIT_FAILURE);
+    }
+    ResultsHeader *results = mmap(NULL, results_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
     close(fd);
+    if (results == MAP_FAILED) {
+        perror("Erro ao mapear o arquivo de resultados");
+        free(polygon);
+        free(pontos);
+        exit(EXIT_FAILURE);
+    }
+    results->magic = RESULTS_MAGIC;
+    results->num_slots = num_processos_filho;
+    ResultSlot *slots = (ResultSlot *) (results + 1);
 
 
 
@@ -174,35 +641,41 @@ int main(int argc, char* argv[]) {
         if (pid == 0) {
             int pontos_a_processar = pontos_por_filho + (i == num_processos_filho - 1 ? pontos_extra : 0);
             int pontos_dentro = 0;
-            //Verifica quais pontos estão dentro do polígono
-            for (int j = i * pontos_por_filho; j < (i * pontos_por_filho + pontos_a_processar); j++) {
-                if (isInsidePolygon(polygon, n, pontos[j])) {
-                    snprintf(buffer, sizeof(buffer), "Ponto (%.6lf, %.6lf) está dentro do polígono.\n", pontos[j].x, pontos[j].y);
-                    write(STDOUT_FILENO, buffer, strlen(buffer));
-                    pontos_dentro++;
-                } else {
-                    snprintf(buffer, sizeof(buffer), "Ponto (%.6lf, %.6lf) está fora do polígono.\n", pontos[j].x, pontos[j].y);
-                    write(STDOUT_FILENO, buffer, strlen(buffer));
-                }
-            }
+            static const char dentro[] = ") está dentro do polígono.\n";
+            static const char fora[] = ") está fora do polígono.\n";
 
-            int fd_filho = open("resultados.txt", O_WRONLY | O_APPEND);
-            if (fd_filho < 0) {
-                perror("Erro ao abrir o arquivo de resultados");
-                free(polygon);
-                free(pontos);
+            // As linhas são formatadas em blocos e escritas por uma thread, sem uma chamada de sistema por ponto
+            OutSink sink;
+            if (!sink_open(&sink, STDOUT_FILENO)) {
+                perror("Erro ao criar a saída do filho");
                 exit(EXIT_FAILURE);
             }
-            char result[128];
-            snprintf(result, sizeof(result), "%d;%d;%d\n", getpid(), pontos_a_processar, pontos_dentro);
-            if (write(fd_filho, result, strlen(result)) < 0) {
-                perror("Erro ao escrever no arquivo de resultados");
-                close(fd_filho);
-                free(polygon);
-                free(pontos);
-                exit(EXIT_FAILURE);
+
+            //Verifica quais pontos estão dentro do polígono
+            for (int j = i * pontos_por_filho; j < (i * pontos_por_filho + pontos_a_processar); j++) {
+                bool inside = isInsidePolygon(polygon, n, pontos[j]);
+                if (inside) pontos_dentro++;
+
+                char *start = sink_reserve(&sink, sizeof(buffer));
+                char *p = start;
+                memcpy(p, "Ponto (", 7);
+                p += 7;
+                p += format_fixed6(p, pontos[j].x);
+                *p++ = ',';
+                *p++ = ' ';
+                p += format_fixed6(p, pontos[j].y);
+                memcpy(p, inside ? dentro : fora, inside ? sizeof(dentro) - 1 : sizeof(fora) - 1);
+                p += inside ? sizeof(dentro) - 1 : sizeof(fora) - 1;
+                sink_commit(&sink, p - start);
             }
-            close(fd_filho);
+            sink_close(&sink);
+
+            // Preenche o registo do filho; "done" é escrito por último
+            slots[i].pid = getpid();
+            slots[i].processed = pontos_a_processar;
+            slots[i].inside = pontos_dentro;
+            __atomic_store_n(&slots[i].done, 1, __ATOMIC_RELEASE);
+            munmap(results, results_size);
             free(polygon);
             free(pontos);
             exit(0);
@@ -216,28 +689,31 @@ int main(int argc, char* argv[]) {
 
     while (wait(NULL) > 0);
 
-    //Leitura e Agregação dos Resultados no ficheiro
-    fd = open("resultados.txt", O_RDONLY);
+    //Leitura e Agregação dos Resultados diretamente dos registos mapeados
+    msync(results, results_size, MS_SYNC);
+
+    // Exportação em texto para os consumidores de resultados.txt
+    fd = open("resultados.txt", O_WRONLY | O_CREAT | O_TRUNC, 0666);
     if (fd < 0) {
-        perror("Erro ao abrir o arquivo de resultados para leitura");
+        perror("Erro ao abrir/criar o arquivo de resultados");
+        munmap(results, results_size);
         free(polygon);
         free(pontos);
         exit(EXIT_FAILURE);
     }
-    //Leitura dos resultados dos processos filhos
-    char resultBuffer[128];
-    ssize_t resultBytesRead;
-    while ((resultBytesRead = read(fd, resultBuffer, sizeof(resultBuffer) - 1)) > 0) {
-        resultBuffer[resultBytesRead] = '\0';
-        char *linha = strtok(resultBuffer, "\n");
-        while (linha != NULL) {
-            int pidFilho, pontosProcessados, pontosDentro;
-            sscanf(linha, "%d;%d;%d", &pidFilho, &pontosProcessados, &pontosDentro);
-            printf("%d;%d;%d\n", pidFilho, pontosProcessados, pontosDentro);
-            linha = strtok(NULL, "\n");
+    for (int i = 0; i < num_processos_filho; i++) {
+        if (!__atomic_load_n(&slots[i].done, __ATOMIC_ACQUIRE)) {
+            fprintf(stderr, "Filho %d não escreveu o seu resultado\n", i);
+            continue;
         }
+        char linha[128];
+        int len = snprintf(linha, sizeof(linha), "%d;%lld;%lld\n", slots[i].pid,
+                           (long long) slots[i].processed, (long long) slots[i].inside);
+        write(fd, linha, len);
+        printf("%s", linha);
     }
     close(fd);
+    munmap(results, results_size);
     free(polygon);
     free(pontos);
 
@@ -1,3 +1,4 @@
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdbool.h>
@@ -5,22 +6,153 @@
 #include <unistd.h>
 #include <fcntl.h>
 #include <math.h>
+#include <float.h>
 #include <pthread.h>
+#include <sched.h>
 #include <string.h>
+#include <stdint.h>
+#include <limits.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
 
 #define MAX_POINTS 1000000
 
+// Limite de erro relativo do determinante de orientação em double (Shewchuk, ccwerrboundA)
+#define ORIENT_ERRBOUND ((3.0 + 8.0 * DBL_EPSILON) * DBL_EPSILON / 2.0)
+// Maior número de vértices com núcleo desenrolado em tempo de compilação
+#define MAX_FIXED_N 16
+// Checkpoints: "MCCP" em little-endian; amostras por bloco de trabalho
+#define CHECKPOINT_MAGIC 0x5043434d
+#define CHECKPOINT_CHUNK (1 << 20)
+#define SAMPLER_SPLITMIX64 1
+// Armazém de resultados: "MCST" em little-endian
+#define STORE_MAGIC 0x5453434d
+// Trabalho sobre um bloco: prolongar o segmento guardado, ou, se este for mais longo do que o pedido,
+// classificar o prefixo pedido ou o sufixo a descontar (o que for mais curto)
+#define STORE_EXTEND 0
+#define STORE_PREFIX 1
+#define STORE_SUFFIX 2
+// Níveis do pré-filtro, do mais barato ao polígono completo
+#define PREFILTER_BOX 0
+#define PREFILTER_HULL 1
+#define PREFILTER_CIRCLE 2
+#define PREFILTER_INNER 3
+#define PREFILTER_OUTER 4
+#define PREFILTER_FULL 5
+#define PREFILTER_LEVELS 6
+// Amostras por lote do varrimento (--sweep)
+#define SWEEP_BATCH 65536
+// Modo por arestas: amostras por lote e arestas por bloco (32 bytes cada, o bloco cabe na L1 com o lote)
+#define EDGE_BATCH 4096
+#define EDGE_TILE 512
+// Arena (--arena): páginas de 2 MB e alinhamento de linha de cache
+#define HUGE_PAGE_SIZE (2UL * 1024 * 1024)
+#define ARENA_ALIGN 64
+#define ARENA_SMALL 0
+#define ARENA_HUGETLB 1
+#define ARENA_THP 2
+// Polígono quantizado (--quantize): bits da grelha e arestas por bloco
+#define QUANT_BITS 30
+#define QUANT_BLOCK 64
+// Gerador vetorial (--simd-rng): vias por vetor e amostras por bloco (cada bloco tem os seus fluxos)
+#define VRNG_LANES 4
+#define VRNG_BLOCK 65536
+// Pipeline (--pipeline): blocos por anel gerador→classificador, contagens por anel classificador→agregador
+#define PIPELINE_SLOTS 4
+#define PIPELINE_RESULTS 64
+#define PIPELINE_BLOCK 4096
+
 typedef struct {
     double x;
     double y;
 } Point;
 
+// Vetores de VRNG_LANES vias (extensões vetoriais do GCC)
+typedef uint64_t U64Lanes __attribute__((vector_size(8 * VRNG_LANES)));
+typedef int64_t I64Lanes __attribute__((vector_size(8 * VRNG_LANES)));
+typedef double F64Lanes __attribute__((vector_size(8 * VRNG_LANES)));
+
+// xoshiro256+ com um estado independente por via: s[k] guarda a palavra k do estado de cada via
+typedef struct {
+    U64Lanes s[4];
+} VectorRng;
+
+// Núcleo de classificação escolhido uma vez após carregar o polígono
+typedef bool (*InsideFn)(Point polygon[], int n, Point p);
+
+typedef struct {
+    float *x; // n + 1 vértices: o primeiro repete-se no fim para a aresta de fecho
+    float *y;
+    int n;
+    float margin_y;
+    float margin_d;
+} FloatEdges;
+
+// Aresta para o varrimento, com a extremidade inferior primeiro (a.y < b.y)
+typedef struct {
+    Point a;
+    Point b;
+} SweepEdge;
+
+typedef struct {
+    SweepEdge *edges;       // Arestas não horizontais, por a.y crescente
+    int num_edges;
+    double *events;         // Ordenadas distintas dos vértices, crescentes
+    int num_events;
+} SweepPolygon;
+
+typedef struct {
+    double y;
+    int index;
+} SweepKey;
+
+// Bloco de até QUANT_BLOCK arestas consecutivas do polígono quantizado
+typedef struct {
+    int32_t x0, y0;         // Primeiro vértice do bloco, absoluto
+    int32_t min_y, max_y;   // Ordenadas mínima e máxima das arestas do bloco
+    int32_t offset;         // Índice dos deltas em deltas16 ou deltas32
+    int16_t count;          // Arestas do bloco (deltas até ao vértice seguinte)
+    int16_t wide;           // 1 se algum delta não cabe em 16 bits
+} QuantBlock;
+
+typedef struct {
+    double origin_x, origin_y;
+    double scale;           // Unidades da grelha por unidade de coordenada
+    QuantBlock *blocks;
+    int num_blocks;
+    int16_t *deltas16;      // Pares (dx, dy)
+    int32_t *deltas32;
+    int num_wide;
+    size_t bytes;           // Memória dos blocos e deltas
+    int n;
+} QuantPolygon;
+
+// Estado partilhado do modo por arestas (--edge-parallel)
+typedef struct {
+    int num_points;
+    int num_workers;
+    unsigned char *parity;  // num_workers linhas de EDGE_BATCH bytes: bit 0 paridade, bit 1 caso degenerado
+    pthread_barrier_t barrier;
+} EdgeParallel;
+
 typedef struct {
     Point *points;
     Point *polygon;
-    int start;
+    int start;               // Com --edge-parallel, intervalo de arestas da thread em vez de amostras
     int end;
     int num_polygon_points;
+    InsideFn kernel;
+    const FloatEdges *edges; // NULL sem --float
+    const SweepPolygon *sweep; // NULL sem --sweep
+    EdgeParallel *edge_parallel; // NULL sem --edge-parallel
+    int index;
+    bool vector_rng;         // Amostras geradas em registos (--simd-rng); points não é usado
+    uint64_t seed;
+    const SweepEdge *lane_edges; // Arestas do núcleo por vias; NULL para classificar cada via com kernel
+    long fallbacks;
+    int cpu;
+    int cpu_real;
     int *total_inside;
     int *total_processed;
     pthread_mutex_t *mutex;
@@ -30,146 +162,2735 @@ typedef struct {
     int num_random_points;
     pthread_mutex_t *mutex;
 } ProgressData;
+typedef struct {
+    Point *polygon;
+    int n;
+    int start;
+    int end;
+    double sum;
+} ShoelaceData;
+
+// Cabeçalho do ficheiro de checkpoint, seguido de num_workers registos CheckpointWorker
+typedef struct {
+    uint32_t magic;
+    uint32_t sampler;       // SAMPLER_SPLITMIX64: amostra k = lease_sample(seed, k)
+    uint64_t seed;
+    uint64_t num_points;
+    uint64_t chunk;         // Amostras por bloco; o bloco c cabe ao trabalhador c % num_workers
+    uint64_t polygon_hash;  // FNV-1a dos vértices, tal como lidos do ficheiro
+    uint32_t num_vertices;
+    uint32_t num_workers;
+} CheckpointHeader;
+
+typedef struct {
+    uint64_t next_chunk;    // Próximo bloco por fazer (posição no fluxo = next_chunk * chunk)
+    uint64_t processed;
+    uint64_t inside;
+} CheckpointWorker;
+
+typedef struct {
+    Point *polygon;
+    int n;
+    InsideFn kernel;
+    const FloatEdges *edges;
+    const CheckpointHeader *job;
+    CheckpointWorker state; // Só muda no fim de cada bloco, com o mutex
+    long fallbacks;
+    pthread_mutex_t *mutex;
+} StreamData;
+
+typedef struct {
+    const char *path;
+    const CheckpointHeader *job;
+    StreamData *workers;
+    int interval;
+    int done;
+    int writes;
+    double write_time;
+    pthread_mutex_t *mutex;
+} CheckpointData;
+
+// Ficheiro do armazém para uma chave (polígono, amostrador, semente), seguido de num_segments registos StoreSegment
+typedef struct {
+    uint32_t magic;
+    uint32_t sampler;
+    uint64_t seed;
+    uint64_t polygon_hash;
+    uint32_t num_vertices;
+    uint32_t reserved;
+    uint64_t chunk;
+    uint64_t num_segments;
+} StoreHeader;
+
+// O segmento c cobre as amostras [start, end) do bloco c, com start = c * chunk; end == start se vazio
+typedef struct {
+    uint64_t start;
+    uint64_t end;
+    uint64_t inside;
+} StoreSegment;
+
+typedef struct {
+    uint64_t chunk;
+    uint64_t start;
+    uint64_t end;
+    uint64_t inside;
+    int mode;               // STORE_EXTEND, STORE_PREFIX ou STORE_SUFFIX
+} StoreWork;
+
+typedef struct {
+    Point *polygon;
+    int n;
+    InsideFn kernel;
+    const FloatEdges *edges;
+    uint64_t seed;
+    StoreWork *work;
+    uint64_t num_work;
+    uint64_t *next;         // Próximo trabalho por distribuir (atómico)
+    long fallbacks;
+} StoreWorker;
+
+typedef struct {
+    double min_x, min_y, max_x, max_y;
+    Point *hull;            // Invólucro convexo, sentido anti-horário
+    int hull_n;
+    double cx, cy, r2;      // Círculo inscrito (r2 = 0 se não houver)
+    Point *simple;          // Polígono simplificado (Douglas-Peucker) e a sua banda de tolerância
+    int simple_n;
+    double eps;
+    double band2;
+    InsideFn kernel;        // Núcleo completo para as amostras que ficam na banda
+    long hits[PREFILTER_LEVELS];
+} Prefilter;
+
+// Pré-filtro ativo (--prefilter); contadores por thread, somados por prefilter_collect
+static Prefilter prefilter;
+static __thread long prefilter_hits[PREFILTER_LEVELS];
+
+typedef struct {
+    char *base;             // NULL sem --arena
+    size_t size;
+    size_t used;
+    int mode;               // ARENA_HUGETLB, ARENA_THP ou ARENA_SMALL
+    size_t shared;          // Zona partilhada, pré-faltada; seguem-se as subarenas das threads fixadas
+    size_t local_size;      // Bytes da subarena de cada thread (0 sem --affinity)
+} Arena;
+
+typedef struct {
+    char *start;
+    size_t length;
+} PrefaultData;
+
+// Anel de um só produtor e um só consumidor; os índices de cada lado ficam em linhas de cache distintas
+typedef struct {
+    uint64_t head __attribute__((aligned(64))); // Escrito só pelo produtor
+    uint64_t tail_cache;    // Última cauda vista pelo produtor
+    int closed;             // O produtor não publica mais
+    uint64_t tail __attribute__((aligned(64))); // Escrito só pelo consumidor
+    uint64_t head_cache;    // Última cabeça vista pelo consumidor
+    unsigned char *slots __attribute__((aligned(64)));
+    size_t slot_size;
+    uint64_t capacity;
+} SpscRing;
+
+// Bloco de amostras num anel gerador→classificador; points é o buffer fixo da ranhura
+typedef struct {
+    uint64_t block;
+    int count;
+    Point *points;
+} SampleBlock;
+
+// Contagem de um bloco num anel classificador→agregador
+typedef struct {
+    uint64_t block;
+    int count;
+    int inside;
+} BlockCount;
+
+typedef struct {
+    SpscRing *blocks;       // generators x classifiers anéis: o do par (g, c) é blocks[g * classifiers + c]
+    SpscRing *counts;       // Um anel por classificador
+    int generators;
+    int classifiers;
+    int block;
+    uint64_t num_points;
+    uint64_t num_blocks;
+    uint64_t seed;
+    Point *polygon;
+    int n;
+    InsideFn kernel;
+    const FloatEdges *edges;
+} Pipeline;
+
+// Thread de um estágio do pipeline e o seu tempo ocupado (a gerar, classificar ou agregar) e à espera
+typedef struct {
+    Pipeline *pipeline;
+    int index;
+    double busy;
+    double elapsed;
+    long stalls;            // Passagens sem ranhura livre (produtor) ou sem dados (consumidor)
+    long fallbacks;
+    uint64_t inside;
+    uint64_t processed;
+} PipelineStage;
+
+// Arena dos buffers de longa duração; libertada uma só vez no fim
+static Arena arena = {NULL, 0, 0, ARENA_SMALL, 0, 0};
+
+// Polígono quantizado ativo (--quantize), usado por isInsideQuantized
+static QuantPolygon quant;
+
+// Pedido de paragem (SIGINT/SIGTERM): os trabalhadores param no fim do bloco corrente
+static volatile sig_atomic_t stop_requested = 0;
+
+/**
+ * @brief Exact sign of the orientation determinant, used when the floating-point filter is inconclusive.
+ *
+ * The determinant is expanded into six products of input coordinates. Each product is split exactly
+ * with fma and the twelve terms are accumulated into a non-overlapping expansion (two_sum), whose
+ * most significant nonzero component has the sign of the exact result.
+ *
+ * @param p First point of the triplet.
+ * @param q Second point of the triplet.
+ * @param r Third point of the triplet.
+ * @return 0 if p, q, and r are colinear, 1 if clockwise, 2 if counterclockwise.
+ */
+int orientation_exact(Point p, Point q, Point r) {
+    double a[6] = {q.y, -p.y, p.y, -q.x, p.x, -p.x};
+    double b[6] = {r.x, r.x, q.x, r.y, r.y, q.y};
+    double e[12];
+    int m = 0;
+
+    for (int k = 0; k < 12; k++) {
+        double product = a[k / 2] * b[k / 2];
+        double term = (k % 2 == 0) ? product : fma(a[k / 2], b[k / 2], -product);
+        for (int i = 0; i < m; i++) {
+            double s = term + e[i];
+            double bv = s - term;
+            e[i] = (term - (s - bv)) + (e[i] - bv);
+            term = s;
+        }
+        e[m++] = term;
+    }
+
+    for (int i = m - 1; i >= 0; i--) {
+        if (e[i] != 0.0) return (e[i] > 0) ? 1 : 2;
+    }
+    return 0;
+}
+
+/**
+ * @brief Determines the orientation of an ordered triplet (p, q, r).
+ * @param p First point of the triplet.
+ * @param q Second point of the triplet.
+ * @param r Third point of the triplet.
+ * @return 0 if p, q, and r are colinear, 1 if clockwise, 2 if counterclockwise.
+ */
+int orientation(Point p, Point q, Point r) {
+    double left = (q.y - p.y) * (r.x - q.x);
+    double right = (q.x - p.x) * (r.y - q.y);
+    double val = left - right;
+
+    // Filtro: o sinal em double é garantido fora do limite de erro; caso contrário, aritmética exata
+    double bound = ORIENT_ERRBOUND * (fabs(left) + fabs(right));
+    if (val > bound) return 1;
+    if (-val > bound) return 2;
+    return orientation_exact(p, q, r);
+}
+
+/**
+ * @brief Checks if point q lies on line segment pr.
+ * @param p First point of the line segment.
+ * @param q Point to check.
+ * @param r Second point of the line segment.
+ * @return true if point q lies on line segment pr, else false.
+ */
+bool onSegment(Point p, Point q, Point r) {
+    if (q.x <= fmax(p.x, r.x) && q.x >= fmin(p.x, r.x) &&
+        q.y <= fmax(p.y, r.y) && q.y >= fmin(p.y, r.y))
+        return true;
+
+    return false;
+}
+
+/**
+ * @brief Checks if line segments p1q1 and p2q2 intersect.
+ * @param p1 First point of the first line segment.
+ * @param q1 Second point of the first line segment.
+ * @param p2 First point of the second line segment.
+ * @param q2 Second point of the second line segment.
+ * @return true if line segments p1q1 and p2q2 intersect, else false.
+ */
+bool doIntersect(Point p1, Point q1, Point p2, Point q2) {
+    int o1 = orientation(p1, q1, p2);
+    int o2 = orientation(p1, q1, q2);
+    int o3 = orientation(p2, q2, p1);
+    int o4 = orientation(p2, q2, q1);
+
+    if (o1 != o2 && o3 != o4)
+        return true;
+
+    if (o1 == 0 && onSegment(p1, p2, q1)) return true;
+    if (o2 == 0 && onSegment(p1, q2, q1)) return true;
+    if (o3 == 0 && onSegment(p2, p1, q2)) return true;
+    if (o4 == 0 && onSegment(p2, q1, q2)) return true;
+
+    return false;
+}
+
+/**
+ * @brief Checks if a point p is inside a polygon of n points.
+ * @param polygon[] Array of points forming the polygon.
+ * @param n Number of points in the polygon.
+ * @param p Point to check.
+ * @return true if the point p is inside the polygon, else false.
+ */
+bool isInsidePolygon(Point polygon[], int n, Point p) {
+    if (n < 3) return false;
+
+    Point extreme = {2.5, p.y};
+
+    int count = 0, i = 0;
+    do {
+        int next = (i + 1) % n;
+
+        if (doIntersect(polygon[i], polygon[next], p, extreme)) {
+            if (orientation(polygon[i], p, polygon[next]) == 0)
+                return onSegment(polygon[i], p, polygon[next]);
+            count++;
+        }
+        i = next;
+    } while (i != 0);
+
+    return count & 1;
+}
+
+/**
+ * @brief Detects whether the polygon is convex and, if so, normalizes it to counterclockwise order.
+ *
+ * Repeated consecutive vertices (including a closing vertex equal to the first) are removed in place.
+ * A polygon is convex when every turn has the same sign and the turns add up to a single revolution,
+ * which rules out self-intersecting "stars" whose turns all share a sign.
+ *
+ * @param polygon Polygon vertices; compacted and possibly reversed in place.
+ * @param n Number of vertices; updated after compaction.
+ * @return true if the polygon is convex, else false.
+ */
+bool polygon_convexity(Point polygon[], int *n) {
+    int m = 0;
+    for (int i = 0; i < *n; i++) {
+        if (m > 0 && polygon[i].x == polygon[m - 1].x && polygon[i].y == polygon[m - 1].y) continue;
+        polygon[m++] = polygon[i];
+    }
+    while (m > 1 && polygon[m - 1].x == polygon[0].x && polygon[m - 1].y == polygon[0].y) m--;
+    *n = m;
+    if (m < 3) return false;
+
+    int sign = 0;
+    double turning = 0.0;
+    for (int i = 0; i < m; i++) {
+        Point a = polygon[i], b = polygon[(i + 1) % m], c = polygon[(i + 2) % m];
+        double ux = b.x - a.x, uy = b.y - a.y, vx = c.x - b.x, vy = c.y - b.y;
+        int o = orientation(a, b, c);
+        if (o != 0) {
+            int s = (o == 2) ? 1 : -1;
+            if (sign != 0 && s != sign) return false;
+            sign = s;
+        }
+        turning += atan2(ux * vy - uy * vx, ux * vx + uy * vy);
+    }
+    if (sign == 0 || fabs(fabs(turning) - 2.0 * M_PI) > 1e-6) return false;
+
+    // Sentido horário: inverte para anti-horário
+    if (sign < 0) {
+        for (int i = 0, j = m - 1; i < j; i++, j--) {
+            Point t = polygon[i];
+            polygon[i] = polygon[j];
+            polygon[j] = t;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Checks if a point p is inside a convex counterclockwise polygon in O(log n).
+ *
+ * Binary search over the fan of wedges from vertex 0 finds the wedge containing p,
+ * then a single orientation test against the opposite edge decides. Points on the boundary are inside.
+ *
+ * @param polygon[] Convex polygon in counterclockwise order (see polygon_convexity).
+ * @param n Number of points in the polygon.
+ * @param p Point to check.
+ * @return true if the point p is inside the polygon, else false.
+ */
+bool isInsideConvex(Point polygon[], int n, Point p) {
+    Point o = polygon[0];
+
+    // Fora do ângulo formado pelas arestas que saem do pivô
+    if (orientation(o, polygon[1], p) == 1) return false;
+    if (orientation(o, polygon[n - 1], p) == 2) return false;
+
+    // Maior i em [1, n - 2] com p à esquerda (ou sobre) o raio pivô -> polygon[i]
+    int lo = 1, hi = n - 2;
+    while (lo < hi) {
+        int mid = (lo + hi + 1) / 2;
+        if (orientation(o, polygon[mid], p) != 1)
+            lo = mid;
+        else
+            hi = mid - 1;
+    }
+
+    return orientation(polygon[lo], polygon[lo + 1], p) != 1;
+}
+
+/**
+ * @brief Body of the kernels specialized for a fixed vertex count.
+ *
+ * Same test as isInsidePolygon, edge by edge and in the same order, so the results are identical.
+ * With n a compile-time constant the loop is fully unrolled and the "% n" disappears; edges lying
+ * entirely above or below the horizontal ray cannot meet it and are skipped before doIntersect.
+ *
+ * @param polygon Array of points forming the polygon.
+ * @param n Number of points in the polygon (a constant in every instantiation).
+ * @param p Point to check.
+ * @return true if the point p is inside the polygon, else false.
+ */
+static inline __attribute__((always_inline)) bool inside_fixed(const Point *polygon, int n, Point p) {
+    Point extreme = {2.5, p.y};
+    int count = 0;
+
+#pragma GCC unroll 16
+    for (int i = 0; i < n; i++) {
+        Point a = polygon[i];
+        Point b = polygon[i + 1 == n ? 0 : i + 1];
+        if ((a.y > p.y && b.y > p.y) || (a.y < p.y && b.y < p.y)) continue;
+        if (doIntersect(a, b, p, extreme)) {
+            if (orientation(a, p, b) == 0)
+                return onSegment(a, p, b);
+            count++;
+        }
+    }
+    return count & 1;
+}
+
+// Gera isInsidePolygonN: o flatten inclui doIntersect/orientation no corpo desenrolado
+#define DEFINE_FIXED_KERNEL(N)                                                  \
+    __attribute__((flatten)) bool isInsidePolygon##N(Point polygon[], int n, Point p) { \
+        (void) n;                                                               \
+        return inside_fixed(polygon, N, p);                                     \
+    }
+
+DEFINE_FIXED_KERNEL(3)
+DEFINE_FIXED_KERNEL(4)
+DEFINE_FIXED_KERNEL(5)
+DEFINE_FIXED_KERNEL(6)
+DEFINE_FIXED_KERNEL(7)
+DEFINE_FIXED_KERNEL(8)
+DEFINE_FIXED_KERNEL(9)
+DEFINE_FIXED_KERNEL(10)
+DEFINE_FIXED_KERNEL(11)
+DEFINE_FIXED_KERNEL(12)
+DEFINE_FIXED_KERNEL(13)
+DEFINE_FIXED_KERNEL(14)
+DEFINE_FIXED_KERNEL(15)
+DEFINE_FIXED_KERNEL(16)
+
+// Tabela de despacho indexada pelo número de vértices
+static const InsideFn fixed_kernels[MAX_FIXED_N + 1] = {
+    NULL, NULL, NULL,
+    isInsidePolygon3, isInsidePolygon4, isInsidePolygon5, isInsidePolygon6, isInsidePolygon7,
+    isInsidePolygon8, isInsidePolygon9, isInsidePolygon10, isInsidePolygon11, isInsidePolygon12,
+    isInsidePolygon13, isInsidePolygon14, isInsidePolygon15, isInsidePolygon16
+};
+
+/**
+ * @brief Chooses the classification kernel once, after the polygon is loaded.
+ *
+ * Convex polygons use the O(log n) wedge test, which measured faster than the unrolled kernels
+ * even for small n; other polygons with up to MAX_FIXED_N vertices use the unrolled kernel for
+ * their vertex count and everything else the general loop.
+ *
+ * @param n Number of points in the polygon.
+ * @param convex Whether the polygon was detected convex by polygon_convexity.
+ * @return Kernel to call for every sample.
+ */
+InsideFn select_kernel(int n, bool convex) {
+    if (convex) return isInsideConvex;
+    if (n >= 3 && n <= MAX_FIXED_N) return fixed_kernels[n];
+    return isInsidePolygon;
+}
+
+/**
+ * @brief Reserves the arena for the long-lived buffers, on huge pages when possible.
+ *
+ * Tries MAP_HUGETLB first (needs pages reserved in /proc/sys/vm/nr_hugepages); otherwise maps a
+ * region aligned to 2 MB and asks for transparent huge pages with madvise(MADV_HUGEPAGE).
+ *
+ * @param arena Arena to fill.
+ * @param shared Bytes of the shared region (pre-faulted); rounded up to a multiple of 2 MB.
+ * @param local Bytes of the sub-arena of each pinned worker, or 0; rounded up to a multiple of 2 MB,
+ *        so that no huge page is shared by two workers.
+ * @param workers Number of sub-arenas.
+ * @return true on success.
+ */
+bool arena_create(Arena *arena, size_t shared, size_t local, int workers) {
+    arena->shared = (shared + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE;
+    arena->local_size = (local + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE;
+    size_t size = arena->shared + arena->local_size * workers;
+    arena->size = size;
+    arena->used = 0;
+
+    arena->base = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if (arena->base != MAP_FAILED) {
+        arena->mode = ARENA_HUGETLB;
+        return true;
+    }
+
+    // Reserva com folga de 2 MB para alinhar o início, e devolve as sobras das pontas
+    char *raw = mmap(NULL, size + HUGE_PAGE_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (raw == MAP_FAILED) {
+        arena->base = NULL;
+        return false;
+    }
+    char *aligned = (char *) (((uintptr_t) raw + HUGE_PAGE_SIZE - 1) & ~(uintptr_t) (HUGE_PAGE_SIZE - 1));
+    if (aligned > raw) munmap(raw, aligned - raw);
+    munmap(aligned + size, raw + HUGE_PAGE_SIZE - aligned);
+    arena->base = aligned;
+    arena->mode = madvise(aligned, size, MADV_HUGEPAGE) == 0 ? ARENA_THP : ARENA_SMALL;
+    return true;
+}
+
+void *prefault_thread(void *arg) {
+    PrefaultData *data = (PrefaultData *)arg;
+    for (size_t offset = 0; offset < data->length; offset += 4096) data->start[offset] = 0;
+    pthread_exit(NULL);
+}
+
+/**
+ * @brief Touches every page of the shared region with num_threads threads, so the classify loop takes no page faults.
+ *
+ * The sub-arenas are left alone: each pinned worker touches its own first, so they land on its node.
+ *
+ * @param arena Arena created by arena_create.
+ * @param num_threads Number of threads.
+ */
+void arena_prefault(Arena *arena, int num_threads) {
+    // Fatias múltiplas de 2 MB: cada página enorme é tocada por uma só thread
+    size_t pages = arena->shared / HUGE_PAGE_SIZE;
+    if ((size_t) num_threads > pages) num_threads = (int) pages;
+    pthread_t threads[num_threads];
+    PrefaultData data[num_threads];
+    for (int t = 0; t < num_threads; t++) {
+        size_t first = pages * t / num_threads, last = pages * (t + 1) / num_threads;
+        data[t] = (PrefaultData) {arena->base + first * HUGE_PAGE_SIZE, (last - first) * HUGE_PAGE_SIZE};
+        pthread_create(&threads[t], NULL, prefault_thread, &data[t]);
+    }
+    for (int t = 0; t < num_threads; t++) pthread_join(threads[t], NULL);
+}
+
+/**
+ * @brief Allocates a long-lived buffer from the arena, or with malloc when there is no arena or it is full.
+ * @param size Bytes to allocate.
+ * @return Pointer aligned to ARENA_ALIGN bytes in the arena, or the malloc result.
+ */
+void *buffer_alloc(size_t size) {
+    size_t aligned = (size + ARENA_ALIGN - 1) & ~(size_t) (ARENA_ALIGN - 1);
+    if (arena.base != NULL) {
+        // As threads também reservam: avanço atómico do topo
+        size_t offset = __atomic_fetch_add(&arena.used, aligned, __ATOMIC_RELAXED);
+        if (offset + aligned <= arena.shared) return arena.base + offset;
+    }
+    return malloc(size);
+}
+
+/**
+ * @brief Allocates a copy local to a pinned worker from its sub-arena, outside the pre-faulted region.
+ *
+ * The worker is the first to touch the pages (after pinning), so they are placed on its node.
+ * Without a sub-arena, or when it is full, falls back to buffer_alloc.
+ *
+ * @param worker Index of the worker.
+ * @param used Bytes of the sub-arena already taken by the worker; updated.
+ * @param size Bytes to allocate.
+ */
+void *arena_local_alloc(int worker, size_t *used, size_t size) {
+    size_t aligned = (size + ARENA_ALIGN - 1) & ~(size_t) (ARENA_ALIGN - 1);
+    if (arena.base != NULL && *used + aligned <= arena.local_size) {
+        char *p = arena.base + arena.shared + (size_t) worker * arena.local_size + *used;
+        *used += aligned;
+        return p;
+    }
+    return buffer_alloc(size);
+}
+
+// Liberta um buffer de buffer_alloc; os da arena só são libertados de uma vez, no fim
+void buffer_free(void *p) {
+    if (arena.base != NULL && (char *) p >= arena.base && (char *) p < arena.base + arena.size) return;
+    free(p);
+}
+
+// Faltas de página do processo até agora (menores e maiores)
+void page_faults(long *minor, long *major) {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    *minor = usage.ru_minflt;
+    *major = usage.ru_majflt;
+}
+
+/**
+ * @brief Builds the float32 structure-of-arrays copy of the polygon edges used by the --float mode.
+ *
+ * The error bounds assume every coordinate involved (vertices and samples) has magnitude at most M.
+ * Relative to the sample, each coordinate difference carries an error of at most 4uM (u = 2^-24),
+ * so a y comparison is certain beyond 4 FLT_EPSILON M and the crossing determinant beyond 32 FLT_EPSILON M^2.
+ * The double kernel casts its ray only up to x = 2.5, so polygons reaching past it disable the float path.
+ *
+ * @param edges Structure to fill.
+ * @param polygon Polygon vertices.
+ * @param n Number of vertices.
+ * @param max_sample Largest absolute coordinate of a sample.
+ * @return true if the float path can be used, else false.
+ */
+bool float_edges_build(FloatEdges *edges, Point polygon[], int n, double max_sample) {
+    double m = max_sample;
+    for (int i = 0; i < n; i++) {
+        if (polygon[i].x >= 2.5) return false;
+        m = fmax(m, fmax(fabs(polygon[i].x), fabs(polygon[i].y)));
+    }
+    if (m > FLT_MAX / 64.0) return false;
+
+    edges->x = buffer_alloc((n + 1) * sizeof(float));
+    edges->y = buffer_alloc((n + 1) * sizeof(float));
+    if (edges->x == NULL || edges->y == NULL) {
+        buffer_free(edges->x);
+        buffer_free(edges->y);
+        return false;
+    }
+    for (int i = 0; i <= n; i++) {
+        edges->x[i] = (float) polygon[i % n].x;
+        edges->y[i] = (float) polygon[i % n].y;
+    }
+    edges->n = n;
+    edges->margin_y = (float) (4.0 * FLT_EPSILON * m);
+    edges->margin_d = (float) (32.0 * FLT_EPSILON * m * m);
+    return true;
+}
+
+/**
+ * @brief Classifies a point with the float32 crossing-number kernel.
+ *
+ * The loop is branch-free so the compiler can vectorize it; an edge whose y straddle or crossing side
+ * falls inside the error bounds marks the whole sample as uncertain.
+ *
+ * @param edges Float edge data built by float_edges_build.
+ * @param p Point to check.
+ * @return 1 if inside, 0 if outside, -1 if the result must be recomputed in double.
+ */
+int classify_float(const FloatEdges *edges, Point p) {
+    const float *ex = edges->x, *ey = edges->y;
+    float px = (float) p.x, py = (float) p.y;
+    float margin_y = edges->margin_y, margin_d = edges->margin_d;
+    int crossings = 0, uncertain = 0;
+
+    for (int i = 0; i < edges->n; i++) {
+        float ax = ex[i] - px, ay = ey[i] - py;
+        float bx = ex[i + 1] - px, by = ey[i + 1] - py;
+        float d = ax * by - bx * ay;
+        int straddle = (ay > 0.0f) != (by > 0.0f);
+        crossings ^= straddle & ((d > 0.0f) == (by > 0.0f));
+        uncertain |= (fabsf(ay) <= margin_y) | (fabsf(by) <= margin_y) | (straddle & (fabsf(d) <= margin_d));
+    }
+    return uncertain ? -1 : crossings;
+}
+
+/**
+ * @brief Classifies a point with the float path when enabled, recomputing uncertain samples in double.
+ * @param edges Float edge data, or NULL to use the double kernel only.
+ * @param polygon[] Array of points forming the polygon.
+ * @param n Number of points in the polygon.
+ * @param kernel Double-precision kernel chosen by select_kernel.
+ * @param p Point to check.
+ * @param fallbacks Incremented for every sample recomputed in double.
+ * @return true if the point p is inside the polygon, else false.
+ */
+bool classify_sample(const FloatEdges *edges, Point polygon[], int n, InsideFn kernel, Point p, long *fallbacks) {
+    if (edges != NULL) {
+        int result = classify_float(edges, p);
+        if (result >= 0) return result;
+        (*fallbacks)++;
+    }
+    return kernel(polygon, n, p);
+}
+
+/**
+ * @brief Squared distance from p to the segment ab.
+ * @param p Point.
+ * @param a First endpoint.
+ * @param b Second endpoint.
+ * @return Squared Euclidean distance.
+ */
+double segment_distance2(Point p, Point a, Point b) {
+    double dx = b.x - a.x, dy = b.y - a.y;
+    double len2 = dx * dx + dy * dy;
+    double t = len2 > 0.0 ? ((p.x - a.x) * dx + (p.y - a.y) * dy) / len2 : 0.0;
+    t = t < 0.0 ? 0.0 : (t > 1.0 ? 1.0 : t);
+    double ex = a.x + t * dx - p.x, ey = a.y + t * dy - p.y;
+    return ex * ex + ey * ey;
+}
+
+int compare_point(const void *a, const void *b) {
+    const Point *p = a, *q = b;
+    if (p->x != q->x) return p->x < q->x ? -1 : 1;
+    return (p->y > q->y) - (p->y < q->y);
+}
+
+/**
+ * @brief Convex hull by Andrew's monotone chain, in counterclockwise order.
+ * @param polygon[] Polygon vertices.
+ * @param n Number of vertices.
+ * @param hull Output array with room for n + 1 points.
+ * @return Number of hull vertices.
+ */
+int convex_hull(Point polygon[], int n, Point hull[]) {
+    Point *sorted = malloc(n * sizeof(Point));
+    if (sorted == NULL) return 0;
+    memcpy(sorted, polygon, n * sizeof(Point));
+    qsort(sorted, n, sizeof(Point), compare_point);
+
+    int h = 0;
+    for (int i = 0; i < n; i++) {
+        while (h >= 2 && orientation(hull[h - 2], hull[h - 1], sorted[i]) != 2) h--;
+        hull[h++] = sorted[i];
+    }
+    for (int i = n - 2, lower = h + 1; i >= 0; i--) {
+        while (h >= lower && orientation(hull[h - 2], hull[h - 1], sorted[i]) != 2) h--;
+        hull[h++] = sorted[i];
+    }
+    free(sorted);
+    return h - 1; // O último ponto repete o primeiro
+}
+
+/**
+ * @brief Douglas-Peucker simplification of a closed polygon.
+ *
+ * Every removed vertex, and so every original edge, stays within eps of the simplified edge that
+ * replaces it; the original boundary lies in the eps band around the simplified boundary.
+ *
+ * @param polygon[] Polygon vertices.
+ * @param n Number of vertices.
+ * @param eps Tolerance.
+ * @param out Output array with room for n points.
+ * @return Number of vertices kept.
+ */
+int douglas_peucker(Point polygon[], int n, double eps, Point out[]) {
+    bool *keep = calloc(n, sizeof(bool));
+    int *stack = malloc(2 * (n + 1) * sizeof(int));
+    if (keep == NULL || stack == NULL) {
+        free(keep);
+        free(stack);
+        return 0;
+    }
+
+    // O anel é partido no vértice 0 e no vértice mais afastado dele; o índice n representa o vértice 0
+    int far = 0;
+    double far_d2 = -1.0;
+    for (int i = 1; i < n; i++) {
+        double dx = polygon[i].x - polygon[0].x, dy = polygon[i].y - polygon[0].y;
+        if (dx * dx + dy * dy > far_d2) {
+            far_d2 = dx * dx + dy * dy;
+            far = i;
+        }
+    }
+    keep[0] = keep[far] = true;
+
+    int top = 0;
+    stack[top++] = 0;
+    stack[top++] = far;
+    stack[top++] = far;
+    stack[top++] = n;
+    double eps2 = eps * eps;
+    while (top > 0) {
+        int j = stack[--top], i = stack[--top];
+        int split = -1;
+        double split_d2 = eps2;
+        for (int k = i + 1; k < j; k++) {
+            double d2 = segment_distance2(polygon[k], polygon[i], polygon[j % n]);
+            if (d2 > split_d2) {
+                split_d2 = d2;
+                split = k;
+            }
+        }
+        if (split >= 0) {
+            keep[split] = true;
+            stack[top++] = i;
+            stack[top++] = split;
+            stack[top++] = split;
+            stack[top++] = j;
+        }
+    }
+
+    int m = 0;
+    for (int i = 0; i < n; i++) {
+        if (keep[i]) out[m++] = polygon[i];
+    }
+    free(stack);
+    free(keep);
+    return m;
+}
+
+/**
+ * @brief Builds the prefilter cascade used by isInsidePrefiltered.
+ *
+ * Levels, cheapest first: bounding box and convex hull (outside = reject), the largest inscribed
+ * circle found on a refined grid (inside = accept), and a Douglas-Peucker simplification with its
+ * tolerance band: a sample farther than the tolerance from the simplified boundary has the same
+ * parity in the simplified and in the full polygon, so it is accepted or rejected there. The
+ * tolerance is picked from a few candidates by the cost model m + P(band) * n. Only samples in the
+ * band reach the full-resolution kernel.
+ *
+ * @param filter Prefilter to fill.
+ * @param polygon[] Polygon vertices.
+ * @param n Number of vertices.
+ * @param kernel Full-resolution kernel.
+ * @return true on success.
+ */
+bool prefilter_build(Prefilter *filter, Point polygon[], int n, InsideFn kernel) {
+    memset(filter, 0, sizeof(*filter));
+    filter->kernel = kernel;
+    filter->min_x = filter->max_x = polygon[0].x;
+    filter->min_y = filter->max_y = polygon[0].y;
+    for (int i = 1; i < n; i++) {
+        filter->min_x = fmin(filter->min_x, polygon[i].x);
+        filter->max_x = fmax(filter->max_x, polygon[i].x);
+        filter->min_y = fmin(filter->min_y, polygon[i].y);
+        filter->max_y = fmax(filter->max_y, polygon[i].y);
+    }
+    double w = filter->max_x - filter->min_x, h = filter->max_y - filter->min_y;
+    double diag = sqrt(w * w + h * h);
+
+    filter->hull = buffer_alloc((n + 1) * sizeof(Point));
+    filter->simple = buffer_alloc(n * sizeof(Point));
+    if (filter->hull == NULL || filter->simple == NULL) return false;
+    filter->hull_n = convex_hull(polygon, n, filter->hull);
+
+    // Círculo inscrito: melhor centro numa grelha 32x32, refinado duas vezes em torno do melhor
+    double best_x = 0.0, best_y = 0.0, best_d2 = 0.0;
+    double cx0 = filter->min_x + w / 2.0, cy0 = filter->min_y + h / 2.0;
+    double step_x = w / 32.0, step_y = h / 32.0;
+    for (int round = 0, half = 16; round < 3; round++, half = 4) {
+        for (int gy = -half; gy < half; gy++) {
+            for (int gx = -half; gx < half; gx++) {
+                Point c = {cx0 + (gx + 0.5) * step_x, cy0 + (gy + 0.5) * step_y};
+                if (!kernel(polygon, n, c)) continue;
+                double d2 = INFINITY;
+                for (int i = 0; i < n && d2 > best_d2; i++) {
+                    d2 = fmin(d2, segment_distance2(c, polygon[i], polygon[(i + 1) % n]));
+                }
+                if (d2 > best_d2) {
+                    best_d2 = d2;
+                    best_x = c.x;
+                    best_y = c.y;
+                }
+            }
+        }
+        cx0 = best_x;
+        cy0 = best_y;
+        step_x /= 4.0;
+        step_y /= 4.0;
+    }
+    filter->cx = best_x;
+    filter->cy = best_y;
+    filter->r2 = best_d2 * (1.0 - 1e-9);
+
+    // Tolerância da simplificação: a de menor custo estimado entre diag/16 e diag/4096
+    double box_area = w * h > 0.0 ? w * h : 1.0;
+    double best_cost = INFINITY, best_eps = 0.0;
+    for (int k = 4; k <= 12; k++) {
+        double eps = diag / (double) (1 << k);
+        int m = douglas_peucker(polygon, n, eps, filter->simple);
+        if (m < 3) continue;
+        double perimeter = 0.0;
+        for (int i = 0; i < m; i++) {
+            Point a = filter->simple[i], b = filter->simple[(i + 1) % m];
+            perimeter += hypot(b.x - a.x, b.y - a.y);
+        }
+        double band = fmin(1.0, 2.0 * eps * perimeter / box_area);
+        double cost = m + band * n;
+        if (cost < best_cost) {
+            best_cost = cost;
+            best_eps = eps;
+        }
+    }
+    if (best_eps > 0.0) {
+        filter->eps = best_eps;
+        filter->simple_n = douglas_peucker(polygon, n, best_eps, filter->simple);
+        // Margem para os arredondamentos do cálculo das distâncias
+        double band = best_eps * (1.0 + 1e-6) + 1e-12 * diag;
+        filter->band2 = band * band;
+    }
+    return true;
+}
+
+/**
+ * @brief Point-in-polygon test through the prefilter cascade built by prefilter_build.
+ *
+ * Counts the level that resolved each sample in thread-local counters (see prefilter_collect).
+ *
+ * @param polygon[] Array of points forming the polygon.
+ * @param n Number of points in the polygon.
+ * @param p Point to check.
+ * @return true if the point p is inside the polygon, else false.
+ */
+bool isInsidePrefiltered(Point polygon[], int n, Point p) {
+    const Prefilter *filter = &prefilter;
+
+    if (p.x < filter->min_x || p.x > filter->max_x || p.y < filter->min_y || p.y > filter->max_y) {
+        prefilter_hits[PREFILTER_BOX]++;
+        return false;
+    }
+    if (filter->hull_n >= 3 && !isInsideConvex(filter->hull, filter->hull_n, p)) {
+        prefilter_hits[PREFILTER_HULL]++;
+        return false;
+    }
+    double dx = p.x - filter->cx, dy = p.y - filter->cy;
+    if (dx * dx + dy * dy < filter->r2) {
+        prefilter_hits[PREFILTER_CIRCLE]++;
+        return true;
+    }
+
+    if (filter->simple_n >= 3) {
+        const Point *s = filter->simple;
+        int m = filter->simple_n;
+        bool inside = false;
+        bool near = false;
+        for (int i = 0, j = m - 1; i < m; j = i++) {
+            if (segment_distance2(p, s[j], s[i]) <= filter->band2) {
+                near = true;
+                break;
+            }
+            if ((s[i].y > p.y) != (s[j].y > p.y) &&
+                p.x < s[j].x + (p.y - s[j].y) * (s[i].x - s[j].x) / (s[i].y - s[j].y)) {
+                inside = !inside;
+            }
+        }
+        if (!near) {
+            prefilter_hits[inside ? PREFILTER_INNER : PREFILTER_OUTER]++;
+            return inside;
+        }
+    }
+
+    prefilter_hits[PREFILTER_FULL]++;
+    return filter->kernel(polygon, n, p);
+}
+
+// Soma os contadores da thread corrente aos do pré-filtro; chamada por cada trabalhador no fim
+void prefilter_collect(void) {
+    for (int i = 0; i < PREFILTER_LEVELS; i++) {
+        __atomic_fetch_add(&prefilter.hits[i], prefilter_hits[i], __ATOMIC_RELAXED);
+        prefilter_hits[i] = 0;
+    }
+}
+
+void prefilter_report(void) {
+    if (prefilter.kernel == NULL) return;
+    long total = 0;
+    for (int i = 0; i < PREFILTER_LEVELS; i++) total += prefilter.hits[i];
+    if (total == 0) return;
+    const char *names[PREFILTER_LEVELS] = {"caixa", "invólucro", "círculo", "interior simplificado",
+                                           "exterior simplificado", "polígono completo"};
+    printf("Pré-filtro (%d vértices simplificados, eps %.3g):", prefilter.simple_n, prefilter.eps);
+    for (int i = 0; i < PREFILTER_LEVELS; i++) {
+        printf(" %s %.2f%%%s", names[i], 100.0 * prefilter.hits[i] / total, i + 1 < PREFILTER_LEVELS ? "," : "\n");
+    }
+}
+int compare_double(const void *a, const void *b) {
+    double x = *(const double *) a, y = *(const double *) b;
+    return (x > y) - (x < y);
+}
+
+int compare_sweep_edge(const void *a, const void *b) {
+    const SweepEdge *e = a, *f = b;
+    return (e->a.y > f->a.y) - (e->a.y < f->a.y);
+}
+
+int compare_sweep_key(const void *a, const void *b) {
+    const SweepKey *p = a, *q = b;
+    return (p->y > q->y) - (p->y < q->y);
+}
+
+/**
+ * @brief Order of two edges active in the same slab: true if e lies left of f just above e's lower endpoint.
+ *
+ * Decided with the exact orientation predicate; sweep_build only accepts polygons whose edges never
+ * cross, so the order is the same over the whole slab.
+ */
+static inline bool sweep_left_of(const SweepEdge *e, const SweepEdge *f) {
+    int side = orientation(f->a, f->b, e->a);
+    if (side == 0) side = orientation(f->a, f->b, e->b);
+    return side == 2;
+}
+
+// Cruzamento próprio de duas arestas (num ponto interior a ambas), com o predicado exato
+static inline bool sweep_edges_cross(const SweepEdge *e, const SweepEdge *f) {
+    int o1 = orientation(e->a, e->b, f->a), o2 = orientation(e->a, e->b, f->b);
+    int o3 = orientation(f->a, f->b, e->a), o4 = orientation(f->a, f->b, e->b);
+    return o1 != 0 && o2 != 0 && o3 != 0 && o4 != 0 && o1 != o2 && o3 != o4;
+}
+
+/**
+ * @brief Moves the active edge table up to ordinate y: edges ending at or below y leave, edges starting there enter in x order.
+ * @param sweep Polygon prepared by sweep_build.
+ * @param active Active edge indices, in x order.
+ * @param num_active Number of active edges, updated.
+ * @param next_edge First edge not yet inserted, updated.
+ * @param y Ordinate of the event.
+ */
+static inline void sweep_advance(const SweepPolygon *sweep, int *active, int *num_active, int *next_edge, double y) {
+    const SweepEdge *edges = sweep->edges;
+    int kept = 0;
+    for (int k = 0; k < *num_active; k++) {
+        if (edges[active[k]].b.y > y) active[kept++] = active[k];
+    }
+    *num_active = kept;
+    for (; *next_edge < sweep->num_edges && edges[*next_edge].a.y <= y; (*next_edge)++) {
+        int lo = 0, hi = *num_active;
+        while (lo < hi) {
+            int mid = (lo + hi) / 2;
+            if (sweep_left_of(&edges[*next_edge], &edges[active[mid]])) hi = mid;
+            else lo = mid + 1;
+        }
+        memmove(&active[lo + 1], &active[lo], (*num_active - lo) * sizeof(int));
+        active[lo] = *next_edge;
+        (*num_active)++;
+    }
+}
+
+/**
+ * @brief Prepares a polygon for sweep_classify: non-horizontal edges sorted by lower y and the vertex ordinates.
+ *
+ * Edges that cross swap places inside a slab with no event, which would silently break the
+ * binary search, so the events are replayed once and every pair of neighbouring active edges is
+ * tested: the lowest crossing of a polygon is always between two neighbours (Shamos-Hoey).
+ *
+ * @param sweep Structure to fill.
+ * @param polygon[] Polygon vertices.
+ * @param n Number of vertices.
+ * @return false if memory runs out, a vertex lies beyond the ray end used by the kernels (x >= 2.5)
+ *         or two edges cross (the polygon is not simple).
+ */
+bool sweep_build(SweepPolygon *sweep, Point polygon[], int n) {
+    sweep->edges = buffer_alloc(n * sizeof(SweepEdge));
+    sweep->events = buffer_alloc(n * sizeof(double));
+    sweep->num_edges = sweep->num_events = 0;
+    if (sweep->edges == NULL || sweep->events == NULL) return false;
+
+    for (int i = 0; i < n; i++) {
+        if (polygon[i].x >= 2.5) return false;
+        Point a = polygon[i], b = polygon[(i + 1) % n];
+        if (a.y == b.y) continue;
+        sweep->edges[sweep->num_edges++] = a.y < b.y ? (SweepEdge) {a, b} : (SweepEdge) {b, a};
+    }
+    for (int i = 0; i < n; i++) sweep->events[i] = polygon[i].y;
+    qsort(sweep->edges, sweep->num_edges, sizeof(SweepEdge), compare_sweep_edge);
+    qsort(sweep->events, n, sizeof(double), compare_double);
+    for (int i = 0; i < n; i++) {
+        if (sweep->num_events == 0 || sweep->events[sweep->num_events - 1] != sweep->events[i]) {
+            sweep->events[sweep->num_events++] = sweep->events[i];
+        }
+    }
+
+    // Só polígonos simples: as arestas vizinhas em cada faixa não se podem cruzar
+    int *active = malloc((sweep->num_edges + 1) * sizeof(int));
+    if (active == NULL) return false;
+    int num_active = 0, next_edge = 0;
+    bool simple = true;
+    for (int k = 0; simple && k < sweep->num_events; k++) {
+        sweep_advance(sweep, active, &num_active, &next_edge, sweep->events[k]);
+        for (int j = 0; simple && j + 1 < num_active; j++) {
+            simple = !sweep_edges_cross(&sweep->edges[active[j]], &sweep->edges[active[j + 1]]);
+        }
+    }
+    free(active);
+    return simple;
+}
+
+/**
+ * @brief Classifies a batch of samples with a scanline sweep over an active edge table.
+ *
+ * The samples are sorted by y and the sweep moves upward through the vertex ordinates. At each one
+ * the edges that end there leave the table and those that start there are inserted in x order. A
+ * sample is classified by binary search for the number of active edges to its right (parity), using
+ * the exact orientation predicate. Samples on an edge or at the height of a vertex, where crossings
+ * are ambiguous, are handed to the kernel, so the results match the kernel exactly. Cost is
+ * O((n + m) log(n + m) + events * active) instead of O(n * m).
+ *
+ * @param sweep Polygon prepared by sweep_build.
+ * @param polygon[] Polygon vertices (for the kernel).
+ * @param n Number of vertices.
+ * @param kernel Point-in-polygon test for the ambiguous samples.
+ * @param points Samples.
+ * @param count Number of samples.
+ * @param inside Output flag per sample, or NULL.
+ * @param fallbacks Incremented for every sample handed to the kernel.
+ * @return Number of samples inside the polygon.
+ */
+int sweep_classify(const SweepPolygon *sweep, Point polygon[], int n, InsideFn kernel, const Point *points, int count,
+                   unsigned char *inside, long *fallbacks) {
+    SweepKey *keys = malloc(count * sizeof(SweepKey));
+    int *active = malloc((sweep->num_edges + 1) * sizeof(int));
+    if (keys == NULL || active == NULL) {
+        perror("Erro ao alocar memória para o varrimento");
+        exit(EXIT_FAILURE);
+    }
+    for (int i = 0; i < count; i++) keys[i] = (SweepKey) {points[i].y, i};
+    qsort(keys, count, sizeof(SweepKey), compare_sweep_key);
+
+    const SweepEdge *edges = sweep->edges;
+    int num_active = 0, next_edge = 0, next_event = 0;
+    int total = 0;
+    for (int s = 0; s < count; s++) {
+        Point p = points[keys[s].index];
+
+        // Avança a linha de varrimento até ao último evento <= p.y
+        while (next_event < sweep->num_events && sweep->events[next_event] <= p.y) {
+            sweep_advance(sweep, active, &num_active, &next_edge, sweep->events[next_event++]);
+        }
+
+        bool dentro;
+        bool ambiguous = next_event > 0 && sweep->events[next_event - 1] == p.y;
+        if (!ambiguous) {
+            // Primeira aresta ativa com p à sua esquerda; as seguintes cruzam o raio para a direita
+            int lo = 0, hi = num_active;
+            while (lo < hi) {
+                int mid = (lo + hi) / 2;
+                int side = orientation(edges[active[mid]].a, edges[active[mid]].b, p);
+                if (side == 0) {
+                    ambiguous = true;
+                    break;
+                }
+                if (side == 2) hi = mid;
+                else lo = mid + 1;
+            }
+            dentro = ((num_active - lo) & 1) != 0;
+        }
+        if (ambiguous) {
+            dentro = kernel(polygon, n, p);
+            (*fallbacks)++;
+        }
+        total += dentro;
+        if (inside != NULL) inside[keys[s].index] = dentro;
+    }
+
+    free(active);
+    free(keys);
+    return total;
+}
+
+/**
+ * @brief Maps a coordinate pair onto the integer grid of a quantized polygon.
+ * @param quant Quantized polygon.
+ * @param p Point in polygon coordinates.
+ * @param qx Receives the grid x.
+ * @param qy Receives the grid y.
+ */
+static inline void quant_point(const QuantPolygon *quant, Point p, int32_t *qx, int32_t *qy) {
+    *qx = (int32_t) lround((p.x - quant->origin_x) * quant->scale);
+    *qy = (int32_t) lround((p.y - quant->origin_y) * quant->scale);
+}
+
+/**
+ * @brief Quantizes a polygon to a 30-bit integer grid and delta-encodes its edges in blocks.
+ *
+ * The grid covers the bounding box of the polygon and of the sampling domain [-1, 1] x [-1, 1], so
+ * samples share it. Every block stores its first vertex and the y range of its edges; the following
+ * vertices are stored as differences, in 16 bits when the whole block fits and 32 bits otherwise.
+ * Coordinates stay below 2^30, so every orientation product fits in 62 bits and is exact in int64.
+ *
+ * @param quant Structure to fill.
+ * @param polygon[] Polygon vertices.
+ * @param n Number of vertices.
+ * @return true on success.
+ */
+bool quant_build(QuantPolygon *quant, Point polygon[], int n) {
+    double min_x = -1.0, max_x = 1.0, min_y = -1.0, max_y = 1.0;
+    for (int i = 0; i < n; i++) {
+        min_x = fmin(min_x, polygon[i].x);
+        max_x = fmax(max_x, polygon[i].x);
+        min_y = fmin(min_y, polygon[i].y);
+        max_y = fmax(max_y, polygon[i].y);
+    }
+    quant->origin_x = min_x;
+    quant->origin_y = min_y;
+    quant->scale = (double) ((1 << QUANT_BITS) - 1) / fmax(max_x - min_x, max_y - min_y);
+    quant->n = n;
+    quant->num_blocks = (n + QUANT_BLOCK - 1) / QUANT_BLOCK;
+    quant->num_wide = 0;
+    quant->blocks = buffer_alloc(quant->num_blocks * sizeof(QuantBlock));
+    if (quant->blocks == NULL) return false;
+
+    // Primeira passagem: cabeçalho de cada bloco e largura dos seus deltas
+    int edges16 = 0, edges32 = 0;
+    for (int b = 0; b < quant->num_blocks; b++) {
+        QuantBlock *block = &quant->blocks[b];
+        int first = b * QUANT_BLOCK;
+        int count = first + QUANT_BLOCK <= n ? QUANT_BLOCK : n - first;
+        int32_t x, y;
+        quant_point(quant, polygon[first], &x, &y);
+        block->x0 = x;
+        block->y0 = y;
+        block->min_y = block->max_y = y;
+        block->count = (int16_t) count;
+        block->wide = 0;
+        for (int k = 0; k < count; k++) {
+            int32_t nx, ny;
+            quant_point(quant, polygon[(first + k + 1) % n], &nx, &ny);
+            if (nx - x < INT16_MIN || nx - x > INT16_MAX || ny - y < INT16_MIN || ny - y > INT16_MAX) block->wide = 1;
+            block->min_y = ny < block->min_y ? ny : block->min_y;
+            block->max_y = ny > block->max_y ? ny : block->max_y;
+            x = nx;
+            y = ny;
+        }
+        block->offset = 2 * (block->wide ? edges32 : edges16);
+        *(block->wide ? &edges32 : &edges16) += count;
+        quant->num_wide += block->wide;
+    }
+
+    quant->bytes = quant->num_blocks * sizeof(QuantBlock) + 2 * edges16 * sizeof(int16_t) + 2 * edges32 * sizeof(int32_t);
+    quant->deltas16 = buffer_alloc(2 * edges16 * sizeof(int16_t) + 1);
+    quant->deltas32 = buffer_alloc(2 * edges32 * sizeof(int32_t) + 1);
+    if (quant->deltas16 == NULL || quant->deltas32 == NULL) return false;
+
+    // Segunda passagem: diferenças entre vértices consecutivos
+    for (int b = 0; b < quant->num_blocks; b++) {
+        const QuantBlock *block = &quant->blocks[b];
+        int first = b * QUANT_BLOCK;
+        int32_t x = block->x0, y = block->y0;
+        for (int k = 0; k < block->count; k++) {
+            int32_t nx, ny;
+            quant_point(quant, polygon[(first + k + 1) % n], &nx, &ny);
+            if (block->wide) {
+                quant->deltas32[block->offset + 2 * k] = nx - x;
+                quant->deltas32[block->offset + 2 * k + 1] = ny - y;
+            } else {
+                quant->deltas16[block->offset + 2 * k] = (int16_t) (nx - x);
+                quant->deltas16[block->offset + 2 * k + 1] = (int16_t) (ny - y);
+            }
+            x = nx;
+            y = ny;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Point-in-polygon test on the quantized polygon, exact in integer arithmetic.
+ *
+ * The sample is mapped to the grid; blocks whose y range does not straddle it are skipped, the
+ * others are decoded into a small local buffer and their edges are tested with the crossing rule,
+ * the side of each straddling edge coming from the exact int64 cross product. Points on a
+ * straddling edge are inside. Uses the polygon built by quant_build (--quantize).
+ *
+ * @param polygon[] Unused; the quantized copy is used instead.
+ * @param n Unused.
+ * @param p Point to check.
+ * @return true if the point p is inside the polygon, else false.
+ */
+bool isInsideQuantized(Point polygon[], int n, Point p) {
+    (void) polygon;
+    (void) n;
+    const QuantPolygon *q = &quant;
+    int32_t px, py;
+    quant_point(q, p, &px, &py);
+
+    int32_t xs[QUANT_BLOCK + 1], ys[QUANT_BLOCK + 1];
+    int crossings = 0;
+    for (int b = 0; b < q->num_blocks; b++) {
+        const QuantBlock *block = &q->blocks[b];
+        if (py < block->min_y || py >= block->max_y) continue;
+
+        int count = block->count;
+        xs[0] = block->x0;
+        ys[0] = block->y0;
+        if (block->wide) {
+            const int32_t *d = q->deltas32 + block->offset;
+            for (int k = 0; k < count; k++) {
+                xs[k + 1] = xs[k] + d[2 * k];
+                ys[k + 1] = ys[k] + d[2 * k + 1];
+            }
+        } else {
+            const int16_t *d = q->deltas16 + block->offset;
+            for (int k = 0; k < count; k++) {
+                xs[k + 1] = xs[k] + d[2 * k];
+                ys[k + 1] = ys[k] + d[2 * k + 1];
+            }
+        }
+
+        // Sem ramos: cada aresta contribui com 0 ou 1 cruzamento e marca se p está sobre ela
+        int on_edge = 0;
+        for (int k = 0; k < count; k++) {
+            int straddle = (ys[k] > py) != (ys[k + 1] > py);
+            int64_t cross = (int64_t) (xs[k + 1] - xs[k]) * (py - ys[k]) - (int64_t) (ys[k + 1] - ys[k]) * (px - xs[k]);
+            crossings += straddle & ((cross > 0) == (ys[k + 1] > ys[k]));
+            on_edge |= straddle & (cross == 0);
+        }
+        if (on_edge) return true;
+    }
+    return (crossings & 1) != 0;
+}
+
+/**
+ * @brief Parses a CPU list such as "0-3,8,10-11".
+ * @param list Text to parse.
+ * @param cpus Output array of CPU numbers.
+ * @param max Capacity of cpus.
+ * @return Number of CPUs parsed.
+ */
+int parse_cpu_list(const char *list, int cpus[], int max) {
+    int count = 0;
+    const char *p = list;
+    while (*p != '\0' && count < max) {
+        char *end;
+        long first = strtol(p, &end, 10);
+        if (end == p) break;
+        long last = first;
+        if (*end == '-') {
+            p = end + 1;
+            last = strtol(p, &end, 10);
+        }
+        for (long c = first; c <= last && count < max; c++) cpus[count++] = (int) c;
+        p = (*end == ',') ? end + 1 : end;
+        if (*end != ',') break;
+    }
+    return count;
+}
+
+/**
+ * @brief Returns the NUMA node of a CPU, read from /sys/devices/system/node.
+ * @param cpu CPU number.
+ * @return Node number, or 0 if the topology is not available.
+ */
+int cpu_node(int cpu) {
+    for (int node = 0; node < 64; node++) {
+        char path[64], list[256];
+        snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist", node);
+        int fd = open(path, O_RDONLY);
+        if (fd < 0) continue;
+        ssize_t len = read(fd, list, sizeof(list) - 1);
+        close(fd);
+        if (len <= 0) continue;
+        list[len] = '\0';
+        int cpus[CPU_SETSIZE];
+        int count = parse_cpu_list(list, cpus, CPU_SETSIZE);
+        for (int i = 0; i < count; i++) {
+            if (cpus[i] == cpu) return node;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Computes the CPU of each worker for an affinity policy.
+ * @param policy "compact", "scatter" or an explicit CPU list.
+ * @param workers Number of workers.
+ * @param cpus Output array with one CPU per worker.
+ * @return true on success, false if the policy is invalid.
+ */
+bool affinity_plan(const char *policy, int workers, int cpus[]) {
+    int allowed[CPU_SETSIZE];
+    int count = 0;
+
+    if (strcmp(policy, "compact") != 0 && strcmp(policy, "scatter") != 0) {
+        count = parse_cpu_list(policy, allowed, CPU_SETSIZE);
+        if (count == 0) return false;
+        for (int i = 0; i < workers; i++) cpus[i] = allowed[i % count];
+        return true;
+    }
+
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (sched_getaffinity(0, sizeof(set), &set) < 0) return false;
+
+    // CPUs permitidos ordenados por nó, para que "compact" encha um nó de cada vez
+    int nodes[CPU_SETSIZE];
+    int num_nodes = 0;
+    for (int c = 0; c < CPU_SETSIZE; c++) {
+        if (!CPU_ISSET(c, &set)) continue;
+        int node = cpu_node(c);
+        int k = count++;
+        while (k > 0 && nodes[k - 1] > node) {
+            allowed[k] = allowed[k - 1];
+            nodes[k] = nodes[k - 1];
+            k--;
+        }
+        allowed[k] = c;
+        nodes[k] = node;
+        if (node + 1 > num_nodes) num_nodes = node + 1;
+    }
+    if (count == 0) return false;
+
+    if (strcmp(policy, "compact") == 0) {
+        for (int i = 0; i < workers; i++) cpus[i] = allowed[i % count];
+        return true;
+    }
+
+    // scatter: distribui os trabalhadores pelos nós de forma alternada
+    int used[CPU_SETSIZE] = {0};
+    for (int i = 0; i < workers; i++) {
+        int node = i % num_nodes;
+        int best = -1;
+        for (int k = 0; k < count; k++) {
+            if (nodes[k] == node && (best < 0 || used[k] < used[best])) best = k;
+        }
+        if (best < 0) best = i % count;
+        used[best]++;
+        cpus[i] = allowed[best];
+    }
+    return true;
+}
+
+/**
+ * @brief Pins the calling thread (or process) to a single CPU.
+ * @param cpu CPU number.
+ * @return true on success, else false.
+ */
+bool pin_to_cpu(int cpu) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    if (sched_setaffinity(0, sizeof(set), &set) < 0) {
+        perror("Erro ao definir a afinidade de CPU");
+        return false;
+    }
+    return true;
+}
+
+// Função que cada thread executa no modo exato: soma parcial da fórmula de shoelace
+void *shoelace_thread(void *arg) {
+    ShoelaceData *data = (ShoelaceData *) arg;
+    Point origin = data->polygon[0];
+    double sum = 0.0, compensation = 0.0;
+
+    // Coordenadas relativas ao primeiro vértice e soma compensada (Neumaier)
+    // para não perder precisão com milhões de vértices
+    for (int i = data->start; i < data->end; i++) {
+        Point a = data->polygon[i];
+        Point b = data->polygon[(i + 1) % data->n];
+        double term = (a.x - origin.x) * (b.y - origin.y) - (b.x - origin.x) * (a.y - origin.y);
+        double t = sum + term;
+        if (fabs(sum) >= fabs(term))
+            compensation += (sum - t) + term;
+        else
+            compensation += (term - t) + sum;
+        sum = t;
+    }
+    data->sum = sum + compensation;
+    pthread_exit(NULL);
+}
+
+/**
+ * @brief Computes the exact area of a simple polygon with the shoelace formula, in parallel.
+ * @param polygon Polygon vertices.
+ * @param n Number of vertices.
+ * @param num_threads Number of threads sharing the edges.
+ * @return Area of the polygon.
+ */
+double shoelace_area(Point *polygon, int n, int num_threads) {
+    if (num_threads > n) num_threads = n;
+    pthread_t threads[num_threads];
+    ShoelaceData data[num_threads];
+    int per_thread = n / num_threads;
+    int extra = n % num_threads;
+    int start = 0;
+
+    for (int i = 0; i < num_threads; i++) {
+        data[i].polygon = polygon;
+        data[i].n = n;
+        data[i].start = start;
+        data[i].end = start + per_thread + (i < extra ? 1 : 0);
+        start = data[i].end;
+        pthread_create(&threads[i], NULL, shoelace_thread, &data[i]);
+    }
+
+    double sum = 0.0;
+    for (int i = 0; i < num_threads; i++) {
+        pthread_join(threads[i], NULL);
+        sum += data[i].sum;
+    }
+    return fabs(sum) / 2.0;
+}
+
+/**
+ * @brief Radical inverse of i in the given base (van der Corput sequence), used by the QMC sampler.
+ * @param i Index of the sample.
+ * @param base Prime base.
+ * @return Value in [0, 1).
+ */
+double radical_inverse(unsigned int i, unsigned int base) {
+    double inv = 1.0 / base, f = inv, r = 0.0;
+    while (i > 0) {
+        r += f * (i % base);
+        i /= base;
+        f *= inv;
+    }
+    return r;
+}
+
+/**
+ * @brief Estimates the area with num_samples samples of the chosen sampler over [-1, 1] x [-1, 1].
+ * @param sampler 0 = pseudo-random (rand), 1 = QMC (Halton 2,3), 2 = jittered stratified.
+ * @param polygon Polygon vertices.
+ * @param n Number of vertices.
+ * @param kernel Classification kernel chosen by select_kernel.
+ * @param num_samples Number of samples.
+ * @return Estimated area.
+ */
+double estimate_with_sampler(int sampler, Point *polygon, int n, InsideFn kernel, int num_samples) {
+    int inside = 0;
+    int k = (int) sqrt((double) num_samples); // Estratos por eixo no amostrador estratificado
+
+    for (int i = 0; i < num_samples; i++) {
+        Point p;
+        if (sampler == 1) {
+            p.x = radical_inverse(i + 1, 2) * 2.0 - 1.0;
+            p.y = radical_inverse(i + 1, 3) * 2.0 - 1.0;
+        } else if (sampler == 2 && i < k * k) {
+            p.x = ((i % k) + (double) rand() / RAND_MAX) / k * 2.0 - 1.0;
+            p.y = ((i / k) + (double) rand() / RAND_MAX) / k * 2.0 - 1.0;
+        } else {
+            p.x = (double) rand() / RAND_MAX * 2.0 - 1.0;
+            p.y = (double) rand() / RAND_MAX * 2.0 - 1.0;
+        }
+        if (kernel(polygon, n, p)) inside++;
+    }
+    return (double) inside / num_samples * 4.0;
+}
+
+/**
+ * @brief Validation mode: error of every sampler against the exact area, as a function of samples and CPU time.
+ *
+ * Prints a CSV table (sampler;samples;estimate;abs_error;rel_error;cpu_s;ok) ready to be plotted.
+ * A row is flagged when the error exceeds 5 standard errors of a binomial estimate,
+ * which points at a regression in the classification kernel.
+ *
+ * @param polygon Polygon vertices.
+ * @param n Number of vertices.
+ * @param kernel Classification kernel chosen by select_kernel.
+ * @param exact Exact area of the polygon.
+ * @param max_samples Largest number of samples to try.
+ * @return Number of flagged rows.
+ */
+int validate_samplers(Point *polygon, int n, InsideFn kernel, double exact, int max_samples) {
+    const char *names[] = {"aleatorio", "qmc", "estratificado"};
+    int suspeitos = 0;
+
+    printf("amostrador;amostras;estimativa;erro_abs;erro_rel;tempo_cpu_s;ok\n");
+    for (int sampler = 0; sampler < 3; sampler++) {
+        for (long long samples = 1000; samples <= max_samples; samples *= 10) {
+            struct timespec t0, t1;
+            clock_gettime(CLOCK_THREAD_CPUTIME_ID, &t0);
+            double estimate = estimate_with_sampler(sampler, polygon, n, kernel, (int) samples);
+            clock_gettime(CLOCK_THREAD_CPUTIME_ID, &t1);
+            double cpu = (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9;
+
+            double p = exact / 4.0;
+            double se = 4.0 * sqrt(p * (1.0 - p) / samples);
+            double error = fabs(estimate - exact);
+            bool ok = error <= 5.0 * se + 1e-12;
+            if (!ok) suspeitos++;
+            printf("%s;%lld;%.8f;%.3e;%.3e;%.6f;%s\n", names[sampler], samples, estimate, error,
+                   exact > 0 ? error / exact : 0.0, cpu, ok ? "sim" : "SUSPEITO");
+        }
+    }
+    return suspeitos;
+}
+
+/**
+ * @brief Benchmarks the classification kernels available for this polygon on the same samples.
+ *
+ * Every kernel runs single-threaded over all the samples; the table reports throughput,
+ * speedup over the generic loop and whether the inside count matches it.
+ *
+ * @param polygon Polygon vertices.
+ * @param n Number of vertices.
+ * @param convex Whether the polygon is convex.
+ * @param points Samples.
+ * @param count Number of samples.
+ */
+void bench_kernels(Point *polygon, int n, bool convex, Point *points, int count) {
+    const char *names[3] = {"generico", "desenrolado", "cunha"};
+    InsideFn kernels[3] = {isInsidePolygon, n <= MAX_FIXED_N ? fixed_kernels[n] : NULL, convex ? isInsideConvex : NULL};
+    double base = 0.0;
+    int base_inside = 0;
+
+    printf("nucleo;Mamostras/s;aceleracao;dentro;igual\n");
+    for (int k = 0; k < 3; k++) {
+        if (kernels[k] == NULL) continue;
+        struct timespec t0, t1;
+        int inside = 0;
+        clock_gettime(CLOCK_MONOTONIC, &t0);
+        for (int i = 0; i < count; i++) inside += kernels[k](polygon, n, points[i]);
+        clock_gettime(CLOCK_MONOTONIC, &t1);
+        double elapsed = (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9;
+        double rate = count / elapsed / 1e6;
+        if (k == 0) {
+            base = rate;
+            base_inside = inside;
+        }
+        printf("%s;%.2f;%.2fx;%d;%s\n", names[k], rate, rate / base, inside, inside == base_inside ? "sim" : "NAO");
+    }
+}
+
+/**
+ * @brief Counter-based splitmix64: the 64-bit value at position index of the stream of seed.
+ * @param seed Seed of the run.
+ * @param index Position in the stream.
+ * @return Pseudo-random 64-bit value; any position can be computed without the ones before it.
+ */
+uint64_t splitmix64_at(uint64_t seed, uint64_t index) {
+    uint64_t z = seed + (index + 1) * 0x9E3779B97F4A7C15ULL;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+/**
+ * @brief Seeds the lanes of block c of the vector generator.
+ *
+ * Every lane of every block gets its own 256-bit state from splitmix64, the seeding recommended for
+ * xoshiro, so the streams are independent and sample k of a run depends only on the seed, not on the
+ * number of threads.
+ */
+void vector_rng_seed(VectorRng *rng, uint64_t seed, uint64_t block) {
+    for (int l = 0; l < VRNG_LANES; l++) {
+        for (int k = 0; k < 4; k++) rng->s[k][l] = splitmix64_at(seed, (block * VRNG_LANES + l) * 4 + k);
+    }
+}
+
+/**
+ * @brief Next VRNG_LANES samples of [-1, 1) x [-1, 1), one per lane, left in vector registers.
+ *
+ * Each coordinate takes the top 52 bits of an xoshiro256+ output as the mantissa of a double in [1, 2).
+ */
+static inline __attribute__((always_inline)) void vector_rng_points(VectorRng *rng, F64Lanes *x, F64Lanes *y) {
+    U64Lanes *s = rng->s;
+    U64Lanes v[2];
+    for (int c = 0; c < 2; c++) {
+        v[c] = s[0] + s[3];
+        U64Lanes t = s[1] << 17;
+        s[2] ^= s[0];
+        s[3] ^= s[1];
+        s[1] ^= s[2];
+        s[0] ^= s[3];
+        s[2] ^= t;
+        s[3] = (s[3] << 45) | (s[3] >> 19);
+    }
+    *x = (F64Lanes) ((v[0] >> 12) | 0x3FF0000000000000ULL) * 2.0 - 3.0;
+    *y = (F64Lanes) ((v[1] >> 12) | 0x3FF0000000000000ULL) * 2.0 - 3.0;
+}
+
+/**
+ * @brief Crossing-number test of VRNG_LANES samples at once, with the orientation filter per lane.
+ *
+ * Lanes at the height of a vertex, on an edge or where the filter is inconclusive are classified by
+ * the kernel, so the result is the same as testing each sample on its own. The ray is unbounded, so
+ * the polygon must lie left of x = 2.5, where the kernel's ray ends.
+ *
+ * @param edges The n edges of the polygon, lower endpoint first.
+ * @param lanes Number of valid lanes (fewer than VRNG_LANES only at the end of a block).
+ * @return Number of valid lanes whose sample is inside.
+ */
+static inline __attribute__((always_inline)) int inside_lanes(const SweepEdge *edges, Point polygon[], int n, InsideFn kernel,
+                                                              const F64Lanes *x, const F64Lanes *y, int lanes, long *fallbacks) {
+    F64Lanes px = *x, py = *y;
+    I64Lanes paridade = {0}, degenerado = {0};
+    for (int e = 0; e < n; e++) {
+        const SweepEdge *a = &edges[e];
+        I64Lanes alcance = (py >= a->a.y) & (py <= a->b.y);
+        bool algum = false;
+        for (int l = 0; l < VRNG_LANES; l++) algum |= alcance[l] != 0;
+        if (!algum) continue;
+
+        // Mesma expressão e limite de erro que orientation(a, b, p)
+        F64Lanes left = (a->b.y - a->a.y) * (px - a->b.x);
+        F64Lanes right = (a->b.x - a->a.x) * (py - a->b.y);
+        F64Lanes val = left - right;
+        F64Lanes bound = ORIENT_ERRBOUND * ((F64Lanes) ((I64Lanes) left & INT64_MAX) + (F64Lanes) ((I64Lanes) right & INT64_MAX));
+        I64Lanes esquerda = -val > bound;
+        I64Lanes incerto = (val <= bound) & (-val <= bound);
+        paridade ^= alcance & esquerda;
+        degenerado |= alcance & (incerto | (py == a->a.y) | (py == a->b.y));
+    }
+    int dentro = 0;
+    for (int l = 0; l < lanes; l++) {
+        if (degenerado[l]) {
+            (*fallbacks)++;
+            dentro += kernel(polygon, n, (Point) {px[l], py[l]});
+        } else {
+            dentro += paridade[l] != 0;
+        }
+    }
+    return dentro;
+}
+
+// Função que cada thread irá executar para processar pontos
+void *worker_thread(void *arg) {
+    ThreadData *data = (ThreadData *)arg;
+    int local_inside = 0;
+    int count = data->end - data->start;
+    Point *points = data->points + data->start;
+    Point *polygon = data->polygon;
+    Point *local_points = NULL, *local_polygon = NULL;
+
+    // Com afinidade, a thread copia o polígono e a sua fatia de amostras depois de fixada no CPU,
+    // para que as páginas sejam tocadas primeiro (e alocadas) no nó local
+    if (data->cpu >= 0 && pin_to_cpu(data->cpu)) {
+        size_t used = 0;
+        local_polygon = arena_local_alloc(data->index, &used, data->num_polygon_points * sizeof(Point));
+        local_points = data->vector_rng ? NULL : arena_local_alloc(data->index, &used, count * sizeof(Point));
+        if (local_polygon != NULL && (local_points != NULL || data->vector_rng)) {
+            memcpy(local_polygon, polygon, data->num_polygon_points * sizeof(Point));
+            if (local_points != NULL) memcpy(local_points, points, count * sizeof(Point));
+            polygon = local_polygon;
+            points = local_points;
+        }
+    }
+    data->cpu_real = sched_getcpu();
+
+    // Gerador vetorial: cada bloco é gerado e classificado VRNG_LANES amostras de cada vez, sem passar por memória
+    for (int bloco = data->start; data->vector_rng && bloco < data->end; bloco += VRNG_BLOCK) {
+        int tamanho = bloco + VRNG_BLOCK < data->end ? VRNG_BLOCK : data->end - bloco;
+        VectorRng rng;
+        vector_rng_seed(&rng, data->seed, bloco / VRNG_BLOCK);
+        for (int j = 0; j < tamanho; j += VRNG_LANES) {
+            F64Lanes px, py;
+            vector_rng_points(&rng, &px, &py);
+            int vias = tamanho - j < VRNG_LANES ? tamanho - j : VRNG_LANES;
+            if (data->lane_edges != NULL) {
+                local_inside += inside_lanes(data->lane_edges, polygon, data->num_polygon_points, data->kernel, &px, &py,
+                                             vias, &data->fallbacks);
+            } else {
+                for (int l = 0; l < vias; l++) local_inside += data->kernel(polygon, data->num_polygon_points, (Point) {px[l], py[l]});
+            }
+        }
+        pthread_mutex_lock(data->mutex);
+        *(data->total_processed) += tamanho;
+        pthread_mutex_unlock(data->mutex);
+    }
+
+    // Varrimento: a fatia é classificada por lotes, o progresso avança um lote de cada vez
+    for (int lote = 0; data->sweep != NULL && lote < count; lote += SWEEP_BATCH) {
+        int tamanho = lote + SWEEP_BATCH < count ? SWEEP_BATCH : count - lote;
+        local_inside += sweep_classify(data->sweep, polygon, data->num_polygon_points, data->kernel, points + lote,
+                                       tamanho, NULL, &data->fallbacks);
+        pthread_mutex_lock(data->mutex);
+        *(data->total_processed) += tamanho;
+        pthread_mutex_unlock(data->mutex);
+    }
+
+    for (int i = 0; data->sweep == NULL && !data->vector_rng && i < count; i++) {
+        if (classify_sample(data->edges, polygon, data->num_polygon_points, data->kernel, points[i],
+                            &data->fallbacks)) {
+            local_inside++;
+        }
+
+        // Incrementa o total de pontos processados com mutex
+        pthread_mutex_lock(data->mutex);
+        (*(data->total_processed))++;
+        pthread_mutex_unlock(data->mutex);
+    }
+
+    // Atualiza o total de pontos dentro do polígono com mutex
+    pthread_mutex_lock(data->mutex);
+    *(data->total_inside) += local_inside;
+    pthread_mutex_unlock(data->mutex);
+
+    buffer_free(local_points);
+    buffer_free(local_polygon);
+    prefilter_collect();
+
+    pthread_exit(NULL);
+}
+
+/**
+ * @brief Contribution of one edge to the crossing parity of the horizontal ray from p to the right.
+ * @param e Edge with its lower endpoint first.
+ * @param p Sample.
+ * @return 1 if the ray crosses the edge, 2 if p lies at the height of an endpoint or on the edge
+ *         (left to the kernel), else 0.
+ */
+static inline int edge_crossing(const SweepEdge *e, Point p) {
+    if (p.y < e->a.y || p.y > e->b.y) return 0;
+    if (p.y == e->a.y || p.y == e->b.y) return 2;
+    if (p.x > e->a.x && p.x > e->b.x) return 0;
+    if (p.x < e->a.x && p.x < e->b.x) return 1;
+    int side = orientation(e->a, e->b, p);
+    return side == 0 ? 2 : side == 2;
+}
+
+/**
+ * @brief Worker of the edge-parallel mode: owns a contiguous range of edges instead of a range of samples.
+ *
+ * For each batch of EDGE_BATCH samples the thread computes the crossing parity of every sample against
+ * its own edges, walking them in tiles of EDGE_TILE so that the tile and the batch stay in L1. After a
+ * barrier each thread XOR-reduces the parities of a slice of the batch over all the rows, and a second
+ * barrier frees the rows for the next batch. Degenerate samples are classified by the kernel.
+ */
+void *edge_worker(void *arg) {
+    ThreadData *data = (ThreadData *)arg;
+    EdgeParallel *shared = data->edge_parallel;
+    int n = data->num_polygon_points, m = data->end - data->start;
+    int local_inside = 0;
+
+    // A fatia de arestas é copiada depois de fixada a thread, para ficar no nó e na cache do seu CPU
+    if (data->cpu >= 0) pin_to_cpu(data->cpu);
+    data->cpu_real = sched_getcpu();
+    size_t used = 0;
+    SweepEdge *edges = arena_local_alloc(data->index, &used, (m > 0 ? m : 1) * sizeof(SweepEdge));
+    if (edges == NULL) {
+        perror("Erro ao alocar memória para as arestas");
+        exit(EXIT_FAILURE);
+    }
+    for (int i = 0; i < m; i++) {
+        Point a = data->polygon[data->start + i], b = data->polygon[(data->start + i + 1) % n];
+        edges[i] = a.y < b.y ? (SweepEdge) {a, b} : (SweepEdge) {b, a};
+    }
+
+    unsigned char *row = shared->parity + (size_t) data->index * EDGE_BATCH;
+    for (int lote = 0; lote < shared->num_points; lote += EDGE_BATCH) {
+        int tamanho = lote + EDGE_BATCH < shared->num_points ? EDGE_BATCH : shared->num_points - lote;
+        const Point *points = data->points + lote;
+
+        memset(row, 0, tamanho);
+        for (int e0 = 0; e0 < m; e0 += EDGE_TILE) {
+            int e1 = e0 + EDGE_TILE < m ? e0 + EDGE_TILE : m;
+            for (int j = 0; j < tamanho; j++) {
+                int paridade = 0, degenerado = 0;
+                for (int e = e0; e < e1; e++) {
+                    int c = edge_crossing(&edges[e], points[j]);
+                    paridade ^= c;
+                    degenerado |= c;
+                }
+                row[j] = ((row[j] ^ paridade) & 1) | ((row[j] | degenerado) & 2);
+            }
+        }
+        pthread_barrier_wait(&shared->barrier);
+
+        // Redução XOR da fatia desta thread sobre as linhas de todas as threads
+        int j0 = (int) ((long) tamanho * data->index / shared->num_workers);
+        int j1 = (int) ((long) tamanho * (data->index + 1) / shared->num_workers);
+        for (int j = j0; j < j1; j++) {
+            int paridade = 0, degenerado = 0;
+            for (int w = 0; w < shared->num_workers; w++) {
+                paridade ^= shared->parity[(size_t) w * EDGE_BATCH + j];
+                degenerado |= shared->parity[(size_t) w * EDGE_BATCH + j];
+            }
+            if (degenerado & 2) {
+                data->fallbacks++;
+                if (data->kernel(data->polygon, n, points[j])) local_inside++;
+            } else if (paridade & 1) {
+                local_inside++;
+            }
+        }
+        pthread_mutex_lock(data->mutex);
+        *(data->total_processed) += j1 - j0;
+        pthread_mutex_unlock(data->mutex);
+        pthread_barrier_wait(&shared->barrier);
+    }
+
+    pthread_mutex_lock(data->mutex);
+    *(data->total_inside) += local_inside;
+    pthread_mutex_unlock(data->mutex);
+
+    buffer_free(edges);
+    prefilter_collect();
+
+    pthread_exit(NULL);
+}
+
+// Função que a thread de progresso irá executar para mostrar o progresso
+void *progress_thread(void *arg) {
+    ProgressData *progress_data = (ProgressData *)arg;
+
+    while (1) {
+        sleep(1);
+        // Calcula o progresso do processamento com mutex
+        pthread_mutex_lock(progress_data->mutex);
+        int progress = (*(progress_data->total_processed) * 100) / progress_data->num_random_points;
+        pthread_mutex_unlock(progress_data->mutex);
+        char progress_msg[128];
+        snprintf(progress_msg, sizeof(progress_msg), "\rProgresso: %d%%", progress);
+        write(STDOUT_FILENO, progress_msg, strlen(progress_msg));
+        fflush(stdout);
+        if (progress >= 100) break;
+    }
+
+    pthread_exit(NULL);
+}
+/**
+ * @brief Returns sample number k of the counter-based sampler, uniform in [-1, 1] x [-1, 1].
+ * @param seed Seed of the run.
+ * @param k Global index of the sample.
+ * @return The sample; the same (seed, k) always gives the same point (as in reqCD and reqEserver).
+ */
+Point lease_sample(uint64_t seed, uint64_t k) {
+    Point p;
+    p.x = (double) (splitmix64_at(seed, 2 * k) >> 11) * 0x1.0p-53 * 2.0 - 1.0;
+    p.y = (double) (splitmix64_at(seed, 2 * k + 1) >> 11) * 0x1.0p-53 * 2.0 - 1.0;
+    return p;
+}
+
+/**
+ * @brief FNV-1a hash of the polygon vertices, recorded in the checkpoint header.
+ * @param polygon Polygon vertices.
+ * @param n Number of vertices.
+ * @return 64-bit hash.
+ */
+uint64_t polygon_hash(Point polygon[], int n) {
+    uint64_t h = 0xcbf29ce484222325ULL;
+    const unsigned char *bytes = (const unsigned char *) polygon;
+    for (size_t i = 0; i < n * sizeof(Point); i++) {
+        h ^= bytes[i];
+        h *= 0x100000001b3ULL;
+    }
+    return h;
+}
+
+/**
+ * @brief Writes a header and a record array atomically: the data goes to "<path>.tmp", is fsync'ed and then renamed over path.
+ *
+ * A crash at any point leaves either the previous file or the new one, never a partial file.
+ *
+ * @param path Destination file.
+ * @param header Header bytes.
+ * @param header_size Size of the header.
+ * @param records Record bytes.
+ * @param records_size Size of the records.
+ * @return true on success.
+ */
+bool write_file_atomic(const char *path, const void *header, size_t header_size, const void *records, size_t records_size) {
+    char tmp[4096];
+    snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+    int fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) return false;
+
+    bool ok = write(fd, header, header_size) == (ssize_t) header_size &&
+              write(fd, records, records_size) == (ssize_t) records_size &&
+              fsync(fd) == 0;
+    ok = close(fd) == 0 && ok;
+    if (!ok || rename(tmp, path) != 0) {
+        unlink(tmp);
+        return false;
+    }
+    return true;
+}
+
+bool checkpoint_write(const char *path, const CheckpointHeader *job, const CheckpointWorker states[]) {
+    return write_file_atomic(path, job, sizeof(*job), states, job->num_workers * sizeof(CheckpointWorker));
+}
+
+/**
+ * @brief Reads a checkpoint written by checkpoint_write.
+ * @param path Checkpoint file.
+ * @param job Receives the job parameters.
+ * @return Per-worker state (job->num_workers entries, to be freed by the caller), or NULL if the file is invalid.
+ */
+CheckpointWorker *checkpoint_read(const char *path, CheckpointHeader *job) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return NULL;
+
+    CheckpointWorker *states = NULL;
+    if (read(fd, job, sizeof(*job)) == (ssize_t) sizeof(*job) && job->magic == CHECKPOINT_MAGIC &&
+        job->sampler == SAMPLER_SPLITMIX64 && job->chunk > 0 && job->num_workers > 0 && job->num_workers <= 4096) {
+        size_t states_size = job->num_workers * sizeof(CheckpointWorker);
+        states = malloc(states_size);
+        if (states != NULL && read(fd, states, states_size) != (ssize_t) states_size) {
+            free(states);
+            states = NULL;
+        }
+    }
+    close(fd);
+    return states;
+}
+
+void stop_handler(int sig) {
+    (void) sig;
+    stop_requested = 1;
+}
+
+void *stream_worker(void *arg) {
+    StreamData *data = (StreamData *)arg;
+    const CheckpointHeader *job = data->job;
+    uint64_t num_chunks = (job->num_points + job->chunk - 1) / job->chunk;
+
+    // O trabalhador faz os blocos next_chunk, next_chunk + num_workers, ...; as amostras são geradas
+    // pelo índice global, por isso retomar um bloco não depende do que foi sorteado antes
+    for (uint64_t c = data->state.next_chunk; c < num_chunks && !stop_requested; c += job->num_workers) {
+        uint64_t start = c * job->chunk;
+        uint64_t end = start + job->chunk < job->num_points ? start + job->chunk : job->num_points;
+        uint64_t inside = 0;
+        for (uint64_t k = start; k < end; k++) {
+            inside += classify_sample(data->edges, data->polygon, data->n, data->kernel, lease_sample(job->seed, k),
+                                      &data->fallbacks);
+        }
+
+        // Estado publicado só com o bloco completo: um checkpoint nunca vê um bloco a meio
+        pthread_mutex_lock(data->mutex);
+        data->state.next_chunk = c + job->num_workers;
+        data->state.processed += end - start;
+        data->state.inside += inside;
+        pthread_mutex_unlock(data->mutex);
+    }
+    prefilter_collect();
+
+    pthread_exit(NULL);
+}
+
+/**
+ * @brief Copies the published state of every worker and writes it as a checkpoint.
+ * @param cp Checkpoint thread data.
+ * @param states Scratch buffer with job->num_workers entries.
+ * @return true on success.
+ */
+bool checkpoint_snapshot(CheckpointData *cp, CheckpointWorker states[]) {
+    struct timespec t0, t1;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    pthread_mutex_lock(cp->mutex);
+    for (uint32_t i = 0; i < cp->job->num_workers; i++) states[i] = cp->workers[i].state;
+    pthread_mutex_unlock(cp->mutex);
+    bool ok = checkpoint_write(cp->path, cp->job, states);
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    cp->writes++;
+    cp->write_time += (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9;
+    return ok;
+}
+
+void *checkpoint_thread(void *arg) {
+    CheckpointData *cp = (CheckpointData *)arg;
+    CheckpointWorker *states = malloc(cp->job->num_workers * sizeof(CheckpointWorker));
+    int seconds = 0;
+
+    while (states != NULL) {
+        sleep(1);
+        pthread_mutex_lock(cp->mutex);
+        int done = cp->done;
+        uint64_t processed = 0;
+        for (uint32_t i = 0; i < cp->job->num_workers; i++) processed += cp->workers[i].state.processed;
+        pthread_mutex_unlock(cp->mutex);
+        if (done) break;
+
+        char progress_msg[128];
+        snprintf(progress_msg, sizeof(progress_msg), "\rProgresso: %.1f%%", 100.0 * processed / cp->job->num_points);
+        write(STDOUT_FILENO, progress_msg, strlen(progress_msg));
+
+        if (++seconds >= cp->interval) {
+            seconds = 0;
+            if (!checkpoint_snapshot(cp, states)) {
+                char error[] = "\nAviso: falha ao escrever o checkpoint.\n";
+                write(STDERR_FILENO, error, strlen(error));
+            }
+        }
+    }
+
+    free(states);
+    pthread_exit(NULL);
+}
+
+/**
+ * @brief Runs (or resumes) a long estimation with periodic checkpoints.
+ *
+ * Samples come from the counter-based sampler in blocks of job->chunk; block c belongs to worker
+ * c % num_workers. Each worker publishes its next block and its processed/inside counts only when a
+ * block is complete, and a separate thread copies that state to the checkpoint file every interval
+ * seconds. SIGINT/SIGTERM stop the workers at the end of their current block and a final checkpoint
+ * is written, so --resume never samples a completed block again.
+ *
+ * @param polygon Polygon vertices.
+ * @param n Number of vertices.
+ * @param kernel Point-in-polygon test.
+ * @param edges Float32 edges for --float, or NULL.
+ * @param job Job parameters.
+ * @param states Initial per-worker state (fresh or read from the checkpoint).
+ * @param path Checkpoint file.
+ * @param interval Seconds between checkpoints.
+ * @return true if every sample was classified, false if the run was stopped or a checkpoint failed.
+ */
+bool run_checkpointed(Point *polygon, int n, InsideFn kernel, const FloatEdges *edges, const CheckpointHeader *job,
+                      const CheckpointWorker states[], const char *path, int interval) {
+    int num_workers = job->num_workers;
+    pthread_t *threads = malloc(num_workers * sizeof(pthread_t));
+    StreamData *workers = malloc(num_workers * sizeof(StreamData));
+    CheckpointWorker *final = malloc(num_workers * sizeof(CheckpointWorker));
+    pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+    if (threads == NULL || workers == NULL || final == NULL) {
+        perror("Erro ao alocar memória para as threads");
+        exit(EXIT_FAILURE);
+    }
+
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = stop_handler;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+
+    uint64_t processed_before = 0;
+    for (int i = 0; i < num_workers; i++) processed_before += states[i].processed;
+
+    struct timespec t_inicio, t_fim;
+    clock_gettime(CLOCK_MONOTONIC, &t_inicio);
+
+    for (int i = 0; i < num_workers; i++) {
+        workers[i].polygon = polygon;
+        workers[i].n = n;
+        workers[i].kernel = kernel;
+        workers[i].edges = edges;
+        workers[i].job = job;
+        workers[i].state = states[i];
+        workers[i].fallbacks = 0;
+        workers[i].mutex = &mutex;
+        pthread_create(&threads[i], NULL, stream_worker, &workers[i]);
+    }
+
+    CheckpointData cp = {
+            .path = path,
+            .job = job,
+            .workers = workers,
+            .interval = interval,
+            .done = 0,
+            .writes = 0,
+            .write_time = 0.0,
+            .mutex = &mutex
+    };
+    pthread_t checkpoint_tid;
+    pthread_create(&checkpoint_tid, NULL, checkpoint_thread, &cp);
+
+    for (int i = 0; i < num_workers; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t_fim);
+
+    pthread_mutex_lock(&mutex);
+    cp.done = 1;
+    pthread_mutex_unlock(&mutex);
+    pthread_join(checkpoint_tid, NULL);
+
+    // Checkpoint final: após uma paragem é o ponto de retoma; após o fim regista o resultado
+    bool ok = checkpoint_snapshot(&cp, final);
+
+    uint64_t processed = 0, inside = 0;
+    for (int i = 0; i < num_workers; i++) {
+        processed += final[i].processed;
+        inside += final[i].inside;
+    }
+    bool complete = processed == job->num_points;
+    double elapsed = (t_fim.tv_sec - t_inicio.tv_sec) + (t_fim.tv_nsec - t_inicio.tv_nsec) / 1e9;
+
+    if (complete) {
+        printf("\nÁrea estimada do polígono: %.6f unidades quadradas\n", (double) inside / processed * 4.0);
+    } else {
+        printf("\nInterrompido: %llu de %llu amostras (estimativa parcial %.6f); continue com --resume\n",
+               (unsigned long long) processed, (unsigned long long) job->num_points,
+               processed > 0 ? (double) inside / processed * 4.0 : 0.0);
+    }
+    printf("Checkpoint: %s (semente %llu, %u trabalhadores), %d escritas em %.3f s (%.3f%% do tempo), %.2f Mamostras/s\n",
+           path, (unsigned long long) job->seed, job->num_workers, cp.writes, cp.write_time,
+           elapsed > 0.0 ? 100.0 * cp.write_time / elapsed : 0.0,
+           elapsed > 0.0 ? (processed - processed_before) / elapsed / 1e6 : 0.0);
+    prefilter_report();
+    if (!ok) {
+        char error[] = "Erro: falha ao escrever o checkpoint final.\n";
+        write(STDERR_FILENO, error, strlen(error));
+    }
+
+    free(final);
+    free(workers);
+    free(threads);
+    return complete && ok;
+}
+void *store_worker(void *arg) {
+    StoreWorker *data = (StoreWorker *)arg;
 
-/**
- * @brief Determines the orientation of an ordered triplet (p, q, r).
- * @param p First point of the triplet.
- * @param q Second point of the triplet.
- * @param r Third point of the triplet.
- * @return 0 if p, q, and r are colinear, 1 if clockwise, 2 if counterclockwise.
- */
-int orientation(Point p, Point q, Point r) {
-    double val = (q.y - p.y) * (r.x - q.x) - (q.x - p.x) * (r.y - q.y);
+    while (1) {
+        uint64_t w = __atomic_fetch_add(data->next, 1, __ATOMIC_RELAXED);
+        if (w >= data->num_work) break;
+        StoreWork *work = &data->work[w];
+        uint64_t inside = 0;
+        for (uint64_t k = work->start; k < work->end; k++) {
+            inside += classify_sample(data->edges, data->polygon, data->n, data->kernel, lease_sample(data->seed, k),
+                                      &data->fallbacks);
+        }
+        work->inside = inside;
+    }
+    prefilter_collect();
 
-    if (val == 0) return 0;
-    return (val > 0) ? 1 : 2;
+    pthread_exit(NULL);
 }
 
 /**
- * @brief Checks if point q lies on line segment pr.
- * @param p First point of the line segment.
- * @param q Point to check.
- * @param r Second point of the line segment.
- * @return true if point q lies on line segment pr, else false.
+ * @brief Reads the stored segments of one key of the result store.
+ * @param path Store file of the key.
+ * @param expected Header the file must match (magic, sampler, seed, polygon and block size).
+ * @param num_segments Receives the number of segments.
+ * @return The segments (to be freed by the caller), or NULL if the file is missing, empty or belongs to another key.
  */
-bool onSegment(Point p, Point q, Point r) {
-    if (q.x <= fmax(p.x, r.x) && q.x >= fmin(p.x, r.x) &&
-        q.y <= fmax(p.y, r.y) && q.y >= fmin(p.y, r.y))
-        return true;
+StoreSegment *store_read(const char *path, const StoreHeader *expected, uint64_t *num_segments) {
+    *num_segments = 0;
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return NULL;
 
-    return false;
+    StoreHeader header;
+    StoreSegment *segments = NULL;
+    if (read(fd, &header, sizeof(header)) == (ssize_t) sizeof(header) && header.magic == expected->magic &&
+        header.sampler == expected->sampler && header.seed == expected->seed &&
+        header.polygon_hash == expected->polygon_hash && header.num_vertices == expected->num_vertices &&
+        header.chunk == expected->chunk && header.num_segments > 0) {
+        size_t size = header.num_segments * sizeof(StoreSegment);
+        segments = malloc(size);
+        if (segments != NULL && read(fd, segments, size) == (ssize_t) size) {
+            *num_segments = header.num_segments;
+        } else {
+            free(segments);
+            segments = NULL;
+        }
+    }
+    close(fd);
+    return segments;
 }
 
 /**
- * @brief Checks if line segments p1q1 and p2q2 intersect.
- * @param p1 First point of the first line segment.
- * @param q1 Second point of the first line segment.
- * @param p2 First point of the second line segment.
- * @param q2 Second point of the second line segment.
- * @return true if line segments p1q1 and p2q2 intersect, else false.
+ * @brief Estimates the area from samples [0, num_points) of the counter-based sampler, reusing the result store.
+ *
+ * The store keeps, per key (polygon hash, sampler, seed), the inside count of each block of samples
+ * that was already classified. Only the samples not yet in the store are classified (spread over the
+ * threads), the new counts are merged and the file is replaced atomically. A repeated query reads the
+ * file and classifies nothing.
+ *
+ * @param dir Store directory.
+ * @param polygon Polygon vertices.
+ * @param n Number of vertices.
+ * @param hash FNV-1a hash of the vertices, as read from the file.
+ * @param kernel Point-in-polygon test.
+ * @param edges Float32 edges for --float, or NULL.
+ * @param seed Seed of the sampler.
+ * @param num_points Number of samples of the query.
+ * @param num_threads Threads for the missing samples.
+ * @return true on success.
  */
-bool doIntersect(Point p1, Point q1, Point p2, Point q2) {
-    int o1 = orientation(p1, q1, p2);
-    int o2 = orientation(p1, q1, q2);
-    int o3 = orientation(p2, q2, p1);
-    int o4 = orientation(p2, q2, q1);
+bool store_query(const char *dir, Point *polygon, int n, uint64_t hash, InsideFn kernel, const FloatEdges *edges,
+                 uint64_t seed, uint64_t num_points, int num_threads) {
+    char path[4096];
+    snprintf(path, sizeof(path), "%s/%016llx-%d-%llu.bin", dir, (unsigned long long) hash, SAMPLER_SPLITMIX64,
+             (unsigned long long) seed);
+    StoreHeader header = {
+            .magic = STORE_MAGIC,
+            .sampler = SAMPLER_SPLITMIX64,
+            .seed = seed,
+            .polygon_hash = hash,
+            .num_vertices = (uint32_t) n,
+            .reserved = 0,
+            .chunk = CHECKPOINT_CHUNK,
+            .num_segments = 0
+    };
 
-    if (o1 != o2 && o3 != o4)
-        return true;
+    struct timespec t0, t1;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
 
-    if (o1 == 0 && onSegment(p1, p2, q1)) return true;
-    if (o2 == 0 && onSegment(p1, q2, q1)) return true;
-    if (o3 == 0 && onSegment(p2, p1, q2)) return true;
-    if (o4 == 0 && onSegment(p2, q1, q2)) return true;
+    uint64_t num_stored;
+    StoreSegment *stored = store_read(path, &header, &num_stored);
+    uint64_t num_chunks = (num_points + header.chunk - 1) / header.chunk;
 
-    return false;
+    // Trabalho em falta: o resto de cada bloco guardado a meio, ou o bloco inteiro se não existir
+    StoreWork *work = malloc(num_chunks * sizeof(StoreWork));
+    if (work == NULL) {
+        perror("Erro ao alocar memória para o armazém");
+        exit(EXIT_FAILURE);
+    }
+    uint64_t num_work = 0, computed = 0;
+    for (uint64_t c = 0; c < num_chunks; c++) {
+        uint64_t start = c * header.chunk;
+        uint64_t end = start + header.chunk < num_points ? start + header.chunk : num_points;
+        uint64_t have = c < num_stored ? stored[c].end : start;
+        if (have == end) continue;
+        if (have < end) {
+            work[num_work] = (StoreWork) {c, have, end, 0, STORE_EXTEND};
+        } else if (have - end < end - start) {
+            work[num_work] = (StoreWork) {c, end, have, 0, STORE_SUFFIX};
+        } else {
+            work[num_work] = (StoreWork) {c, start, end, 0, STORE_PREFIX};
+        }
+        computed += work[num_work].end - work[num_work].start;
+        num_work++;
+    }
+
+    long fallbacks = 0;
+    if (num_work > 0) {
+        uint64_t next = 0;
+        int workers = (uint64_t) num_threads < num_work ? num_threads : (int) num_work;
+        pthread_t threads[workers];
+        StoreWorker data[workers];
+        for (int i = 0; i < workers; i++) {
+            data[i] = (StoreWorker) {polygon, n, kernel, edges, seed, work, num_work, &next, 0};
+            pthread_create(&threads[i], NULL, store_worker, &data[i]);
+        }
+        for (int i = 0; i < workers; i++) {
+            pthread_join(threads[i], NULL);
+            fallbacks += data[i].fallbacks;
+        }
+    }
+
+    // Junta as contagens guardadas e as novas; os blocos prolongados voltam ao armazém
+    uint64_t num_segments = num_chunks > num_stored ? num_chunks : num_stored;
+    StoreSegment *segments = calloc(num_segments, sizeof(StoreSegment));
+    if (segments == NULL) {
+        perror("Erro ao alocar memória para o armazém");
+        exit(EXIT_FAILURE);
+    }
+    for (uint64_t c = 0; c < num_segments; c++) {
+        if (c < num_stored) {
+            segments[c] = stored[c];
+        } else {
+            segments[c].start = segments[c].end = c * header.chunk;
+        }
+    }
+
+    uint64_t inside = 0;
+    bool changed = false;
+    uint64_t w = 0;
+    for (uint64_t c = 0; c < num_chunks; c++) {
+        if (w < num_work && work[w].chunk == c) {
+            if (work[w].mode == STORE_EXTEND) {
+                segments[c].end = work[w].end;
+                segments[c].inside += work[w].inside;
+                inside += segments[c].inside;
+                changed = true;
+            } else if (work[w].mode == STORE_SUFFIX) {
+                inside += segments[c].inside - work[w].inside;
+            } else {
+                inside += work[w].inside;
+            }
+            w++;
+        } else {
+            inside += segments[c].inside;
+        }
+    }
+
+    bool ok = true;
+    if (changed) {
+        header.num_segments = num_segments;
+        ok = write_file_atomic(path, &header, sizeof(header), segments, num_segments * sizeof(StoreSegment));
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    double elapsed = (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9;
+
+    printf("Área estimada do polígono: %.6f unidades quadradas\n", (double) inside / num_points * 4.0);
+    printf("Armazém: %s (semente %llu): %llu amostras classificadas de novo, %.3f s\n", path,
+           (unsigned long long) seed, (unsigned long long) computed, elapsed);
+    if (edges != NULL && computed > 0) {
+        printf("Modo float: %ld amostras reavaliadas em double (%.4f%%)\n", fallbacks, 100.0 * fallbacks / computed);
+    }
+    prefilter_report();
+    if (!ok) {
+        char error[] = "Erro: falha ao atualizar o armazém.\n";
+        write(STDERR_FILENO, error, strlen(error));
+    }
+
+    free(segments);
+    free(work);
+    free(stored);
+    return ok;
 }
 
-/**
- * @brief Checks if a point p is inside a polygon of n points.
- * @param polygon[] Array of points forming the polygon.
- * @param n Number of points in the polygon.
- * @param p Point to check.
- * @return true if the point p is inside the polygon, else false.
- */
-bool isInsidePolygon(Point polygon[], int n, Point p) {
-    if (n < 3) return false;
+// Relógio monotónico em segundos
+static inline double pipeline_clock(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec / 1e9;
+}
 
-    Point extreme = {2.5, p.y};
+// Prepara um anel com capacity ranhuras (potência de 2) de slot_size bytes
+bool spsc_init(SpscRing *ring, uint64_t capacity, size_t slot_size) {
+    memset(ring, 0, sizeof(*ring));
+    ring->slots = buffer_alloc(capacity * slot_size);
+    ring->slot_size = slot_size;
+    ring->capacity = capacity;
+    return ring->slots != NULL;
+}
 
-    int count = 0, i = 0;
-    do {
-        int next = (i + 1) % n;
+// Produtor: ranhura livre para o próximo elemento, ou NULL se o anel estiver cheio
+static inline void *spsc_reserve(SpscRing *ring) {
+    if (ring->head - ring->tail_cache == ring->capacity) {
+        ring->tail_cache = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+        if (ring->head - ring->tail_cache == ring->capacity) return NULL;
+    }
+    return ring->slots + (ring->head & (ring->capacity - 1)) * ring->slot_size;
+}
 
-        if (doIntersect(polygon[i], polygon[next], p, extreme)) {
-            if (orientation(polygon[i], p, polygon[next]) == 0)
-                return onSegment(polygon[i], p, polygon[next]);
-            count++;
-        }
-        i = next;
-    } while (i != 0);
+// Produtor: torna visível o elemento escrito na ranhura devolvida por spsc_reserve
+static inline void spsc_publish(SpscRing *ring) {
+    __atomic_store_n(&ring->head, ring->head + 1, __ATOMIC_RELEASE);
+}
 
-    return count & 1;
+// Consumidor: elemento mais antigo, ou NULL se o anel estiver vazio
+static inline void *spsc_peek(SpscRing *ring) {
+    if (ring->tail == ring->head_cache) {
+        ring->head_cache = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+        if (ring->tail == ring->head_cache) return NULL;
+    }
+    return ring->slots + (ring->tail & (ring->capacity - 1)) * ring->slot_size;
 }
-// Função que cada thread irá executar para processar pontos
-void *worker_thread(void *arg) {
-    ThreadData *data = (ThreadData *)arg;
-    int local_inside = 0;
 
-    for (int i = data->start; i < data->end; i++) {
-        if (isInsidePolygon(data->polygon, data->num_polygon_points, data->points[i])) {
-            local_inside++;
+// Consumidor: devolve ao produtor a ranhura do elemento lido
+static inline void spsc_release(SpscRing *ring) {
+    __atomic_store_n(&ring->tail, ring->tail + 1, __ATOMIC_RELEASE);
+}
+
+// Consumidor: true se o produtor fechou o anel e já não há elementos
+static inline bool spsc_done(SpscRing *ring) {
+    if (!__atomic_load_n(&ring->closed, __ATOMIC_ACQUIRE)) return false;
+    return __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE) == ring->tail;
+}
+
+// Gerador g: blocos g, g + G, ...; cada bloco vai para o primeiro anel com espaço a partir do último usado
+void *pipeline_generator(void *arg) {
+    PipelineStage *stage = (PipelineStage *)arg;
+    Pipeline *p = stage->pipeline;
+    SpscRing *rings = p->blocks + (size_t) stage->index * p->classifiers;
+    double start = pipeline_clock();
+    int next = 0;
+
+    for (uint64_t b = stage->index; b < p->num_blocks && !stop_requested; b += p->generators) {
+        SampleBlock *slot = NULL;
+        while (slot == NULL) {
+            for (int k = 0; k < p->classifiers && slot == NULL; k++) {
+                int c = (next + k) % p->classifiers;
+                if ((slot = spsc_reserve(&rings[c])) != NULL) next = c;
+            }
+            if (slot == NULL) {
+                stage->stalls++;
+                sched_yield();
+            }
         }
 
-        // Incrementa o total de pontos processados com mutex
-        pthread_mutex_lock(data->mutex);
-        (*(data->total_processed))++;
-        pthread_mutex_unlock(data->mutex);
+        double t0 = pipeline_clock();
+        uint64_t first = b * p->block;
+        slot->block = b;
+        slot->count = first + p->block < p->num_points ? p->block : (int) (p->num_points - first);
+        for (int i = 0; i < slot->count; i++) slot->points[i] = lease_sample(p->seed, first + i);
+        stage->busy += pipeline_clock() - t0;
+        spsc_publish(&rings[next]);
+        stage->processed += slot->count;
+        next = (next + 1) % p->classifiers;
     }
+    for (int c = 0; c < p->classifiers; c++) __atomic_store_n(&rings[c].closed, 1, __ATOMIC_RELEASE);
+    stage->elapsed = pipeline_clock() - start;
 
-    // Atualiza o total de pontos dentro do polígono com mutex
-    pthread_mutex_lock(data->mutex);
-    *(data->total_inside) += local_inside;
-    pthread_mutex_unlock(data->mutex);
+    pthread_exit(NULL);
+}
+
+// Classificador c: consome os anéis (g, c) de todos os geradores e publica a contagem de cada bloco
+void *pipeline_classifier(void *arg) {
+    PipelineStage *stage = (PipelineStage *)arg;
+    Pipeline *p = stage->pipeline;
+    SpscRing *out = &p->counts[stage->index];
+    double start = pipeline_clock();
+
+    while (1) {
+        bool consumiu = false, fim = true;
+        for (int g = 0; g < p->generators; g++) {
+            SpscRing *in = &p->blocks[(size_t) g * p->classifiers + stage->index];
+            SampleBlock *slot = spsc_peek(in);
+            if (slot == NULL) {
+                fim &= spsc_done(in);
+                continue;
+            }
+            fim = false;
+
+            double t0 = pipeline_clock();
+            int inside = 0;
+            for (int i = 0; i < slot->count; i++) {
+                inside += classify_sample(p->edges, p->polygon, p->n, p->kernel, slot->points[i], &stage->fallbacks);
+            }
+            stage->busy += pipeline_clock() - t0;
+
+            BlockCount *count;
+            while ((count = spsc_reserve(out)) == NULL) {
+                stage->stalls++;
+                sched_yield();
+            }
+            *count = (BlockCount) {slot->block, slot->count, inside};
+            spsc_publish(out);
+            spsc_release(in);
+            stage->inside += inside;
+            stage->processed += slot->count;
+            consumiu = true;
+        }
+        if (fim) break;
+        if (!consumiu) {
+            stage->stalls++;
+            sched_yield();
+        }
+    }
+    __atomic_store_n(&out->closed, 1, __ATOMIC_RELEASE);
+    stage->elapsed = pipeline_clock() - start;
+    prefilter_collect();
 
     pthread_exit(NULL);
 }
 
-// Função que a thread de progresso irá executar para mostrar o progresso
-void *progress_thread(void *arg) {
-    ProgressData *progress_data = (ProgressData *)arg;
+// Agregador: soma as contagens por bloco e mostra o progresso
+void *pipeline_aggregator(void *arg) {
+    PipelineStage *stage = (PipelineStage *)arg;
+    Pipeline *p = stage->pipeline;
+    double start = pipeline_clock(), last = start;
 
     while (1) {
-        sleep(1);
-        // Calcula o progresso do processamento com mutex
-        pthread_mutex_lock(progress_data->mutex);
-        int progress = (*(progress_data->total_processed) * 100) / progress_data->num_random_points;
-        pthread_mutex_unlock(progress_data->mutex);
-        char progress_msg[128];
-        snprintf(progress_msg, sizeof(progress_msg), "\rProgresso: %d%%", progress);
-        write(STDOUT_FILENO, progress_msg, strlen(progress_msg));
-        fflush(stdout);
-        if (progress >= 100) break;
+        bool consumiu = false, fim = true;
+        double t0 = pipeline_clock();
+        for (int c = 0; c < p->classifiers; c++) {
+            BlockCount *count;
+            while ((count = spsc_peek(&p->counts[c])) != NULL) {
+                stage->inside += count->inside;
+                stage->processed += count->count;
+                spsc_release(&p->counts[c]);
+                consumiu = true;
+            }
+            fim &= spsc_done(&p->counts[c]);
+        }
+        double now = pipeline_clock();
+        if (consumiu) stage->busy += now - t0;
+        if (now - last >= 1.0) {
+            printf("\rProgresso: %.1f%%", 100.0 * stage->processed / p->num_points);
+            fflush(stdout);
+            last = now;
+        }
+        if (fim) break;
+        if (!consumiu) {
+            stage->stalls++;
+            sched_yield();
+        }
     }
+    stage->elapsed = pipeline_clock() - start;
 
     pthread_exit(NULL);
 }
+
+// Resumo de um estágio: ocupação média das threads e passagens à espera
+void pipeline_report(const char *name, const PipelineStage stages[], int count) {
+    double busy = 0.0, elapsed = 0.0;
+    long stalls = 0;
+    for (int i = 0; i < count; i++) {
+        busy += stages[i].busy;
+        elapsed += stages[i].elapsed;
+        stalls += stages[i].stalls;
+    }
+    printf("  %s (%d): %.3g%% do tempo ocupados (%.3g s), %ld esperas\n", name, count,
+           elapsed > 0.0 ? 100.0 * busy / elapsed : 0.0, busy, stalls);
+}
+
+/**
+ * @brief Estimates the area with a staged pipeline: generator threads, classifier threads and an aggregator.
+ *
+ * Generators fill fixed-size blocks of samples of the counter-based sampler (block b holds samples
+ * [b * block, (b + 1) * block)) into single-producer/single-consumer rings, one per (generator,
+ * classifier) pair; the block buffers live in the ring slots and are reused once the classifier
+ * releases them. Each classifier publishes the inside count of every block into its own ring, and the
+ * aggregator sums them. The estimate depends only on the seed and the number of samples, so it matches
+ * the checkpoint and store modes; the per-stage busy times show whether RNG or geometry is the bottleneck.
+ *
+ * @param polygon Polygon vertices.
+ * @param n Number of vertices.
+ * @param kernel Point-in-polygon test.
+ * @param edges Float32 edges for --float, or NULL.
+ * @param seed Seed of the sampler.
+ * @param num_points Number of samples.
+ * @param generators Generator threads.
+ * @param classifiers Classifier threads.
+ * @param block Samples per block.
+ * @return true if every sample was classified.
+ */
+bool run_pipeline(Point *polygon, int n, InsideFn kernel, const FloatEdges *edges, uint64_t seed,
+                  uint64_t num_points, int generators, int classifiers, int block) {
+    Pipeline p = {
+            .generators = generators,
+            .classifiers = classifiers,
+            .block = block,
+            .num_points = num_points,
+            .num_blocks = (num_points + block - 1) / block,
+            .seed = seed,
+            .polygon = polygon,
+            .n = n,
+            .kernel = kernel,
+            .edges = edges
+    };
+    int num_rings = generators * classifiers;
+    p.blocks = aligned_alloc(64, num_rings * sizeof(SpscRing));
+    p.counts = aligned_alloc(64, classifiers * sizeof(SpscRing));
+    if (p.blocks == NULL || p.counts == NULL) {
+        perror("Erro ao alocar memória para o pipeline");
+        exit(EXIT_FAILURE);
+    }
+    for (int r = 0; r < num_rings; r++) {
+        Point *buffers = buffer_alloc((size_t) PIPELINE_SLOTS * block * sizeof(Point));
+        if (!spsc_init(&p.blocks[r], PIPELINE_SLOTS, sizeof(SampleBlock)) || buffers == NULL) {
+            perror("Erro ao alocar memória para o pipeline");
+            exit(EXIT_FAILURE);
+        }
+        for (int k = 0; k < PIPELINE_SLOTS; k++) ((SampleBlock *) p.blocks[r].slots)[k].points = buffers + (size_t) k * block;
+    }
+    for (int c = 0; c < classifiers; c++) {
+        if (!spsc_init(&p.counts[c], PIPELINE_RESULTS, sizeof(BlockCount))) {
+            perror("Erro ao alocar memória para o pipeline");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = stop_handler;
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+
+    PipelineStage gen[generators], cls[classifiers], agg = {&p, 0, 0.0, 0.0, 0, 0, 0, 0};
+    pthread_t gen_tid[generators], cls_tid[classifiers], agg_tid;
+    double t0 = pipeline_clock();
+    for (int c = 0; c < classifiers; c++) {
+        cls[c] = (PipelineStage) {&p, c, 0.0, 0.0, 0, 0, 0, 0};
+        pthread_create(&cls_tid[c], NULL, pipeline_classifier, &cls[c]);
+    }
+    for (int g = 0; g < generators; g++) {
+        gen[g] = (PipelineStage) {&p, g, 0.0, 0.0, 0, 0, 0, 0};
+        pthread_create(&gen_tid[g], NULL, pipeline_generator, &gen[g]);
+    }
+    pthread_create(&agg_tid, NULL, pipeline_aggregator, &agg);
+    for (int g = 0; g < generators; g++) pthread_join(gen_tid[g], NULL);
+    for (int c = 0; c < classifiers; c++) pthread_join(cls_tid[c], NULL);
+    pthread_join(agg_tid, NULL);
+    double elapsed = pipeline_clock() - t0;
+
+    long fallbacks = 0;
+    for (int c = 0; c < classifiers; c++) fallbacks += cls[c].fallbacks;
+    bool completo = agg.processed == num_points;
+    if (completo) {
+        printf("\rProgresso: 100.0%%\nÁrea estimada do polígono: %.6f unidades quadradas\n", (double) agg.inside / num_points * 4.0);
+    } else {
+        printf("\nInterrompido: %llu de %llu amostras classificadas\n", (unsigned long long) agg.processed,
+               (unsigned long long) num_points);
+    }
+    printf("Pipeline (semente %llu): blocos de %d amostras, %.3f s, %.2f Mamostras/s\n", (unsigned long long) seed,
+           block, elapsed, agg.processed / elapsed / 1e6);
+    pipeline_report("Geradores", gen, generators);
+    pipeline_report("Classificadores", cls, classifiers);
+    pipeline_report("Agregador", &agg, 1);
+    if (edges != NULL) {
+        printf("Modo float: %ld amostras reavaliadas em double (%.4f%%)\n", fallbacks, 100.0 * fallbacks / agg.processed);
+    }
+    prefilter_report();
+
+    for (int r = 0; r < num_rings; r++) {
+        buffer_free(((SampleBlock *) p.blocks[r].slots)[0].points);
+        buffer_free(p.blocks[r].slots);
+    }
+    for (int c = 0; c < classifiers; c++) buffer_free(p.counts[c].slots);
+    free(p.blocks);
+    free(p.counts);
+    return completo;
+}
+
 int main(int argc, char *argv[]) {
-    if (argc != 4) {
-        char usage[] = "Uso: <arquivo_do_poligono> <num_threads> <num_pontos_aleatorios>\n";
+    char usage[] = "Uso: <arquivo_do_poligono> <num_threads> <num_pontos_aleatorios> [--affinity <compact|scatter|lista_de_cpus>] [--exact] [--validate] [--float] [--bench] [--checkpoint <ficheiro> [--checkpoint-every <segundos>] [--resume] [--seed <semente>]] [--store <diretoria> [--seed <semente>]] [--prefilter] [--sweep] [--arena] [--page-faults] [--quantize] [--edge-parallel] [--simd-rng [--seed <semente>]] [--pipeline <geradores>,<classificadores> [--pipeline-block <amostras>] [--seed <semente>]]\n";
+    if (argc < 4) {
         write(STDERR_FILENO, usage, strlen(usage));
         exit(EXIT_FAILURE);
     }
 
     char *poligono = argv[1];
     int num_threads = atoi(argv[2]);
-    int num_pontos_aleatorios = atoi(argv[3]);
+    long long amostras = atoll(argv[3]);
+    int num_pontos_aleatorios = amostras > INT_MAX ? INT_MAX : (int) amostras;
+    char *afinidade = NULL;
+    bool exato = false;
+    bool validar = false;
+    bool usar_float = false;
+    bool bench = false;
+    bool pre_filtro = false;
+    bool varrimento = false;
+    bool usar_arena = false;
+    bool quantizar = false;
+    bool por_arestas = false;
+    bool gerador_vetorial = false;
+    int geradores = 0, classificadores = 0;
+    int bloco_pipeline = PIPELINE_BLOCK;
+    bool relatorio_faltas = false;
+    char *checkpoint_path = NULL;
+    char *store_dir = NULL;
+    int checkpoint_every = 10;
+    bool retomar = false;
+    bool tem_semente = false;
+    uint64_t semente = 0;
+
+    // Opções adicionais
+    for (int a = 4; a < argc; a++) {
+        if (strcmp(argv[a], "--affinity") == 0 && a + 1 < argc) {
+            afinidade = argv[++a];
+        } else if (strcmp(argv[a], "--exact") == 0) {
+            exato = true;
+        } else if (strcmp(argv[a], "--validate") == 0) {
+            validar = true;
+        } else if (strcmp(argv[a], "--float") == 0) {
+            usar_float = true;
+        } else if (strcmp(argv[a], "--bench") == 0) {
+            bench = true;
+        } else if (strcmp(argv[a], "--prefilter") == 0) {
+            pre_filtro = true;
+        } else if (strcmp(argv[a], "--sweep") == 0) {
+            varrimento = true;
+        } else if (strcmp(argv[a], "--arena") == 0) {
+            usar_arena = true;
+            relatorio_faltas = true;
+        } else if (strcmp(argv[a], "--quantize") == 0) {
+            quantizar = true;
+        } else if (strcmp(argv[a], "--edge-parallel") == 0) {
+            por_arestas = true;
+        } else if (strcmp(argv[a], "--simd-rng") == 0) {
+            gerador_vetorial = true;
+        } else if (strcmp(argv[a], "--pipeline") == 0 && a + 1 < argc) {
+            if (sscanf(argv[++a], "%d,%d", &geradores, &classificadores) != 2 || geradores <= 0 || classificadores <= 0) {
+                write(STDERR_FILENO, usage, strlen(usage));
+                exit(EXIT_FAILURE);
+            }
+        } else if (strcmp(argv[a], "--pipeline-block") == 0 && a + 1 < argc) {
+            bloco_pipeline = atoi(argv[++a]);
+        } else if (strcmp(argv[a], "--page-faults") == 0) {
+            relatorio_faltas = true;
+        } else if (strcmp(argv[a], "--checkpoint") == 0 && a + 1 < argc) {
+            checkpoint_path = argv[++a];
+        } else if (strcmp(argv[a], "--checkpoint-every") == 0 && a + 1 < argc) {
+            checkpoint_every = atoi(argv[++a]);
+        } else if (strcmp(argv[a], "--store") == 0 && a + 1 < argc) {
+            store_dir = argv[++a];
+        } else if (strcmp(argv[a], "--resume") == 0) {
+            retomar = true;
+        } else if (strcmp(argv[a], "--seed") == 0 && a + 1 < argc) {
+            semente = strtoull(argv[++a], NULL, 10);
+            tem_semente = true;
+        } else {
+            write(STDERR_FILENO, usage, strlen(usage));
+            exit(EXIT_FAILURE);
+        }
+    }
 
-    if (num_threads <= 0 || num_pontos_aleatorios <= 0) {
+    if (num_threads <= 0 || amostras <= 0) {
         char error[] = "Erro: Número de threads e pontos deve ser maior que 0.\n";
         write(STDERR_FILENO, error, strlen(error));
         exit(EXIT_FAILURE);
     }
+    // Sem checkpoint nem armazém as amostras são guardadas em memória; acima de INT_MAX só os modos por blocos servem
+    bool pipeline = geradores > 0;
+    if ((checkpoint_path == NULL && store_dir == NULL && !pipeline && amostras > INT_MAX) || (retomar && checkpoint_path == NULL) ||
+        (checkpoint_path != NULL && store_dir != NULL) || (pipeline && (checkpoint_path != NULL || store_dir != NULL)) ||
+        checkpoint_every <= 0 || bloco_pipeline <= 0) {
+        write(STDERR_FILENO, usage, strlen(usage));
+        exit(EXIT_FAILURE);
+    }
 
     int arquivo = open(poligono, O_RDONLY);
     if (arquivo < 0) {
@@ -177,21 +2898,29 @@ int main(int argc, char *argv[]) {
         exit(EXIT_FAILURE);
     }
 
-    Point *polygon = malloc(MAX_POINTS * sizeof(Point));
+    // Com --arena o polígono acaba copiado para a arena: começa pequeno e cresce, em vez de MAX_POINTS
+    int capacity = usar_arena ? 4096 : MAX_POINTS;
+    Point *polygon = malloc(capacity * sizeof(Point));
     if (polygon == NULL) {
         perror("Erro ao alocar memória para o polígono");
         close(arquivo);
         exit(EXIT_FAILURE);
     }
 
-    int capacity = MAX_POINTS;
     int n = 0;
     char buffer[128];
+    size_t pending = 0;
     ssize_t bytesRead;
     char *line, *saveptr;
 
-    while ((bytesRead = read(arquivo, buffer, sizeof(buffer) - 1)) > 0) {
-        buffer[bytesRead] = '\0';
+    // Uma linha partida entre duas leituras fica no início do buffer e é completada pela leitura seguinte
+    while ((bytesRead = read(arquivo, buffer + pending, sizeof(buffer) - 1 - pending)) >= 0) {
+        size_t len = pending + bytesRead;
+        buffer[len] = '\0';
+        char *cut = bytesRead > 0 ? strrchr(buffer, '\n') : NULL;
+        size_t used = cut != NULL ? (size_t) (cut - buffer) + 1 : len;
+        char saved = buffer[used];
+        buffer[used] = '\0';
         line = strtok_r(buffer, "\n", &saveptr);
         while (line != NULL) {
             if (sscanf(line, "%lf %lf", &polygon[n].x, &polygon[n].y) == 2) {
@@ -208,10 +2937,19 @@ int main(int argc, char *argv[]) {
             }
             line = strtok_r(NULL, "\n", &saveptr);
         }
+        if (bytesRead == 0) break;
+        buffer[used] = saved;
+        pending = len - used;
+        memmove(buffer, buffer + used, pending);
     }
 
     close(arquivo);
 
+    uint64_t hash = polygon_hash(polygon, n);
+
+    // Convexidade e orientação detetadas uma vez; polígonos convexos usam o teste em cunha O(log n)
+    bool convex = polygon_convexity(polygon, &n);
+
     if (n < 3) {
         char error[] = "Polígono inválido ou dados insuficientes no arquivo.\n";
         write(STDERR_FILENO, error, strlen(error));
@@ -219,17 +2957,239 @@ int main(int argc, char *argv[]) {
         exit(EXIT_FAILURE);
     }
 
-    Point *pontos = malloc(num_pontos_aleatorios * sizeof(Point));
-    if (pontos == NULL) {
-        perror("Erro ao alocar memória para pontos");
+    // Arena: polígono, arestas, índices e amostras num só mapeamento em páginas enormes, pré-faltado em paralelo
+    long faltas_arena = 0, faltas_maiores = 0;
+    if (usar_arena) {
+        bool amostras_em_memoria = checkpoint_path == NULL && store_dir == NULL && !pipeline && (!gerador_vetorial || bench);
+        size_t bytes = n * sizeof(Point)                                      // polígono
+                       + 2 * (n + 1) * sizeof(float)                           // arestas float
+                       + n * (sizeof(SweepEdge) + sizeof(double))              // varrimento
+                       + (2 * n + 1) * sizeof(Point)                           // pré-filtro
+                       + (n / QUANT_BLOCK + 1) * sizeof(QuantBlock) + 2 * n * sizeof(int32_t) // quantizado
+                       + (por_arestas ? (size_t) num_threads * EDGE_BATCH : 0)
+                       + (por_arestas && afinidade == NULL ? (n + num_threads) * sizeof(SweepEdge) : 0)
+                       + (amostras_em_memoria ? (size_t) num_pontos_aleatorios * sizeof(Point) : 0)
+                       + 64 * ARENA_ALIGN;
+        // Com afinidade, as cópias locais de cada thread vão para uma subarena que só ela toca
+        size_t local = 0;
+        if (afinidade != NULL) {
+            if (amostras_em_memoria) {
+                local = (n + num_pontos_aleatorios / num_threads + num_pontos_aleatorios % num_threads) * sizeof(Point) + 2 * ARENA_ALIGN;
+            }
+            if (por_arestas && (n / num_threads + 2) * sizeof(SweepEdge) + ARENA_ALIGN > local) {
+                local = (n / num_threads + 2) * sizeof(SweepEdge) + ARENA_ALIGN;
+            }
+        }
+        long minor0, major0, minor1, major1;
+        page_faults(&minor0, &major0);
+        if (!arena_create(&arena, bytes, local, num_threads)) {
+            perror("Erro ao reservar a arena");
+            exit(EXIT_FAILURE);
+        }
+        arena_prefault(&arena, num_threads);
+        page_faults(&minor1, &major1);
+        faltas_arena = minor1 - minor0;
+        faltas_maiores = major1 - major0;
+
+        Point *copia = buffer_alloc(n * sizeof(Point));
+        if (copia == NULL) {
+            perror("Erro ao alocar memória para o polígono");
+            free(polygon);
+            exit(EXIT_FAILURE);
+        }
+        memcpy(copia, polygon, n * sizeof(Point));
         free(polygon);
-        exit(EXIT_FAILURE);
+        polygon = copia;
+
+        const char *modos[3] = {"páginas de 4 KB (sem THP)", "MAP_HUGETLB", "THP via madvise"};
+        char arena_msg[160];
+        snprintf(arena_msg, sizeof(arena_msg), "Arena: %zu MiB em %s, %ld faltas de página na pré-falta\n",
+                 arena.size >> 20, modos[arena.mode], faltas_arena);
+        write(STDOUT_FILENO, arena_msg, strlen(arena_msg));
+    }
+
+    InsideFn kernel = select_kernel(n, convex);
+
+    // Polígono quantizado numa grelha inteira de 30 bits, com deltas por bloco e predicados exatos em int64
+    if (quantizar) {
+        if (!quant_build(&quant, polygon, n)) {
+            perror("Erro ao quantizar o polígono");
+            exit(EXIT_FAILURE);
+        }
+        kernel = isInsideQuantized;
+        char quant_msg[200];
+        snprintf(quant_msg, sizeof(quant_msg), "Polígono quantizado: passo %.3g, %d blocos (%d com deltas de 32 bits), %.2f bytes/vértice (double: %zu)\n",
+                 1.0 / quant.scale, quant.num_blocks, quant.num_wide, (double) quant.bytes / n, sizeof(Point));
+        write(STDOUT_FILENO, quant_msg, strlen(quant_msg));
+        if (usar_float) {
+            char warning[] = "Aviso: --float ignorado com --quantize.\n";
+            write(STDERR_FILENO, warning, strlen(warning));
+            usar_float = false;
+        }
+    }
+
+    // Pré-filtro: caixa, invólucro, círculo inscrito e polígono simplificado antes do núcleo completo
+    if (pre_filtro) {
+        struct timespec t0, t1;
+        clock_gettime(CLOCK_MONOTONIC, &t0);
+        if (!prefilter_build(&prefilter, polygon, n, kernel)) {
+            perror("Erro ao construir o pré-filtro");
+            exit(EXIT_FAILURE);
+        }
+        clock_gettime(CLOCK_MONOTONIC, &t1);
+        kernel = isInsidePrefiltered;
+        char prefilter_msg[160];
+        snprintf(prefilter_msg, sizeof(prefilter_msg), "Pré-filtro: invólucro com %d vértices, raio inscrito %.4f, construído em %.3f s\n",
+                 prefilter.hull_n, sqrt(prefilter.r2), (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9);
+        write(STDOUT_FILENO, prefilter_msg, strlen(prefilter_msg));
+        if (usar_float) {
+            // O caminho float percorre todas as arestas antes do núcleo e anularia o pré-filtro
+            char warning[] = "Aviso: --float ignorado com --prefilter.\n";
+            write(STDERR_FILENO, warning, strlen(warning));
+            usar_float = false;
+        }
+    }
+
+    // Modo exato: área pela fórmula de shoelace, arestas repartidas pelas threads
+    if (exato || validar) {
+        struct timespec t0, t1;
+        clock_gettime(CLOCK_MONOTONIC, &t0);
+        double area = shoelace_area(polygon, n, num_threads);
+        clock_gettime(CLOCK_MONOTONIC, &t1);
+        double elapsed = (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9;
+
+        int suspeitos = 0;
+        if (exato) {
+            char exact_msg[128];
+            snprintf(exact_msg, sizeof(exact_msg), "Área exata do polígono: %.10f unidades quadradas (%d vértices, %.6f s)\n",
+                     area, n, elapsed);
+            write(STDOUT_FILENO, exact_msg, strlen(exact_msg));
+        }
+        if (validar) {
+            // O domínio de amostragem é [-1, 1] x [-1, 1]; fora dele as estimativas ficam enviesadas
+            for (int i = 0; i < n; i++) {
+                if (fabs(polygon[i].x) > 1.0 || fabs(polygon[i].y) > 1.0) {
+                    char warning[] = "Aviso: o polígono sai do domínio de amostragem [-1, 1] x [-1, 1].\n";
+                    write(STDERR_FILENO, warning, strlen(warning));
+                    break;
+                }
+            }
+            srand((unsigned int)time(NULL));
+            suspeitos = validate_samplers(polygon, n, kernel, area, num_pontos_aleatorios);
+        }
+        buffer_free(polygon);
+        exit(suspeitos > 0 ? EXIT_FAILURE : EXIT_SUCCESS);
+    }
+
+    // Modo float: arestas em float32 (SoA); amostras incertas são reavaliadas em double
+    FloatEdges float_edges = {NULL, NULL, 0, 0.0f, 0.0f};
+    if (usar_float && !float_edges_build(&float_edges, polygon, n, 1.0)) {
+        char warning[] = "Aviso: polígono fora do alcance do modo float; a usar apenas double.\n";
+        write(STDERR_FILENO, warning, strlen(warning));
+        usar_float = false;
+    }
+
+    // Armazém de resultados: só as amostras ainda não guardadas para (polígono, amostrador, semente) são classificadas
+    if (store_dir != NULL) {
+        bool ok = store_query(store_dir, polygon, n, hash, kernel, usar_float ? &float_edges : NULL, semente,
+                              (uint64_t) amostras, num_threads);
+        buffer_free(float_edges.x);
+        buffer_free(float_edges.y);
+        buffer_free(polygon);
+        exit(ok ? EXIT_SUCCESS : EXIT_FAILURE);
+    }
+
+    // Pipeline: geradores, classificadores e agregador em threads próprias, ligados por anéis SPSC
+    if (pipeline) {
+        if (!tem_semente) semente = ((uint64_t) time(NULL) << 20) ^ (uint64_t) getpid();
+        bool completo = run_pipeline(polygon, n, kernel, usar_float ? &float_edges : NULL, semente, (uint64_t) amostras,
+                                     geradores, classificadores, bloco_pipeline);
+        buffer_free(float_edges.x);
+        buffer_free(float_edges.y);
+        buffer_free(polygon);
+        exit(completo ? EXIT_SUCCESS : EXIT_FAILURE);
+    }
+
+    // Execuções longas com checkpoints: amostras geradas por blocos, nunca guardadas em memória
+    if (checkpoint_path != NULL) {
+        CheckpointHeader job;
+        CheckpointWorker *states = NULL;
+        if (retomar && (states = checkpoint_read(checkpoint_path, &job)) != NULL) {
+            if (job.polygon_hash != hash || job.num_vertices != (uint32_t) n) {
+                char error[] = "Erro: o checkpoint pertence a outro polígono.\n";
+                write(STDERR_FILENO, error, strlen(error));
+                exit(EXIT_FAILURE);
+            }
+            // Os parâmetros da tarefa vêm do checkpoint; a repartição em blocos tem de ser a mesma
+            if (job.num_points != (uint64_t) amostras || job.num_workers != (uint32_t) num_threads ||
+                (tem_semente && job.seed != semente)) {
+                char warning[] = "Aviso: a retomar com as amostras, threads e semente do checkpoint.\n";
+                write(STDERR_FILENO, warning, strlen(warning));
+            }
+        } else {
+            if (retomar) {
+                char warning[] = "Aviso: checkpoint inexistente ou inválido; a começar do início.\n";
+                write(STDERR_FILENO, warning, strlen(warning));
+            }
+            if (!tem_semente) semente = ((uint64_t) time(NULL) << 20) ^ (uint64_t) getpid();
+            job = (CheckpointHeader) {
+                    .magic = CHECKPOINT_MAGIC,
+                    .sampler = SAMPLER_SPLITMIX64,
+                    .seed = semente,
+                    .num_points = (uint64_t) amostras,
+                    .chunk = CHECKPOINT_CHUNK,
+                    .polygon_hash = hash,
+                    .num_vertices = (uint32_t) n,
+                    .num_workers = (uint32_t) num_threads
+            };
+            states = calloc(num_threads, sizeof(CheckpointWorker));
+            if (states == NULL) {
+                perror("Erro ao alocar memória para o checkpoint");
+                exit(EXIT_FAILURE);
+            }
+            for (int i = 0; i < num_threads; i++) states[i].next_chunk = i;
+        }
+
+        bool completo = run_checkpointed(polygon, n, kernel, usar_float ? &float_edges : NULL, &job, states,
+                                         checkpoint_path, checkpoint_every);
+        free(states);
+        buffer_free(float_edges.x);
+        buffer_free(float_edges.y);
+        buffer_free(polygon);
+        exit(completo ? EXIT_SUCCESS : EXIT_FAILURE);
+    }
+
+    long faltas[3], maiores[3];
+    page_faults(&faltas[0], &maiores[0]);
+
+    if (gerador_vetorial && bench) {
+        char warning[] = "Aviso: --simd-rng ignorado com --bench.\n";
+        write(STDERR_FILENO, warning, strlen(warning));
+        gerador_vetorial = false;
+    }
+
+    // Com o gerador vetorial as amostras nascem nas threads e nunca são guardadas
+    Point *pontos = NULL;
+    if (!gerador_vetorial) {
+        pontos = buffer_alloc(num_pontos_aleatorios * sizeof(Point));
+        if (pontos == NULL) {
+            perror("Erro ao alocar memória para pontos");
+            buffer_free(polygon);
+            exit(EXIT_FAILURE);
+        }
+
+        srand((unsigned int)time(NULL));
+        for (int i = 0; i < num_pontos_aleatorios; i++) {
+            pontos[i].x = (double) rand() / RAND_MAX * 2.0 - 1.0;
+            pontos[i].y = (double) rand() / RAND_MAX * 2.0 - 1.0;
+        }
     }
 
-    srand((unsigned int)time(NULL));
-    for (int i = 0; i < num_pontos_aleatorios; i++) {
-        pontos[i].x = (double) rand() / RAND_MAX * 2.0 - 1.0;
-        pontos[i].y = (double) rand() / RAND_MAX * 2.0 - 1.0;
+    if (bench) {
+        bench_kernels(polygon, n, convex, pontos, num_pontos_aleatorios);
+        buffer_free(pontos);
+        buffer_free(polygon);
+        exit(EXIT_SUCCESS);
     }
 
     // Aloca memória para as threads e os dados das threads
@@ -243,6 +3203,81 @@ int main(int argc, char *argv[]) {
     int points_per_thread = num_pontos_aleatorios / num_threads;
     int remaining_points = num_pontos_aleatorios % num_threads;
 
+    // Plano de colocação das threads nos CPUs
+    int cpus[num_threads];
+    for (int i = 0; i < num_threads; i++) cpus[i] = -1;
+    if (afinidade != NULL && !affinity_plan(afinidade, num_threads, cpus)) {
+        char error[] = "Erro: Política de afinidade inválida.\n";
+        write(STDERR_FILENO, error, strlen(error));
+        exit(EXIT_FAILURE);
+    }
+
+    // Varrimento por lotes com tabela de arestas ativas, em vez de um teste por amostra
+    SweepPolygon sweep = {NULL, 0, NULL, 0};
+    if (varrimento) {
+        if (!sweep_build(&sweep, polygon, n)) {
+            char warning[] = "Aviso: polígono fora do alcance do varrimento (x >= 2.5 ou arestas que se cruzam); a classificar amostra a amostra.\n";
+            write(STDERR_FILENO, warning, strlen(warning));
+            varrimento = false;
+        } else if (usar_float) {
+            char warning[] = "Aviso: --float ignorado com --sweep.\n";
+            write(STDERR_FILENO, warning, strlen(warning));
+            usar_float = false;
+        }
+    }
+
+    // Gerador vetorial: --float, --sweep e --edge-parallel precisam das amostras em memória
+    SweepEdge *lane_edges = NULL;
+    if (gerador_vetorial) {
+        if (usar_float || varrimento || por_arestas) {
+            char warning[] = "Aviso: --float, --sweep e --edge-parallel ignorados com --simd-rng.\n";
+            write(STDERR_FILENO, warning, strlen(warning));
+            usar_float = varrimento = por_arestas = false;
+        }
+        if (!tem_semente) semente = ((uint64_t) time(NULL) << 20) ^ (uint64_t) getpid();
+        // Os núcleos convexo, pré-filtrado e quantizado não percorrem as arestas; nesses casos cada via usa o núcleo.
+        // O raio do núcleo acaba em x = 2.5: com vértices para lá disso as vias contariam outros cruzamentos
+        bool por_vias = !convex && !pre_filtro && !quantizar;
+        for (int i = 0; i < n && por_vias; i++) por_vias = polygon[i].x < 2.5;
+        if (por_vias) {
+            lane_edges = buffer_alloc(n * sizeof(SweepEdge));
+            if (lane_edges == NULL) {
+                perror("Erro ao alocar memória para as arestas");
+                exit(EXIT_FAILURE);
+            }
+            for (int i = 0; i < n; i++) {
+                Point a = polygon[i], b = polygon[(i + 1) % n];
+                lane_edges[i] = a.y < b.y ? (SweepEdge) {a, b} : (SweepEdge) {b, a};
+            }
+        }
+    }
+
+    // Modo por arestas: cada thread fica com um intervalo contíguo de arestas e todas as amostras
+    EdgeParallel edge_parallel = {.num_points = num_pontos_aleatorios, .num_workers = num_threads, .parity = NULL};
+    if (por_arestas) {
+        for (int i = 0; i < n && por_arestas; i++) por_arestas = polygon[i].x < 2.5;
+        if (!por_arestas) {
+            char warning[] = "Aviso: polígono fora do alcance do modo por arestas; a repartir as amostras.\n";
+            write(STDERR_FILENO, warning, strlen(warning));
+        } else {
+            if (usar_float || varrimento) {
+                char warning[] = "Aviso: --float e --sweep ignorados com --edge-parallel.\n";
+                write(STDERR_FILENO, warning, strlen(warning));
+                usar_float = varrimento = false;
+            }
+            edge_parallel.parity = buffer_alloc((size_t) num_threads * EDGE_BATCH);
+            if (edge_parallel.parity == NULL) {
+                perror("Erro ao alocar memória para as paridades");
+                exit(EXIT_FAILURE);
+            }
+            pthread_barrier_init(&edge_parallel.barrier, NULL, num_threads);
+        }
+    }
+
+    page_faults(&faltas[1], &maiores[1]);
+    struct timespec t_inicio, t_fim;
+    clock_gettime(CLOCK_MONOTONIC, &t_inicio);
+
     // Cria threads de processamento
     for (int i = 0; i < num_threads; i++) {
         thread_data[i].points = pontos;
@@ -252,12 +3287,33 @@ int main(int argc, char *argv[]) {
         if (i == num_threads - 1) {
             thread_data[i].end += remaining_points;
         }
+        if (por_arestas) {
+            thread_data[i].start = (int) ((long) n * i / num_threads);
+            thread_data[i].end = (int) ((long) n * (i + 1) / num_threads);
+        }
+        if (gerador_vetorial) {
+            // Blocos inteiros por thread, para que a amostra k dependa só da semente
+            long blocos = (num_pontos_aleatorios + VRNG_BLOCK - 1) / VRNG_BLOCK;
+            long fim = blocos * (i + 1) / num_threads * VRNG_BLOCK;
+            thread_data[i].start = (int) (blocos * i / num_threads * VRNG_BLOCK);
+            thread_data[i].end = fim < num_pontos_aleatorios ? (int) fim : num_pontos_aleatorios;
+        }
         thread_data[i].num_polygon_points = n;
+        thread_data[i].kernel = kernel;
+        thread_data[i].edges = usar_float ? &float_edges : NULL;
+        thread_data[i].sweep = varrimento ? &sweep : NULL;
+        thread_data[i].edge_parallel = por_arestas ? &edge_parallel : NULL;
+        thread_data[i].index = i;
+        thread_data[i].vector_rng = gerador_vetorial;
+        thread_data[i].seed = semente;
+        thread_data[i].lane_edges = lane_edges;
+        thread_data[i].fallbacks = 0;
+        thread_data[i].cpu = cpus[i];
         thread_data[i].total_inside = &total_inside;
         thread_data[i].total_processed = &total_processed;
         thread_data[i].mutex = &mutex;
 
-        pthread_create(&threads[i], NULL, worker_thread, &thread_data[i]);
+        pthread_create(&threads[i], NULL, por_arestas ? edge_worker : worker_thread, &thread_data[i]);
     }
 
     // Dados para a thread de progresso
@@ -275,6 +3331,9 @@ int main(int argc, char *argv[]) {
         pthread_join(threads[i], NULL);
     }
 
+    clock_gettime(CLOCK_MONOTONIC, &t_fim);
+    page_faults(&faltas[2], &maiores[2]);
+
     // Aguarda a conclusão da thread de progresso
     pthread_join(progress_tid, NULL);
 
@@ -283,10 +3342,83 @@ int main(int argc, char *argv[]) {
     char area_msg[128];
     snprintf(area_msg, sizeof(area_msg), "\nÁrea estimada do polígono: %.6f unidades quadradas\n", estimated_area);
     write(STDOUT_FILENO, area_msg, strlen(area_msg));
+    if (convex) {
+        char convex_msg[] = "Polígono convexo: classificação pelo teste em cunha O(log n)\n";
+        write(STDOUT_FILENO, convex_msg, strlen(convex_msg));
+    } else if (n <= MAX_FIXED_N) {
+        char kernel_msg[128];
+        snprintf(kernel_msg, sizeof(kernel_msg), "Núcleo de classificação: desenrolado para %d vértices\n", n);
+        write(STDOUT_FILENO, kernel_msg, strlen(kernel_msg));
+    }
+    prefilter_report();
+    if (varrimento) {
+        long fallbacks = 0;
+        for (int i = 0; i < num_threads; i++) fallbacks += thread_data[i].fallbacks;
+        double elapsed = (t_fim.tv_sec - t_inicio.tv_sec) + (t_fim.tv_nsec - t_inicio.tv_nsec) / 1e9;
+        char sweep_msg[160];
+        snprintf(sweep_msg, sizeof(sweep_msg), "Varrimento: %d arestas, %ld amostras entregues ao núcleo (%.4f%%), %.2f Mamostras/s\n",
+                 sweep.num_edges, fallbacks, 100.0 * fallbacks / num_pontos_aleatorios, num_pontos_aleatorios / elapsed / 1e6);
+        write(STDOUT_FILENO, sweep_msg, strlen(sweep_msg));
+    }
+    if (gerador_vetorial) {
+        long fallbacks = 0;
+        for (int i = 0; i < num_threads; i++) fallbacks += thread_data[i].fallbacks;
+        double elapsed = (t_fim.tv_sec - t_inicio.tv_sec) + (t_fim.tv_nsec - t_inicio.tv_nsec) / 1e9;
+        char vector_msg[200];
+        snprintf(vector_msg, sizeof(vector_msg), "Gerador vetorial: xoshiro256+ em %d vias (semente %llu), %s, %ld amostras entregues ao núcleo, %.2f Mamostras/s\n",
+                 VRNG_LANES, (unsigned long long) semente, lane_edges != NULL ? "núcleo por vias" : "núcleo por amostra",
+                 fallbacks, num_pontos_aleatorios / elapsed / 1e6);
+        write(STDOUT_FILENO, vector_msg, strlen(vector_msg));
+    }
+    if (por_arestas) {
+        long fallbacks = 0;
+        for (int i = 0; i < num_threads; i++) fallbacks += thread_data[i].fallbacks;
+        double elapsed = (t_fim.tv_sec - t_inicio.tv_sec) + (t_fim.tv_nsec - t_inicio.tv_nsec) / 1e9;
+        char edge_msg[200];
+        snprintf(edge_msg, sizeof(edge_msg), "Modo por arestas: %d threads com ~%d arestas cada, %ld amostras entregues ao núcleo (%.4f%%), %.2f Mamostras/s\n",
+                 num_threads, n / num_threads, fallbacks, 100.0 * fallbacks / num_pontos_aleatorios, num_pontos_aleatorios / elapsed / 1e6);
+        write(STDOUT_FILENO, edge_msg, strlen(edge_msg));
+        pthread_barrier_destroy(&edge_parallel.barrier);
+    }
+    if (usar_float) {
+        long fallbacks = 0;
+        for (int i = 0; i < num_threads; i++) fallbacks += thread_data[i].fallbacks;
+        double elapsed = (t_fim.tv_sec - t_inicio.tv_sec) + (t_fim.tv_nsec - t_inicio.tv_nsec) / 1e9;
+        char float_msg[160];
+        snprintf(float_msg, sizeof(float_msg), "Modo float: %ld amostras reavaliadas em double (%.4f%%), %.2f Mamostras/s\n",
+                 fallbacks, 100.0 * fallbacks / num_pontos_aleatorios, num_pontos_aleatorios / elapsed / 1e6);
+        write(STDOUT_FILENO, float_msg, strlen(float_msg));
+    }
+
+    if (relatorio_faltas) {
+        double elapsed = (t_fim.tv_sec - t_inicio.tv_sec) + (t_fim.tv_nsec - t_inicio.tv_nsec) / 1e9;
+        char faults_msg[200];
+        snprintf(faults_msg, sizeof(faults_msg), "Faltas de página: %ld na pré-falta, %ld a gerar amostras, %ld a classificar (%ld maiores), %.2f Mamostras/s\n",
+                 faltas_arena, faltas[1] - faltas[0], faltas[2] - faltas[1],
+                 faltas_maiores + maiores[2] - maiores[0], num_pontos_aleatorios / elapsed / 1e6);
+        write(STDOUT_FILENO, faults_msg, strlen(faults_msg));
+    }
+
+    if (afinidade != NULL) {
+        for (int i = 0; i < num_threads; i++) {
+            char placement_msg[128];
+            snprintf(placement_msg, sizeof(placement_msg), "Thread %d: CPU %d (nó %d)\n",
+                     i, thread_data[i].cpu_real, cpu_node(thread_data[i].cpu_real));
+            write(STDOUT_FILENO, placement_msg, strlen(placement_msg));
+        }
+    }
 
-    free(pontos);
-    free(polygon);
+    buffer_free(float_edges.x);
+    buffer_free(float_edges.y);
+    buffer_free(sweep.edges);
+    buffer_free(sweep.events);
+    buffer_free(edge_parallel.parity);
+    buffer_free(lane_edges);
+    buffer_free(pontos);
+    buffer_free(polygon);
     free(threads);
     free(thread_data);
+    // A arena é libertada de uma só vez
+    if (arena.base != NULL) munmap(arena.base, arena.size);
     exit(EXIT_FAILURE);
 }
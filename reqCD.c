@@ -1,19 +1,200 @@
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdint.h>
 #include <stdbool.h>
 #include <time.h>
 #include <unistd.h>
 #include <fcntl.h>
 #include <math.h>
+#include <float.h>
 #include <sys/wait.h>
+#include <sys/mman.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sched.h>
 #include <string.h>
 #include <errno.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+
+#define TRACE_CHUNK 65536
+#define STREAM_CHECK 1024
+#define BITSET_MAGIC 0x5342434dU /* "MCBS" */
+#define INSIDE_MAGIC 0x5049434dU /* "MCIP" */
+#define SAMPLER_SPLITMIX64 1
+#define RASTER_OUTSIDE 0
+#define RASTER_INSIDE 1
+#define RASTER_BOUNDARY 2
+// Bits mais significativos do código de Morton usados na ordenação (--morton)
+#define MORTON_SORT_BITS 16
+
+// Limite de erro relativo do determinante de orientação em double (Shewchuk, ccwerrboundA)
+#define ORIENT_ERRBOUND ((3.0 + 8.0 * DBL_EPSILON) * DBL_EPSILON / 2.0)
+// Maior número de vértices com núcleo desenrolado em tempo de compilação
+#define MAX_FIXED_N 16
 
 typedef struct {
     double x;
     double y;
 } Point;
 
+// Núcleo de classificação escolhido uma vez após carregar o polígono
+typedef bool (*InsideFn)(Point polygon[], int n, Point p);
+
+typedef struct {
+    float *x; // n + 1 vértices: o primeiro repete-se no fim para a aresta de fecho
+    float *y;
+    int n;
+    float margin_y;
+    float margin_d;
+} FloatEdges;
+
+// Aresta para o varrimento, com a extremidade inferior primeiro (a.y < b.y)
+typedef struct {
+    Point a;
+    Point b;
+} SweepEdge;
+
+typedef struct {
+    SweepEdge *edges;       // Arestas não horizontais, por a.y crescente
+    int num_edges;
+    double *events;         // Ordenadas distintas dos vértices, crescentes
+    int num_events;
+} SweepPolygon;
+
+typedef struct {
+    double y;
+    int index;
+} SweepKey;
+
+// Chave de Morton de uma amostra do bloco e a sua posição no bloco
+typedef struct {
+    uint32_t code;
+    uint32_t index;
+} MortonKey;
+
+// Mapa do polígono sobre o domínio de amostragem: 2 bits por píxel, 4 píxeis por byte
+typedef struct {
+    uint8_t *cells;
+    int resolution;
+    double x0, y0;
+    double h, inv_h;
+    size_t bytes;
+} Raster;
+
+// Cabeçalho do ficheiro --bitset, seguido de ceil(N / 64) palavras de 64 bits (bit k = amostra k dentro)
+typedef struct {
+    uint32_t magic;
+    uint32_t sampler;       // SAMPLER_SPLITMIX64: amostra k = lease_sample(seed, k)
+    uint64_t seed;
+    uint64_t num_points;
+    uint64_t inside;
+    uint64_t polygon_hash;  // FNV-1a dos vértices, tal como lidos do ficheiro
+    uint32_t num_vertices;  // Vértices lidos do ficheiro, os mesmos do polygon_hash
+    uint32_t reserved;
+} BitsetHeader;
+
+// Cabeçalho do ficheiro --inside-points, seguido de count pares (x, y) em double
+typedef struct {
+    uint32_t magic;
+    uint32_t reserved;
+    uint64_t count;
+} InsideHeader;
+
+typedef struct {
+    uint64_t *bits;  // NULL sem --bitset/--inside-points
+    long long word;
+    uint64_t value;
+} BitWriter;
+
+typedef struct {
+    const char *name;
+    long long ts;
+    long long dur;
+    long long arg;
+    int tid;
+} TraceEvent;
+
+typedef struct {
+    const char *path;
+    TraceEvent *events;
+    int count;
+    int capacity;
+    int tid;
+} Trace;
+
+static Trace trace = {NULL, NULL, 0, 0, 0};
+
+typedef struct {
+    long long every;
+    long long every_ms;
+    int countdown;
+    long long last_time;
+    long long sent_processed;
+    long long sent_inside;
+} Stream;
+
+typedef struct {
+    Point *points;
+    Point *polygon;
+    int n;
+    InsideFn kernel;
+    const FloatEdges *edges; // NULL sem --float
+    const Raster *raster;    // NULL sem --raster
+    const SweepPolygon *sweep; // NULL sem --sweep
+    bool morton;             // Blocos visitados pela ordem de Morton (--morton)
+    long fallbacks;
+    BitWriter bits;  // Classificação de cada amostra para o --bitset
+    long long first_index;
+    int start;
+    int end;
+    int cpu;
+    int *cpu_used;   // CPU onde a thread correu (sched_getcpu), partilhado com o pai; NULL sem afinidade
+    int out_fd;
+    bool verbose;
+    int inside;
+    Stream stream;
+    Trace trace;
+} ChildThreadData;
+
+/**
+ * @brief Exact sign of the orientation determinant, used when the floating-point filter is inconclusive.
+ *
+ * The determinant is expanded into six products of input coordinates. Each product is split exactly
+ * with fma and the twelve terms are accumulated into a non-overlapping expansion (two_sum), whose
+ * most significant nonzero component has the sign of the exact result.
+ *
+ * @param p First point of the triplet.
+ * @param q Second point of the triplet.
+ * @param r Third point of the triplet.
+ * @return 0 if p, q, and r are colinear, 1 if clockwise, 2 if counterclockwise.
+ */
+int orientation_exact(Point p, Point q, Point r) {
+    double a[6] = {q.y, -p.y, p.y, -q.x, p.x, -p.x};
+    double b[6] = {r.x, r.x, q.x, r.y, r.y, q.y};
+    double e[12];
+    int m = 0;
+
+    for (int k = 0; k < 12; k++) {
+        double product = a[k / 2] * b[k / 2];
+        double term = (k % 2 == 0) ? product : fma(a[k / 2], b[k / 2], -product);
+        for (int i = 0; i < m; i++) {
+            double s = term + e[i];
+            double bv = s - term;
+            e[i] = (term - (s - bv)) + (e[i] - bv);
+            term = s;
+        }
+        e[m++] = term;
+    }
+
+    for (int i = m - 1; i >= 0; i--) {
+        if (e[i] != 0.0) return (e[i] > 0) ? 1 : 2;
+    }
+    return 0;
+}
+
 /**
  * @brief Determines the orientation of an ordered triplet (p, q, r).
  * @param p First point of the triplet.
@@ -22,10 +203,15 @@ typedef struct {
  * @return 0 if p, q, and r are colinear, 1 if clockwise, 2 if counterclockwise.
  */
 int orientation(Point p, Point q, Point r) {
-    double val = (q.y - p.y) * (r.x - q.x) - (q.x - p.x) * (r.y - q.y);
+    double left = (q.y - p.y) * (r.x - q.x);
+    double right = (q.x - p.x) * (r.y - q.y);
+    double val = left - right;
 
-    if (val == 0) return 0;
-    return (val > 0) ? 1 : 2;
+    // Filtro: o sinal em double é garantido fora do limite de erro; caso contrário, aritmética exata
+    double bound = ORIENT_ERRBOUND * (fabs(left) + fabs(right));
+    if (val > bound) return 1;
+    if (-val > bound) return 2;
+    return orientation_exact(p, q, r);
 }
 
 /**
@@ -95,6 +281,1223 @@ bool isInsidePolygon(Point polygon[], int n, Point p) {
     return count & 1;
 }
 
+/**
+ * @brief Detects whether the polygon is convex and, if so, normalizes it to counterclockwise order.
+ *
+ * Repeated consecutive vertices (including a closing vertex equal to the first) are removed in place.
+ * A polygon is convex when every turn has the same sign and the turns add up to a single revolution,
+ * which rules out self-intersecting "stars" whose turns all share a sign.
+ *
+ * @param polygon Polygon vertices; compacted and possibly reversed in place.
+ * @param n Number of vertices; updated after compaction.
+ * @return true if the polygon is convex, else false.
+ */
+bool polygon_convexity(Point polygon[], int *n) {
+    int m = 0;
+    for (int i = 0; i < *n; i++) {
+        if (m > 0 && polygon[i].x == polygon[m - 1].x && polygon[i].y == polygon[m - 1].y) continue;
+        polygon[m++] = polygon[i];
+    }
+    while (m > 1 && polygon[m - 1].x == polygon[0].x && polygon[m - 1].y == polygon[0].y) m--;
+    *n = m;
+    if (m < 3) return false;
+
+    int sign = 0;
+    double turning = 0.0;
+    for (int i = 0; i < m; i++) {
+        Point a = polygon[i], b = polygon[(i + 1) % m], c = polygon[(i + 2) % m];
+        double ux = b.x - a.x, uy = b.y - a.y, vx = c.x - b.x, vy = c.y - b.y;
+        int o = orientation(a, b, c);
+        if (o != 0) {
+            int s = (o == 2) ? 1 : -1;
+            if (sign != 0 && s != sign) return false;
+            sign = s;
+        }
+        turning += atan2(ux * vy - uy * vx, ux * vx + uy * vy);
+    }
+    if (sign == 0 || fabs(fabs(turning) - 2.0 * M_PI) > 1e-6) return false;
+
+    // Sentido horário: inverte para anti-horário
+    if (sign < 0) {
+        for (int i = 0, j = m - 1; i < j; i++, j--) {
+            Point t = polygon[i];
+            polygon[i] = polygon[j];
+            polygon[j] = t;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Checks if a point p is inside a convex counterclockwise polygon in O(log n).
+ *
+ * Binary search over the fan of wedges from vertex 0 finds the wedge containing p,
+ * then a single orientation test against the opposite edge decides. Points on the boundary are inside.
+ *
+ * @param polygon[] Convex polygon in counterclockwise order (see polygon_convexity).
+ * @param n Number of points in the polygon.
+ * @param p Point to check.
+ * @return true if the point p is inside the polygon, else false.
+ */
+bool isInsideConvex(Point polygon[], int n, Point p) {
+    Point o = polygon[0];
+
+    // Fora do ângulo formado pelas arestas que saem do pivô
+    if (orientation(o, polygon[1], p) == 1) return false;
+    if (orientation(o, polygon[n - 1], p) == 2) return false;
+
+    // Maior i em [1, n - 2] com p à esquerda (ou sobre) o raio pivô -> polygon[i]
+    int lo = 1, hi = n - 2;
+    while (lo < hi) {
+        int mid = (lo + hi + 1) / 2;
+        if (orientation(o, polygon[mid], p) != 1)
+            lo = mid;
+        else
+            hi = mid - 1;
+    }
+
+    return orientation(polygon[lo], polygon[lo + 1], p) != 1;
+}
+
+/**
+ * @brief Body of the kernels specialized for a fixed vertex count.
+ *
+ * Same test as isInsidePolygon, edge by edge and in the same order, so the results are identical.
+ * With n a compile-time constant the loop is fully unrolled and the "% n" disappears; edges lying
+ * entirely above or below the horizontal ray cannot meet it and are skipped before doIntersect.
+ *
+ * @param polygon Array of points forming the polygon.
+ * @param n Number of points in the polygon (a constant in every instantiation).
+ * @param p Point to check.
+ * @return true if the point p is inside the polygon, else false.
+ */
+static inline __attribute__((always_inline)) bool inside_fixed(const Point *polygon, int n, Point p) {
+    Point extreme = {2.5, p.y};
+    int count = 0;
+
+#pragma GCC unroll 16
+    for (int i = 0; i < n; i++) {
+        Point a = polygon[i];
+        Point b = polygon[i + 1 == n ? 0 : i + 1];
+        if ((a.y > p.y && b.y > p.y) || (a.y < p.y && b.y < p.y)) continue;
+        if (doIntersect(a, b, p, extreme)) {
+            if (orientation(a, p, b) == 0)
+                return onSegment(a, p, b);
+            count++;
+        }
+    }
+    return count & 1;
+}
+
+// Gera isInsidePolygonN: o flatten inclui doIntersect/orientation no corpo desenrolado
+#define DEFINE_FIXED_KERNEL(N)                                                  \
+    __attribute__((flatten)) bool isInsidePolygon##N(Point polygon[], int n, Point p) { \
+        (void) n;                                                               \
+        return inside_fixed(polygon, N, p);                                     \
+    }
+
+DEFINE_FIXED_KERNEL(3)
+DEFINE_FIXED_KERNEL(4)
+DEFINE_FIXED_KERNEL(5)
+DEFINE_FIXED_KERNEL(6)
+DEFINE_FIXED_KERNEL(7)
+DEFINE_FIXED_KERNEL(8)
+DEFINE_FIXED_KERNEL(9)
+DEFINE_FIXED_KERNEL(10)
+DEFINE_FIXED_KERNEL(11)
+DEFINE_FIXED_KERNEL(12)
+DEFINE_FIXED_KERNEL(13)
+DEFINE_FIXED_KERNEL(14)
+DEFINE_FIXED_KERNEL(15)
+DEFINE_FIXED_KERNEL(16)
+
+// Tabela de despacho indexada pelo número de vértices
+static const InsideFn fixed_kernels[MAX_FIXED_N + 1] = {
+    NULL, NULL, NULL,
+    isInsidePolygon3, isInsidePolygon4, isInsidePolygon5, isInsidePolygon6, isInsidePolygon7,
+    isInsidePolygon8, isInsidePolygon9, isInsidePolygon10, isInsidePolygon11, isInsidePolygon12,
+    isInsidePolygon13, isInsidePolygon14, isInsidePolygon15, isInsidePolygon16
+};
+
+/**
+ * @brief Chooses the classification kernel once, after the polygon is loaded.
+ *
+ * Convex polygons use the O(log n) wedge test, which measured faster than the unrolled kernels
+ * even for small n; other polygons with up to MAX_FIXED_N vertices use the unrolled kernel for
+ * their vertex count and everything else the general loop.
+ *
+ * @param n Number of points in the polygon.
+ * @param convex Whether the polygon was detected convex by polygon_convexity.
+ * @return Kernel to call for every sample.
+ */
+InsideFn select_kernel(int n, bool convex) {
+    if (convex) return isInsideConvex;
+    if (n >= 3 && n <= MAX_FIXED_N) return fixed_kernels[n];
+    return isInsidePolygon;
+}
+
+/**
+ * @brief Builds the float32 structure-of-arrays copy of the polygon edges used by the --float mode.
+ *
+ * The error bounds assume every coordinate involved (vertices and samples) has magnitude at most M.
+ * Relative to the sample, each coordinate difference carries an error of at most 4uM (u = 2^-24),
+ * so a y comparison is certain beyond 4 FLT_EPSILON M and the crossing determinant beyond 32 FLT_EPSILON M^2.
+ * The double kernel casts its ray only up to x = 2.5, so polygons reaching past it disable the float path.
+ *
+ * @param edges Structure to fill.
+ * @param polygon Polygon vertices.
+ * @param n Number of vertices.
+ * @param max_sample Largest absolute coordinate of a sample.
+ * @return true if the float path can be used, else false.
+ */
+bool float_edges_build(FloatEdges *edges, Point polygon[], int n, double max_sample) {
+    double m = max_sample;
+    for (int i = 0; i < n; i++) {
+        if (polygon[i].x >= 2.5) return false;
+        m = fmax(m, fmax(fabs(polygon[i].x), fabs(polygon[i].y)));
+    }
+    if (m > FLT_MAX / 64.0) return false;
+
+    edges->x = malloc((n + 1) * sizeof(float));
+    edges->y = malloc((n + 1) * sizeof(float));
+    if (edges->x == NULL || edges->y == NULL) {
+        free(edges->x);
+        free(edges->y);
+        return false;
+    }
+    for (int i = 0; i <= n; i++) {
+        edges->x[i] = (float) polygon[i % n].x;
+        edges->y[i] = (float) polygon[i % n].y;
+    }
+    edges->n = n;
+    edges->margin_y = (float) (4.0 * FLT_EPSILON * m);
+    edges->margin_d = (float) (32.0 * FLT_EPSILON * m * m);
+    return true;
+}
+
+/**
+ * @brief Classifies a point with the float32 crossing-number kernel.
+ *
+ * The loop is branch-free so the compiler can vectorize it; an edge whose y straddle or crossing side
+ * falls inside the error bounds marks the whole sample as uncertain.
+ *
+ * @param edges Float edge data built by float_edges_build.
+ * @param p Point to check.
+ * @return 1 if inside, 0 if outside, -1 if the result must be recomputed in double.
+ */
+int classify_float(const FloatEdges *edges, Point p) {
+    const float *ex = edges->x, *ey = edges->y;
+    float px = (float) p.x, py = (float) p.y;
+    float margin_y = edges->margin_y, margin_d = edges->margin_d;
+    int crossings = 0, uncertain = 0;
+
+    for (int i = 0; i < edges->n; i++) {
+        float ax = ex[i] - px, ay = ey[i] - py;
+        float bx = ex[i + 1] - px, by = ey[i + 1] - py;
+        float d = ax * by - bx * ay;
+        int straddle = (ay > 0.0f) != (by > 0.0f);
+        crossings ^= straddle & ((d > 0.0f) == (by > 0.0f));
+        uncertain |= (fabsf(ay) <= margin_y) | (fabsf(by) <= margin_y) | (straddle & (fabsf(d) <= margin_d));
+    }
+    return uncertain ? -1 : crossings;
+}
+
+int compare_double(const void *a, const void *b) {
+    double x = *(const double *) a, y = *(const double *) b;
+    return (x > y) - (x < y);
+}
+
+int compare_sweep_edge(const void *a, const void *b) {
+    const SweepEdge *e = a, *f = b;
+    return (e->a.y > f->a.y) - (e->a.y < f->a.y);
+}
+
+int compare_sweep_key(const void *a, const void *b) {
+    const SweepKey *p = a, *q = b;
+    return (p->y > q->y) - (p->y < q->y);
+}
+
+/**
+ * @brief Order of two edges active in the same slab: true if e lies left of f just above e's lower endpoint.
+ *
+ * Decided with the exact orientation predicate; sweep_build only accepts polygons whose edges never
+ * cross, so the order is the same over the whole slab.
+ */
+static inline bool sweep_left_of(const SweepEdge *e, const SweepEdge *f) {
+    int side = orientation(f->a, f->b, e->a);
+    if (side == 0) side = orientation(f->a, f->b, e->b);
+    return side == 2;
+}
+
+// Cruzamento próprio de duas arestas (num ponto interior a ambas), com o predicado exato
+static inline bool sweep_edges_cross(const SweepEdge *e, const SweepEdge *f) {
+    int o1 = orientation(e->a, e->b, f->a), o2 = orientation(e->a, e->b, f->b);
+    int o3 = orientation(f->a, f->b, e->a), o4 = orientation(f->a, f->b, e->b);
+    return o1 != 0 && o2 != 0 && o3 != 0 && o4 != 0 && o1 != o2 && o3 != o4;
+}
+
+/**
+ * @brief Moves the active edge table up to ordinate y: edges ending at or below y leave, edges starting there enter in x order.
+ * @param sweep Polygon prepared by sweep_build.
+ * @param active Active edge indices, in x order.
+ * @param num_active Number of active edges, updated.
+ * @param next_edge First edge not yet inserted, updated.
+ * @param y Ordinate of the event.
+ */
+static inline void sweep_advance(const SweepPolygon *sweep, int *active, int *num_active, int *next_edge, double y) {
+    const SweepEdge *edges = sweep->edges;
+    int kept = 0;
+    for (int k = 0; k < *num_active; k++) {
+        if (edges[active[k]].b.y > y) active[kept++] = active[k];
+    }
+    *num_active = kept;
+    for (; *next_edge < sweep->num_edges && edges[*next_edge].a.y <= y; (*next_edge)++) {
+        int lo = 0, hi = *num_active;
+        while (lo < hi) {
+            int mid = (lo + hi) / 2;
+            if (sweep_left_of(&edges[*next_edge], &edges[active[mid]])) hi = mid;
+            else lo = mid + 1;
+        }
+        memmove(&active[lo + 1], &active[lo], (*num_active - lo) * sizeof(int));
+        active[lo] = *next_edge;
+        (*num_active)++;
+    }
+}
+
+/**
+ * @brief Prepares a polygon for sweep_classify: non-horizontal edges sorted by lower y and the vertex ordinates.
+ *
+ * Edges that cross swap places inside a slab with no event, which would silently break the
+ * binary search, so the events are replayed once and every pair of neighbouring active edges is
+ * tested: the lowest crossing of a polygon is always between two neighbours (Shamos-Hoey).
+ *
+ * @param sweep Structure to fill.
+ * @param polygon[] Polygon vertices.
+ * @param n Number of vertices.
+ * @return false if memory runs out, a vertex lies beyond the ray end used by the kernels (x >= 2.5)
+ *         or two edges cross (the polygon is not simple).
+ */
+bool sweep_build(SweepPolygon *sweep, Point polygon[], int n) {
+    sweep->edges = malloc(n * sizeof(SweepEdge));
+    sweep->events = malloc(n * sizeof(double));
+    sweep->num_edges = sweep->num_events = 0;
+    if (sweep->edges == NULL || sweep->events == NULL) return false;
+
+    for (int i = 0; i < n; i++) {
+        if (polygon[i].x >= 2.5) return false;
+        Point a = polygon[i], b = polygon[(i + 1) % n];
+        if (a.y == b.y) continue;
+        sweep->edges[sweep->num_edges++] = a.y < b.y ? (SweepEdge) {a, b} : (SweepEdge) {b, a};
+    }
+    for (int i = 0; i < n; i++) sweep->events[i] = polygon[i].y;
+    qsort(sweep->edges, sweep->num_edges, sizeof(SweepEdge), compare_sweep_edge);
+    qsort(sweep->events, n, sizeof(double), compare_double);
+    for (int i = 0; i < n; i++) {
+        if (sweep->num_events == 0 || sweep->events[sweep->num_events - 1] != sweep->events[i]) {
+            sweep->events[sweep->num_events++] = sweep->events[i];
+        }
+    }
+
+    // Só polígonos simples: as arestas vizinhas em cada faixa não se podem cruzar
+    int *active = malloc((sweep->num_edges + 1) * sizeof(int));
+    if (active == NULL) return false;
+    int num_active = 0, next_edge = 0;
+    bool simple = true;
+    for (int k = 0; simple && k < sweep->num_events; k++) {
+        sweep_advance(sweep, active, &num_active, &next_edge, sweep->events[k]);
+        for (int j = 0; simple && j + 1 < num_active; j++) {
+            simple = !sweep_edges_cross(&sweep->edges[active[j]], &sweep->edges[active[j + 1]]);
+        }
+    }
+    free(active);
+    return simple;
+}
+
+/**
+ * @brief Classifies a batch of samples with a scanline sweep over an active edge table.
+ *
+ * The samples are sorted by y and the sweep moves upward through the vertex ordinates. At each one
+ * the edges that end there leave the table and those that start there are inserted in x order. A
+ * sample is classified by binary search for the number of active edges to its right (parity), using
+ * the exact orientation predicate. Samples on an edge or at the height of a vertex, where crossings
+ * are ambiguous, are handed to the kernel, so the results match the kernel exactly. Cost is
+ * O((n + m) log(n + m) + events * active) instead of O(n * m).
+ *
+ * @param sweep Polygon prepared by sweep_build.
+ * @param polygon[] Polygon vertices (for the kernel).
+ * @param n Number of vertices.
+ * @param kernel Point-in-polygon test for the ambiguous samples.
+ * @param points Samples.
+ * @param count Number of samples.
+ * @param inside Output flag per sample, or NULL.
+ * @param fallbacks Incremented for every sample handed to the kernel.
+ * @return Number of samples inside the polygon.
+ */
+int sweep_classify(const SweepPolygon *sweep, Point polygon[], int n, InsideFn kernel, const Point *points, int count,
+                   unsigned char *inside, long *fallbacks) {
+    SweepKey *keys = malloc(count * sizeof(SweepKey));
+    int *active = malloc((sweep->num_edges + 1) * sizeof(int));
+    if (keys == NULL || active == NULL) {
+        perror("Erro ao alocar memória para o varrimento");
+        exit(EXIT_FAILURE);
+    }
+    for (int i = 0; i < count; i++) keys[i] = (SweepKey) {points[i].y, i};
+    qsort(keys, count, sizeof(SweepKey), compare_sweep_key);
+
+    const SweepEdge *edges = sweep->edges;
+    int num_active = 0, next_edge = 0, next_event = 0;
+    int total = 0;
+    for (int s = 0; s < count; s++) {
+        Point p = points[keys[s].index];
+
+        // Avança a linha de varrimento até ao último evento <= p.y
+        while (next_event < sweep->num_events && sweep->events[next_event] <= p.y) {
+            sweep_advance(sweep, active, &num_active, &next_edge, sweep->events[next_event++]);
+        }
+
+        bool dentro;
+        bool ambiguous = next_event > 0 && sweep->events[next_event - 1] == p.y;
+        if (!ambiguous) {
+            // Primeira aresta ativa com p à sua esquerda; as seguintes cruzam o raio para a direita
+            int lo = 0, hi = num_active;
+            while (lo < hi) {
+                int mid = (lo + hi) / 2;
+                int side = orientation(edges[active[mid]].a, edges[active[mid]].b, p);
+                if (side == 0) {
+                    ambiguous = true;
+                    break;
+                }
+                if (side == 2) hi = mid;
+                else lo = mid + 1;
+            }
+            dentro = ((num_active - lo) & 1) != 0;
+        }
+        if (ambiguous) {
+            dentro = kernel(polygon, n, p);
+            (*fallbacks)++;
+        }
+        total += dentro;
+        if (inside != NULL) inside[keys[s].index] = dentro;
+    }
+
+    free(active);
+    free(keys);
+    return total;
+}
+
+// Índice de píxel de uma coordenada, limitado a [-1, R] para não transbordar na conversão para int
+int raster_index(const Raster *raster, double v, double origin) {
+    double f = floor((v - origin) * raster->inv_h);
+    if (f < -1.0) return -1;
+    if (f > raster->resolution) return raster->resolution;
+    return (int) f;
+}
+
+void raster_set(Raster *raster, long long index, int state) {
+    int shift = (int) (index & 3) * 2;
+    raster->cells[index >> 2] = (uint8_t) ((raster->cells[index >> 2] & ~(3 << shift)) | (state << shift));
+}
+
+/**
+ * @brief Returns the 2-bit state of the pixel containing p (RASTER_BOUNDARY outside the domain).
+ * @param raster Raster built by raster_build.
+ * @param p Point to look up.
+ * @return RASTER_OUTSIDE, RASTER_INSIDE or RASTER_BOUNDARY.
+ */
+static inline int raster_state(const Raster *raster, Point p) {
+    double fx = (p.x - raster->x0) * raster->inv_h;
+    double fy = (p.y - raster->y0) * raster->inv_h;
+    if (!(fx >= 0.0 && fx < raster->resolution && fy >= 0.0 && fy < raster->resolution)) return RASTER_BOUNDARY;
+    long long index = (long long) (int) fy * raster->resolution + (int) fx;
+    return (raster->cells[index >> 2] >> ((index & 3) * 2)) & 3;
+}
+
+/**
+ * @brief Rasterizes the polygon over [-1, 1] x [-1, 1] into R x R pixels with a 2-bit state each.
+ *
+ * Every pixel an edge passes through is marked boundary, together with its neighbours, so a sample
+ * assigned to the wrong pixel by rounding still ends up in the exact kernel. The remaining pixels
+ * contain no edge and take the state of their centre, found by scanline parity: the crossings of
+ * each row's centre line are bucketed per row, sorted and walked once.
+ * The cells live in a shared anonymous mapping, so forked children read them without a copy.
+ *
+ * @param raster Raster to fill.
+ * @param polygon Polygon vertices.
+ * @param n Number of vertices.
+ * @param resolution Pixels per axis.
+ * @return true on success, else false.
+ */
+bool raster_build(Raster *raster, Point polygon[], int n, int resolution) {
+    int R = resolution;
+    raster->resolution = R;
+    raster->x0 = raster->y0 = -1.0;
+    raster->h = 2.0 / R;
+    raster->inv_h = R / 2.0;
+    raster->bytes = ((size_t) R * R + 3) / 4;
+    raster->cells = mmap(NULL, raster->bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (raster->cells == MAP_FAILED) return false;
+
+    // 1. Píxeis de fronteira: por linha de píxeis, o intervalo em x da aresta recortada, com margem de um píxel
+    for (int i = 0; i < n; i++) {
+        Point a = polygon[i], b = polygon[(i + 1) % n];
+        double ymin = fmin(a.y, b.y), ymax = fmax(a.y, b.y);
+        int r0 = raster_index(raster, ymin, raster->y0) - 1;
+        int r1 = raster_index(raster, ymax, raster->y0) + 1;
+        if (r0 < 0) r0 = 0;
+        if (r1 > R - 1) r1 = R - 1;
+        for (int row = r0; row <= r1; row++) {
+            double ylo = fmax(raster->y0 + row * raster->h, ymin);
+            double yhi = fmin(raster->y0 + (row + 1) * raster->h, ymax);
+            if (ylo > yhi) ylo = yhi = (ylo > ymax) ? ymax : ymin;
+            double xl, xr;
+            if (a.y == b.y) {
+                xl = fmin(a.x, b.x);
+                xr = fmax(a.x, b.x);
+            } else {
+                double xa = a.x + (ylo - a.y) * (b.x - a.x) / (b.y - a.y);
+                double xb = a.x + (yhi - a.y) * (b.x - a.x) / (b.y - a.y);
+                xl = fmin(xa, xb);
+                xr = fmax(xa, xb);
+            }
+            int c0 = raster_index(raster, xl, raster->x0) - 1;
+            int c1 = raster_index(raster, xr, raster->x0) + 1;
+            if (c0 < 0) c0 = 0;
+            if (c1 > R - 1) c1 = R - 1;
+            for (int col = c0; col <= c1; col++) raster_set(raster, (long long) row * R + col, RASTER_BOUNDARY);
+        }
+    }
+
+    // 2. Cruzamentos das arestas com a linha central de cada linha de píxeis, agrupados por linha
+    int *first = calloc(R + 1, sizeof(int));
+    if (first == NULL) return false;
+    for (int pass = 0; pass < 2; pass++) {
+        double *xs = NULL;
+        int *fill = NULL;
+        if (pass == 1) {
+            for (int row = 0; row < R; row++) first[row + 1] += first[row];
+            xs = malloc((first[R] > 0 ? first[R] : 1) * sizeof(double));
+            fill = malloc(R * sizeof(int));
+            if (xs == NULL || fill == NULL) {
+                free(xs);
+                free(fill);
+                free(first);
+                return false;
+            }
+            memcpy(fill, first, R * sizeof(int));
+        }
+        for (int i = 0; i < n; i++) {
+            Point a = polygon[i], b = polygon[(i + 1) % n];
+            if (a.y == b.y) continue;
+            int r0 = raster_index(raster, fmin(a.y, b.y), raster->y0) - 1;
+            int r1 = raster_index(raster, fmax(a.y, b.y), raster->y0) + 1;
+            if (r0 < 0) r0 = 0;
+            if (r1 > R - 1) r1 = R - 1;
+            for (int row = r0; row <= r1; row++) {
+                double yc = raster->y0 + (row + 0.5) * raster->h;
+                if ((a.y > yc) == (b.y > yc)) continue;
+                if (pass == 0)
+                    first[row + 1]++;
+                else
+                    xs[fill[row]++] = a.x + (yc - a.y) * (b.x - a.x) / (b.y - a.y);
+            }
+        }
+        if (pass == 1) {
+            // 3. Paridade no centro de cada píxel que não é de fronteira
+            for (int row = 0; row < R; row++) {
+                double *row_xs = xs + first[row];
+                int count = first[row + 1] - first[row];
+                qsort(row_xs, count, sizeof(double), compare_double);
+                int k = 0;
+                for (int col = 0; col < R; col++) {
+                    double xc = raster->x0 + (col + 0.5) * raster->h;
+                    while (k < count && row_xs[k] < xc) k++;
+                    long long index = (long long) row * R + col;
+                    if (((raster->cells[index >> 2] >> ((index & 3) * 2)) & 3) != RASTER_BOUNDARY && (k & 1))
+                        raster_set(raster, index, RASTER_INSIDE);
+                }
+            }
+            free(xs);
+            free(fill);
+        }
+    }
+    free(first);
+    return true;
+}
+
+/**
+ * @brief Classifies a point through the enabled fast paths, ending in the double kernel when they are unsure.
+ *
+ * The raster answers with one load outside boundary pixels; the float path answers when its error
+ * bound allows; everything else goes to the exact double kernel.
+ *
+ * @param raster Raster lookup table, or NULL.
+ * @param edges Float edge data, or NULL.
+ * @param polygon[] Array of points forming the polygon.
+ * @param n Number of points in the polygon.
+ * @param kernel Double-precision kernel chosen by select_kernel.
+ * @param p Point to check.
+ * @param fallbacks Incremented for every sample a fast path handed to the double kernel.
+ * @return true if the point p is inside the polygon, else false.
+ */
+bool classify_sample(const Raster *raster, const FloatEdges *edges, Point polygon[], int n, InsideFn kernel, Point p,
+                     long *fallbacks) {
+    if (raster != NULL) {
+        int state = raster_state(raster, p);
+        if (state != RASTER_BOUNDARY) return state == RASTER_INSIDE;
+    }
+    if (edges != NULL) {
+        int result = classify_float(edges, p);
+        if (result >= 0) return result;
+    }
+    if (raster != NULL || edges != NULL) (*fallbacks)++;
+    return kernel(polygon, n, p);
+}
+
+// Espalha os 16 bits de v pelas posições pares (código de Morton)
+static inline uint32_t morton_spread(uint32_t v) {
+    v &= 0xFFFF;
+    v = (v | (v << 8)) & 0x00FF00FF;
+    v = (v | (v << 4)) & 0x0F0F0F0F;
+    v = (v | (v << 2)) & 0x33333333;
+    v = (v | (v << 1)) & 0x55555555;
+    return v;
+}
+
+/**
+ * @brief Z-order (Morton) code of a sample of [-1, 1] x [-1, 1] on a 65536 x 65536 grid.
+ * @param p Sample.
+ * @return Code with the bits of x in the even positions and those of y in the odd ones.
+ */
+static inline uint32_t morton_code(Point p) {
+    uint32_t x = (uint32_t) fmin(fmax((p.x + 1.0) * 32767.5, 0.0), 65535.0);
+    uint32_t y = (uint32_t) fmin(fmax((p.y + 1.0) * 32767.5, 0.0), 65535.0);
+    return morton_spread(x) | (morton_spread(y) << 1);
+}
+
+/**
+ * @brief Reorders a block of samples along the Z-order curve, by LSD radix sort of the codes.
+ *
+ * Only the top MORTON_SORT_BITS bits of the code are sorted (tiles of 256 x 256 on the sample grid),
+ * which is enough for locality and takes two passes. Consecutive samples of the order fall in nearby
+ * raster cells, so the cells are reused from cache instead of being fetched at random. Counting does
+ * not depend on the order.
+ *
+ * @param points Samples of the block.
+ * @param count Number of samples.
+ * @param keys Output: count keys in Morton order; keys[i].index is the position in the block of the i-th sample.
+ * @param tmp Scratch space for count keys.
+ * @param sorted Output: the samples in Morton order.
+ */
+void morton_order(const Point *points, int count, MortonKey *keys, MortonKey *tmp, Point *sorted) {
+    for (int i = 0; i < count; i++) keys[i] = (MortonKey) {morton_code(points[i]), (uint32_t) i};
+
+    // Passagens de 8 bits em número par: o resultado volta a keys
+    for (int shift = 32 - MORTON_SORT_BITS; shift < 32; shift += 8) {
+        int histogram[257] = {0};
+        for (int i = 0; i < count; i++) histogram[((keys[i].code >> shift) & 0xFF) + 1]++;
+        for (int d = 0; d < 256; d++) histogram[d + 1] += histogram[d];
+        for (int i = 0; i < count; i++) tmp[histogram[(keys[i].code >> shift) & 0xFF]++] = keys[i];
+        MortonKey *swap = keys;
+        keys = tmp;
+        tmp = swap;
+    }
+    for (int i = 0; i < count; i++) sorted[i] = points[keys[i].index];
+}
+
+/**
+ * @brief Opens a hardware counter for the calling process and the threads it creates afterwards.
+ * @param type PERF_TYPE_HARDWARE or PERF_TYPE_HW_CACHE.
+ * @param config Event of the type.
+ * @return File descriptor of the (disabled) counter, or -1 if the counter is not available.
+ */
+int perf_open(uint32_t type, uint64_t config) {
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = type;
+    attr.config = config;
+    attr.disabled = 1;
+    attr.inherit = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    return (int) syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+// Lê um contador aberto por perf_open; -1 se não estiver disponível
+long long perf_read(int fd) {
+    long long value;
+    if (fd < 0 || read(fd, &value, sizeof(value)) != (ssize_t) sizeof(value)) return -1;
+    return value;
+}
+
+/**
+ * @brief splitmix64 output function for the state seed + (index + 1) * golden ratio.
+ * @param seed Seed of the stream.
+ * @param index Position in the stream.
+ * @return 64 random bits; any position can be computed directly (counter-based).
+ */
+uint64_t splitmix64_at(uint64_t seed, uint64_t index) {
+    uint64_t z = seed + (index + 1) * 0x9E3779B97F4A7C15ULL;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+/**
+ * @brief Returns sample number k of the counter-based sampler, uniform in [-1, 1] x [-1, 1].
+ * @param seed Seed of the run.
+ * @param k Global index of the sample.
+ * @return The sample; the same (seed, k) always gives the same point (as in reqEserver).
+ */
+Point lease_sample(uint64_t seed, uint64_t k) {
+    Point p;
+    p.x = (double) (splitmix64_at(seed, 2 * k) >> 11) * 0x1.0p-53 * 2.0 - 1.0;
+    p.y = (double) (splitmix64_at(seed, 2 * k + 1) >> 11) * 0x1.0p-53 * 2.0 - 1.0;
+    return p;
+}
+
+/**
+ * @brief FNV-1a hash of the polygon vertices, recorded in the bitset header.
+ * @param polygon Polygon vertices.
+ * @param n Number of vertices.
+ * @return 64-bit hash.
+ */
+uint64_t polygon_hash(Point polygon[], int n) {
+    uint64_t h = 0xcbf29ce484222325ULL;
+    const unsigned char *bytes = (const unsigned char *) polygon;
+    for (size_t i = 0; i < n * sizeof(Point); i++) {
+        h ^= bytes[i];
+        h *= 0x100000001b3ULL;
+    }
+    return h;
+}
+
+void bitwriter_flush(BitWriter *w) {
+    if (w->bits != NULL && w->value != 0) __atomic_fetch_or(&w->bits[w->word], w->value, __ATOMIC_RELAXED);
+    w->value = 0;
+}
+
+/**
+ * @brief Records the classification of sample k, publishing each finished 64-bit word with an atomic OR.
+ *
+ * Samples are visited in increasing order by each worker, so only the words shared with a
+ * neighbouring worker ever see more than one writer.
+ *
+ * @param w Bit writer of the worker (no-op when w->bits is NULL).
+ * @param k Global index of the sample.
+ * @param inside Whether the sample is inside the polygon.
+ */
+void bitwriter_put(BitWriter *w, long long k, bool inside) {
+    if (w->bits == NULL) return;
+    if ((k >> 6) != w->word) {
+        bitwriter_flush(w);
+        w->word = k >> 6;
+    }
+    if (inside) w->value |= 1ULL << (k & 63);
+}
+
+/**
+ * @brief Writes the --inside-points file: an InsideHeader followed by the inside samples, in sample order.
+ * @param path Output file.
+ * @param points All the samples of the run.
+ * @param bits Classification bitset (bit k = sample k inside).
+ * @param num_points Number of samples.
+ * @param count Number of set bits.
+ * @return true on success, else false.
+ */
+bool write_inside_points(const char *path, Point *points, const uint64_t *bits, int num_points, uint64_t count) {
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) return false;
+
+    InsideHeader header = {INSIDE_MAGIC, 0, count};
+    Point buffer[4096];
+    int used = 0;
+    bool ok = write(fd, &header, sizeof(header)) == (ssize_t) sizeof(header);
+
+    for (int k = 0; ok && k < num_points; k++) {
+        if (bits[k >> 6] & (1ULL << (k & 63))) buffer[used++] = points[k];
+        if (used == 4096 || (k == num_points - 1 && used > 0)) {
+            ok = write(fd, buffer, used * sizeof(Point)) == (ssize_t) (used * sizeof(Point));
+            used = 0;
+        }
+    }
+    return close(fd) == 0 && ok;
+}
+
+/**
+ * @brief Returns the current monotonic time in microseconds.
+ * @return Microseconds since an arbitrary fixed point, shared by all processes.
+ */
+long long trace_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long) ts.tv_sec * 1000000LL + ts.tv_nsec / 1000;
+}
+
+/**
+ * @brief Records a complete event that started at start and ends now in a trace buffer.
+ * @param t Trace buffer (the process buffer or a thread's local buffer).
+ * @param name Name of the phase shown in the timeline.
+ * @param start Start timestamp obtained from trace_now().
+ * @param arg Optional numeric argument (e.g. number of points), or -1.
+ */
+void trace_record(Trace *t, const char *name, long long start, long long arg) {
+    if (t->path == NULL) return;
+    if (t->count >= t->capacity) {
+        int capacity = t->capacity ? t->capacity * 2 : 256;
+        TraceEvent *events = realloc(t->events, capacity * sizeof(TraceEvent));
+        if (events == NULL) return;
+        t->events = events;
+        t->capacity = capacity;
+    }
+    TraceEvent *e = &t->events[t->count++];
+    e->name = name;
+    e->ts = start;
+    e->dur = trace_now() - start;
+    e->arg = arg;
+    e->tid = t->tid;
+}
+
+/**
+ * @brief Records a complete event in the process trace buffer.
+ * @param name Name of the phase shown in the timeline.
+ * @param start Start timestamp obtained from trace_now().
+ * @param arg Optional numeric argument (e.g. number of points), or -1.
+ */
+void trace_add(const char *name, long long start, long long arg) {
+    trace_record(&trace, name, start, arg);
+}
+
+/**
+ * @brief Moves the events of a thread's local buffer into the process buffer.
+ * @param local Thread buffer, emptied and freed on return.
+ */
+void trace_append(Trace *local) {
+    for (int i = 0; i < local->count; i++) {
+        if (trace.count >= trace.capacity) {
+            int capacity = trace.capacity ? trace.capacity * 2 : 256;
+            TraceEvent *events = realloc(trace.events, capacity * sizeof(TraceEvent));
+            if (events == NULL) break;
+            trace.events = events;
+            trace.capacity = capacity;
+        }
+        trace.events[trace.count++] = local->events[i];
+    }
+    free(local->events);
+    local->events = NULL;
+    local->count = local->capacity = 0;
+}
+
+/**
+ * @brief Writes the buffered events of this process as trace-event JSON objects.
+ * @param fd Destination file descriptor.
+ * @param track Name of the track (process) shown in the viewer.
+ * @param first true if no event was written before to fd (controls the comma).
+ */
+void trace_write_events(int fd, const char *track, bool first) {
+    char line[256];
+    int len = snprintf(line, sizeof(line),
+                       "%s{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%d,\"args\":{\"name\":\"%s\"}}",
+                       first ? "" : ",\n", getpid(), getpid(), track);
+    write(fd, line, len);
+    for (int i = 0; i < trace.count; i++) {
+        TraceEvent *e = &trace.events[i];
+        len = snprintf(line, sizeof(line),
+                       ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":%d,\"tid\":%d,\"ts\":%lld,\"dur\":%lld",
+                       e->name, getpid(), e->tid ? e->tid : getpid(), e->ts, e->dur);
+        if (e->arg >= 0)
+            len += snprintf(line + len, sizeof(line) - len, ",\"args\":{\"n\":%lld}}", e->arg);
+        else
+            len += snprintf(line + len, sizeof(line) - len, "}");
+        write(fd, line, len);
+    }
+}
+
+/**
+ * @brief Dumps the events buffered by a child into <trace>.<pid>.part for the parent to merge.
+ * @param track Name of the child's track.
+ */
+void trace_flush_child(const char *track) {
+    if (trace.path == NULL) return;
+    char part[512];
+    snprintf(part, sizeof(part), "%s.%d.part", trace.path, getpid());
+    int fd = open(part, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        perror("Erro ao criar o ficheiro parcial de trace");
+        return;
+    }
+    trace_write_events(fd, track, true);
+    close(fd);
+}
+
+/**
+ * @brief Merges the parent's events and the children's part files into the final trace file.
+ * @param pids Process ids of the children.
+ * @param num_children Number of children.
+ */
+void trace_merge(pid_t pids[], int num_children) {
+    if (trace.path == NULL) return;
+    int fd = open(trace.path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        perror("Erro ao criar o ficheiro de trace");
+        return;
+    }
+    char header[] = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    write(fd, header, strlen(header));
+    trace_write_events(fd, "pai", true);
+
+    for (int i = 0; i < num_children; i++) {
+        char part[512];
+        snprintf(part, sizeof(part), "%s.%d.part", trace.path, pids[i]);
+        int part_fd = open(part, O_RDONLY);
+        if (part_fd < 0) continue;
+        write(fd, ",\n", 2);
+        char buffer[4096];
+        ssize_t bytesRead;
+        while ((bytesRead = read(part_fd, buffer, sizeof(buffer))) > 0) {
+            write(fd, buffer, bytesRead);
+        }
+        close(part_fd);
+        unlink(part);
+    }
+
+    char footer[] = "\n]}\n";
+    write(fd, footer, strlen(footer));
+    close(fd);
+    free(trace.events);
+    trace.events = NULL;
+}
+
+/**
+ * @brief Parses a CPU list such as "0-3,8,10-11".
+ * @param list Text to parse.
+ * @param cpus Output array of CPU numbers.
+ * @param max Capacity of cpus.
+ * @return Number of CPUs parsed.
+ */
+int parse_cpu_list(const char *list, int cpus[], int max) {
+    int count = 0;
+    const char *p = list;
+    while (*p != '\0' && count < max) {
+        char *end;
+        long first = strtol(p, &end, 10);
+        if (end == p) break;
+        long last = first;
+        if (*end == '-') {
+            p = end + 1;
+            last = strtol(p, &end, 10);
+        }
+        for (long c = first; c <= last && count < max; c++) cpus[count++] = (int) c;
+        p = (*end == ',') ? end + 1 : end;
+        if (*end != ',') break;
+    }
+    return count;
+}
+
+/**
+ * @brief Returns the NUMA node of a CPU, read from /sys/devices/system/node.
+ * @param cpu CPU number.
+ * @return Node number, or 0 if the topology is not available.
+ */
+int cpu_node(int cpu) {
+    for (int node = 0; node < 64; node++) {
+        char path[64], list[256];
+        snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist", node);
+        int fd = open(path, O_RDONLY);
+        if (fd < 0) continue;
+        ssize_t len = read(fd, list, sizeof(list) - 1);
+        close(fd);
+        if (len <= 0) continue;
+        list[len] = '\0';
+        int cpus[CPU_SETSIZE];
+        int count = parse_cpu_list(list, cpus, CPU_SETSIZE);
+        for (int i = 0; i < count; i++) {
+            if (cpus[i] == cpu) return node;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Computes the CPU of each worker for an affinity policy.
+ * @param policy "compact", "scatter" or an explicit CPU list.
+ * @param workers Number of workers.
+ * @param cpus Output array with one CPU per worker.
+ * @return true on success, false if the policy is invalid.
+ */
+bool affinity_plan(const char *policy, int workers, int cpus[]) {
+    int allowed[CPU_SETSIZE];
+    int count = 0;
+
+    if (strcmp(policy, "compact") != 0 && strcmp(policy, "scatter") != 0) {
+        count = parse_cpu_list(policy, allowed, CPU_SETSIZE);
+        if (count == 0) return false;
+        for (int i = 0; i < workers; i++) cpus[i] = allowed[i % count];
+        return true;
+    }
+
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (sched_getaffinity(0, sizeof(set), &set) < 0) return false;
+
+    // CPUs permitidos ordenados por nó, para que "compact" encha um nó de cada vez
+    int nodes[CPU_SETSIZE];
+    int num_nodes = 0;
+    for (int c = 0; c < CPU_SETSIZE; c++) {
+        if (!CPU_ISSET(c, &set)) continue;
+        int node = cpu_node(c);
+        int k = count++;
+        while (k > 0 && nodes[k - 1] > node) {
+            allowed[k] = allowed[k - 1];
+            nodes[k] = nodes[k - 1];
+            k--;
+        }
+        allowed[k] = c;
+        nodes[k] = node;
+        if (node + 1 > num_nodes) num_nodes = node + 1;
+    }
+    if (count == 0) return false;
+
+    if (strcmp(policy, "compact") == 0) {
+        for (int i = 0; i < workers; i++) cpus[i] = allowed[i % count];
+        return true;
+    }
+
+    // scatter: distribui os trabalhadores pelos nós de forma alternada
+    int used[CPU_SETSIZE] = {0};
+    for (int i = 0; i < workers; i++) {
+        int node = i % num_nodes;
+        int best = -1;
+        for (int k = 0; k < count; k++) {
+            if (nodes[k] == node && (best < 0 || used[k] < used[best])) best = k;
+        }
+        if (best < 0) best = i % count;
+        used[best]++;
+        cpus[i] = allowed[best];
+    }
+    return true;
+}
+
+/**
+ * @brief Pins the calling thread (or process) to a single CPU.
+ * @param cpu CPU number.
+ * @return true on success, else false.
+ */
+bool pin_to_cpu(int cpu) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    if (sched_setaffinity(0, sizeof(set), &set) < 0) {
+        perror("Erro ao definir a afinidade de CPU");
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Number of samples to classify before the next stream_update() check.
+ * @param s Streaming settings.
+ * @return Samples until the next check.
+ */
+int stream_countdown(Stream *s) {
+    if (s->every > 0 && (s->every_ms == 0 || s->every < STREAM_CHECK)) return (int) s->every;
+    return STREAM_CHECK;
+}
+
+/**
+ * @brief Sends a "+processed;inside" delta line if K samples or T ms passed since the last one.
+ * @param s Streaming state of the worker.
+ * @param fd Pipe/socket to the parent.
+ * @param processed Samples classified so far by the worker.
+ * @param inside Samples found inside so far by the worker.
+ */
+void stream_update(Stream *s, int fd, long long processed, long long inside) {
+    s->countdown = stream_countdown(s);
+    long long now = 0;
+    bool due = s->every > 0 && processed - s->sent_processed >= s->every;
+    if (!due && s->every_ms > 0) {
+        now = trace_now();
+        due = now - s->last_time >= s->every_ms * 1000;
+    }
+    if (!due) return;
+
+    char line[64];
+    int len = snprintf(line, sizeof(line), "+%lld;%lld\n", processed - s->sent_processed, inside - s->sent_inside);
+    write(fd, line, len); // Linha curta: escrita atómica mesmo com várias threads no mesmo pipe
+    s->sent_processed = processed;
+    s->sent_inside = inside;
+    s->last_time = now ? now : trace_now();
+}
+
+/**
+ * @brief Prints the running area estimate and its standard error on the progress line.
+ * @param processed Samples classified so far by all the children.
+ * @param inside Samples found inside so far.
+ * @param total_points Total number of samples of the job.
+ */
+void print_estimate(long long processed, long long inside, long long total_points) {
+    if (processed == 0) return;
+    double p = (double) inside / processed;
+    double area = 4.0 * p;
+    double erro = 4.0 * sqrt(p * (1.0 - p) / processed);
+    printf("\rProgresso: %lld%% | Área ≈ %.6f ± %.6f", processed * 100 / total_points, area, erro);
+    fflush(stdout);
+}
+
+/**
+ * @brief Worker thread of the hybrid mode: classifies a range of the child's samples.
+ * @param arg Pointer to the ChildThreadData of the thread.
+ * @return NULL.
+ */
+void *child_thread(void *arg) {
+    ChildThreadData *data = (ChildThreadData *) arg;
+    int count = data->end - data->start;
+    Point *points = data->points + data->start;
+    Point *polygon = data->polygon;
+    Point *local_points = NULL, *local_polygon = NULL;
+    data->trace.tid = gettid();
+    bool streaming = data->stream.every > 0 || data->stream.every_ms > 0;
+    data->stream.countdown = stream_countdown(&data->stream);
+    data->stream.last_time = trace_now();
+
+    // Tal como nos filhos, a thread fixada copia os dados para memória do seu nó
+    if (data->cpu >= 0 && pin_to_cpu(data->cpu)) {
+        local_points = malloc(count * sizeof(Point));
+        local_polygon = malloc(data->n * sizeof(Point));
+        if (local_points != NULL && local_polygon != NULL) {
+            memcpy(local_points, points, count * sizeof(Point));
+            memcpy(local_polygon, polygon, data->n * sizeof(Point));
+            points = local_points;
+            polygon = local_polygon;
+        }
+    }
+
+    // Com --sweep cada bloco é classificado de uma vez pelo varrimento; com --morton guarda os resultados do bloco
+    unsigned char *dentro_bloco = data->sweep != NULL || data->morton ? malloc(TRACE_CHUNK) : NULL;
+    MortonKey *ordem = data->morton ? malloc(2 * TRACE_CHUNK * sizeof(MortonKey)) : NULL;
+    Point *ordenados = data->morton ? malloc(TRACE_CHUNK * sizeof(Point)) : NULL;
+    if ((dentro_bloco == NULL && (data->sweep != NULL || data->morton)) || (data->morton && (ordem == NULL || ordenados == NULL))) {
+        perror("Erro ao alocar memória para os blocos de amostras");
+        exit(EXIT_FAILURE);
+    }
+    for (int bloco = 0; bloco < count; bloco += TRACE_CHUNK) {
+        int fim_bloco = bloco + TRACE_CHUNK < count ? bloco + TRACE_CHUNK : count;
+        long long t_bloco = trace_now();
+        if (data->sweep != NULL) {
+            sweep_classify(data->sweep, polygon, data->n, data->kernel, points + bloco, fim_bloco - bloco, dentro_bloco,
+                           &data->fallbacks);
+        }
+        if (ordem != NULL) morton_order(points + bloco, fim_bloco - bloco, ordem, ordem + TRACE_CHUNK, ordenados);
+        for (int j = bloco; j < fim_bloco; j++) {
+            int k = ordem != NULL ? bloco + (int) ordem[j - bloco].index : j;
+            Point p = ordem != NULL ? ordenados[j - bloco] : points[j];
+            bool dentro = data->sweep != NULL ? dentro_bloco[k - bloco]
+                                              : classify_sample(data->raster, data->edges, polygon, data->n, data->kernel, p, &data->fallbacks);
+            if (ordem != NULL) dentro_bloco[k - bloco] = dentro;
+            else bitwriter_put(&data->bits, data->first_index + k, dentro);
+            if (dentro) {
+                data->inside++;
+                if (data->verbose && ordem == NULL) {
+                    char output[128];
+                    snprintf(output, sizeof(output), "%d;%6lf;%6lf\n", getpid(), points[k].x, points[k].y);
+                    write(data->out_fd, output, strlen(output)); // Linhas curtas: escrita atómica no pipe
+                }
+            }
+            if (streaming && --data->stream.countdown == 0) stream_update(&data->stream, data->out_fd, j + 1, data->inside);
+        }
+        // Os bits e as linhas do modo verboso seguem a ordem dos índices, uma palavra de cada vez
+        for (int j = bloco; ordem != NULL && j < fim_bloco; j++) {
+            bitwriter_put(&data->bits, data->first_index + j, dentro_bloco[j - bloco]);
+            if (data->verbose && dentro_bloco[j - bloco]) {
+                char output[128];
+                snprintf(output, sizeof(output), "%d;%6lf;%6lf\n", getpid(), points[j].x, points[j].y);
+                write(data->out_fd, output, strlen(output));
+            }
+        }
+        trace_record(&data->trace, "classificar", t_bloco, fim_bloco - bloco);
+    }
+
+    bitwriter_flush(&data->bits);
+    if (data->cpu_used != NULL) *data->cpu_used = sched_getcpu();
+    free(ordenados);
+    free(ordem);
+    free(dentro_bloco);
+    free(local_points);
+    free(local_polygon);
+    return NULL;
+}
+
+/**
+ * @brief Classifies the samples of a child with num_threads threads (hybrid process-by-thread mode).
+ * @param polygon Polygon vertices.
+ * @param n Number of vertices.
+ * @param kernel Classification kernel chosen by select_kernel.
+ * @param edges Float edge data for the --float mode, or NULL.
+ * @param raster Raster lookup table for the --raster mode, or NULL.
+ * @param sweep Polygon prepared for the --sweep mode, or NULL.
+ * @param morton true to visit each block of samples in Morton order.
+ * @param points Samples of the child.
+ * @param count Number of samples.
+ * @param num_threads Number of threads to create.
+ * @param cpus CPU of each thread, or NULL for no affinity.
+ * @param cpus_used Shared array where each thread stores the CPU it ran on, or NULL.
+ * @param verbose true to write each inside point to out_fd.
+ * @param stream Streaming settings; each thread sends its own deltas.
+ * @param out_fd Pipe to the parent.
+ * @param fallbacks Incremented by the number of samples handed to the double kernel by a fast path.
+ * @param bits Shared bitset of the run, or NULL.
+ * @param first_index Global index of points[0].
+ * @return Number of samples inside the polygon.
+ */
+int classify_hybrid(Point *polygon, int n, InsideFn kernel, const FloatEdges *edges, const Raster *raster,
+                    const SweepPolygon *sweep, bool morton, Point *points, int count,
+                    int num_threads, int *cpus, int *cpus_used, bool verbose, Stream stream, int out_fd, long *fallbacks,
+                    uint64_t *bits, long long first_index) {
+    pthread_t threads[num_threads];
+    ChildThreadData data[num_threads];
+    int per_thread = count / num_threads;
+    int extra = count % num_threads;
+    int start = 0;
+
+    for (int t = 0; t < num_threads; t++) {
+        data[t].points = points;
+        data[t].polygon = polygon;
+        data[t].n = n;
+        data[t].kernel = kernel;
+        data[t].edges = edges;
+        data[t].raster = raster;
+        data[t].sweep = sweep;
+        data[t].morton = morton;
+        data[t].fallbacks = 0;
+        data[t].bits = (BitWriter) {bits, -1, 0};
+        data[t].first_index = first_index + start;
+        data[t].start = start;
+        data[t].end = start + per_thread + (t < extra ? 1 : 0);
+        data[t].cpu = cpus != NULL ? cpus[t] : -1;
+        data[t].cpu_used = cpus_used != NULL ? &cpus_used[t] : NULL;
+        data[t].out_fd = out_fd;
+        data[t].verbose = verbose;
+        data[t].inside = 0;
+        data[t].stream = stream;
+        data[t].trace = (Trace) {trace.path, NULL, 0, 0, 0};
+        start = data[t].end;
+        if (pthread_create(&threads[t], NULL, child_thread, &data[t]) != 0) {
+            perror("Erro ao criar thread");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    // Agregação local: um único resumo por processo segue para o pai
+    int inside = 0;
+    for (int t = 0; t < num_threads; t++) {
+        pthread_join(threads[t], NULL);
+        inside += data[t].inside;
+        *fallbacks += data[t].fallbacks;
+        trace_append(&data[t].trace);
+    }
+    return inside;
+}
+
 void update_progress(int total_processed, int total_points) {
     int progress = (total_processed * 100) / total_points;
     printf("\rProgresso: %d%%\n", progress);
@@ -103,8 +1506,8 @@ void update_progress(int total_processed, int total_points) {
 
 
 int main(int argc, char* argv[]) {
-    if (argc != 5) {
-        char usage[] = "Uso: <arquivo_do_poligono> <num_processos_filho> <num_pontos_aleatorios> <modo>\n";
+    char usage[] = "Uso: <arquivo_do_poligono> <num_processos_filho> <num_pontos_aleatorios> <modo> [--trace <saida.json>] [--affinity <compact|scatter|lista_de_cpus>] [--threads <num_threads_por_filho>] [--stream <amostras>] [--stream-ms <ms>] [--float] [--seed <semente>] [--bitset <saida.bin>] [--inside-points <saida.bin>] [--raster <resolucao>] [--sweep] [--morton] [--perf]\n";
+    if (argc < 5) {
         write(STDERR_FILENO, usage, strlen(usage));
         exit(EXIT_FAILURE);
     }
@@ -113,13 +1516,69 @@ int main(int argc, char* argv[]) {
     int num_processos_filho = atoi(argv[2]);
     int num_pontos_aleatorios = atoi(argv[3]);
     char *modo = argv[4];
+    char *afinidade = NULL;
+    int num_threads = 0; // 0: cada filho classifica sozinho; >0: modo híbrido processo x thread
+    Stream stream = {0, 0, 0, 0, 0, 0}; // Resultados parciais a cada K amostras e/ou T ms
+    bool usar_float = false;
+    bool varrimento = false;
+    bool morton = false;
+    bool contadores = false;
+    bool tem_semente = false;
+    uint64_t semente = 0;
+    char *bitset_path = NULL;
+    char *inside_path = NULL;
+    int resolucao_raster = 0;
+
+    // Opções adicionais
+    for (int a = 5; a < argc; a++) {
+        if (strcmp(argv[a], "--trace") == 0 && a + 1 < argc) {
+            trace.path = argv[++a];
+        } else if (strcmp(argv[a], "--affinity") == 0 && a + 1 < argc) {
+            afinidade = argv[++a];
+        } else if (strcmp(argv[a], "--threads") == 0 && a + 1 < argc) {
+            num_threads = atoi(argv[++a]);
+        } else if (strcmp(argv[a], "--stream") == 0 && a + 1 < argc) {
+            stream.every = atoll(argv[++a]);
+        } else if (strcmp(argv[a], "--stream-ms") == 0 && a + 1 < argc) {
+            stream.every_ms = atoll(argv[++a]);
+        } else if (strcmp(argv[a], "--float") == 0) {
+            usar_float = true;
+        } else if (strcmp(argv[a], "--sweep") == 0) {
+            varrimento = true;
+        } else if (strcmp(argv[a], "--morton") == 0) {
+            morton = true;
+        } else if (strcmp(argv[a], "--perf") == 0) {
+            contadores = true;
+        } else if (strcmp(argv[a], "--seed") == 0 && a + 1 < argc) {
+            semente = strtoull(argv[++a], NULL, 10);
+            tem_semente = true;
+        } else if (strcmp(argv[a], "--bitset") == 0 && a + 1 < argc) {
+            bitset_path = argv[++a];
+        } else if (strcmp(argv[a], "--inside-points") == 0 && a + 1 < argc) {
+            inside_path = argv[++a];
+        } else if (strcmp(argv[a], "--raster") == 0 && a + 1 < argc) {
+            resolucao_raster = atoi(argv[++a]);
+        } else {
+            write(STDERR_FILENO, usage, strlen(usage));
+            exit(EXIT_FAILURE);
+        }
+    }
 
-    if (num_processos_filho <= 0 || num_pontos_aleatorios <= 0) {
-        char error[] = "Erro: Números de processos e pontos devem ser maiores que 0.\n";
+    // Os resultados parciais só fazem sentido no modo normal
+    bool streaming = (stream.every > 0 || stream.every_ms > 0) && strcmp(modo, "normal") == 0;
+    if (!streaming) stream.every = stream.every_ms = 0;
+
+    if (num_processos_filho <= 0 || num_pontos_aleatorios <= 0 || num_threads < 0) {
+        char error[] = "Erro: Números de processos, threads e pontos devem ser maiores que 0.\n";
         write(STDERR_FILENO, error, strlen(error));
         exit(EXIT_FAILURE);
     }
+    if (resolucao_raster < 0) {
+        write(STDERR_FILENO, usage, strlen(usage));
+        exit(EXIT_FAILURE);
+    }
 
+    long long t_inicio = trace_now();
     int arquivo = open(poligono, O_RDONLY);
     if (arquivo < 0) {
         perror("Erro ao abrir o arquivo do polígono");
@@ -135,11 +1594,18 @@ int main(int argc, char* argv[]) {
     int capacity = 100;
     int n = 0;
     char buffer[128];
+    size_t pending = 0;
     ssize_t bytesRead;
     char *line, *saveptr;
 
-    while ((bytesRead = read(arquivo, buffer, sizeof(buffer) - 1)) > 0) {
-        buffer[bytesRead] = '\0';
+    // Uma linha partida entre duas leituras fica no início do buffer e é completada pela leitura seguinte
+    while ((bytesRead = read(arquivo, buffer + pending, sizeof(buffer) - 1 - pending)) >= 0) {
+        size_t len = pending + bytesRead;
+        buffer[len] = '\0';
+        char *cut = bytesRead > 0 ? strrchr(buffer, '\n') : NULL;
+        size_t used = cut != NULL ? (size_t) (cut - buffer) + 1 : len;
+        char saved = buffer[used];
+        buffer[used] = '\0';
         line = strtok_r(buffer, "\n", &saveptr);
         while (line != NULL) {
             if (sscanf(line, "%lf %lf", &polygon[n].x, &polygon[n].y) == 2) {
@@ -156,9 +1622,19 @@ int main(int argc, char* argv[]) {
             }
             line = strtok_r(NULL, "\n", &saveptr);
         }
+        if (bytesRead == 0) break;
+        buffer[used] = saved;
+        pending = len - used;
+        memmove(buffer, buffer + used, pending);
     }
 
     close(arquivo);
+    trace_add("carregar_poligono", t_inicio, n);
+    uint64_t hash = polygon_hash(polygon, n);
+    int vertices_lidos = n; // polygon_convexity compacta o polígono; o cabeçalho do bitset descreve o ficheiro
+
+    // Convexidade e orientação detetadas uma vez; polígonos convexos usam o teste em cunha O(log n)
+    bool convex = polygon_convexity(polygon, &n);
 
     if (n < 3) {
         char error[] = "Polígono inválido ou dados insuficientes no arquivo.\n";
@@ -166,6 +1642,7 @@ int main(int argc, char* argv[]) {
         free(polygon);
         exit(EXIT_FAILURE);
     }
+    InsideFn kernel = select_kernel(n, convex);
 
     Point* pontos = malloc(num_pontos_aleatorios * sizeof(Point));
     if (pontos == NULL) {
@@ -174,15 +1651,128 @@ int main(int argc, char* argv[]) {
         exit(EXIT_FAILURE);
     }
 
-    srand((unsigned int)time(NULL) + getpid());
-    for (int i = 0; i < num_pontos_aleatorios; i++) {
-        pontos[i].x = (double) rand() / RAND_MAX * 2.0 - 1.0;
-        pontos[i].y = (double) rand() / RAND_MAX * 2.0 - 1.0;
+    t_inicio = trace_now();
+    // Com --seed ou saída binária, as amostras vêm do gerador por contador e podem ser regeneradas
+    bool por_contador = tem_semente || bitset_path != NULL || inside_path != NULL;
+    if (por_contador) {
+        if (!tem_semente) semente = ((uint64_t) time(NULL) << 20) ^ (uint64_t) getpid();
+        for (int i = 0; i < num_pontos_aleatorios; i++) pontos[i] = lease_sample(semente, i);
+    } else {
+        srand((unsigned int)time(NULL) + getpid());
+        for (int i = 0; i < num_pontos_aleatorios; i++) {
+            pontos[i].x = (double) rand() / RAND_MAX * 2.0 - 1.0;
+            pontos[i].y = (double) rand() / RAND_MAX * 2.0 - 1.0;
+        }
+    }
+    trace_add("gerar_amostras", t_inicio, num_pontos_aleatorios);
+
+    // Bitset partilhado com os filhos (MAP_SHARED): em ficheiro com --bitset, anónimo se só houver --inside-points
+    BitsetHeader *bitset = NULL;
+    uint64_t *bits = NULL;
+    size_t bitset_size = sizeof(BitsetHeader) + ((size_t) num_pontos_aleatorios + 63) / 64 * sizeof(uint64_t);
+    if (bitset_path != NULL || inside_path != NULL) {
+        int fd_bitset = -1;
+        if (bitset_path != NULL) {
+            fd_bitset = open(bitset_path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+            if (fd_bitset < 0 || ftruncate(fd_bitset, bitset_size) < 0) {
+                perror("Erro ao criar o ficheiro do bitset");
+                exit(EXIT_FAILURE);
+            }
+        }
+        bitset = mmap(NULL, bitset_size, PROT_READ | PROT_WRITE,
+                      fd_bitset >= 0 ? MAP_SHARED : MAP_SHARED | MAP_ANONYMOUS, fd_bitset, 0);
+        if (fd_bitset >= 0) close(fd_bitset);
+        if (bitset == MAP_FAILED) {
+            perror("Erro ao mapear o bitset");
+            exit(EXIT_FAILURE);
+        }
+        bitset->magic = BITSET_MAGIC;
+        bitset->sampler = SAMPLER_SPLITMIX64;
+        bitset->seed = semente;
+        bitset->num_points = num_pontos_aleatorios;
+        bitset->polygon_hash = hash;
+        bitset->num_vertices = vertices_lidos;
+        bits = (uint64_t *) (bitset + 1);
+    }
+
+    // Modo float: arestas em float32 (SoA), partilhadas com os filhos; amostras incertas voltam a double
+    FloatEdges float_edges = {NULL, NULL, 0, 0.0f, 0.0f};
+    if (usar_float && !float_edges_build(&float_edges, polygon, n, 1.0)) {
+        char warning[] = "Aviso: polígono fora do alcance do modo float; a usar apenas double.\n";
+        write(STDERR_FILENO, warning, strlen(warning));
+        usar_float = false;
+    }
+    const FloatEdges *edges = usar_float ? &float_edges : NULL;
+
+    // Raster: tabela de 2 bits por píxel, construída uma vez e lida pelos filhos sem cópia
+    Raster mapa = {NULL, 0, 0, 0, 0, 0, 0};
+    // A paridade dos píxeis conta todos os cruzamentos à direita; o raio do núcleo acaba em x = 2.5
+    for (int i = 0; i < n && resolucao_raster > 0; i++) {
+        if (polygon[i].x >= 2.5) {
+            char warning[] = "Aviso: polígono fora do alcance do raster; a classificar sem raster.\n";
+            write(STDERR_FILENO, warning, strlen(warning));
+            resolucao_raster = 0;
+        }
+    }
+    if (resolucao_raster > 0) {
+        t_inicio = trace_now();
+        if (!raster_build(&mapa, polygon, n, resolucao_raster)) {
+            perror("Erro ao construir o raster");
+            exit(EXIT_FAILURE);
+        }
+        long long fronteira = 0;
+        for (long long k = 0; k < (long long) resolucao_raster * resolucao_raster; k++)
+            fronteira += ((mapa.cells[k >> 2] >> ((k & 3) * 2)) & 3) == RASTER_BOUNDARY;
+        trace_add("construir_raster", t_inicio, resolucao_raster);
+        printf("Raster: %dx%d (%zu KiB), %.2f%% de píxeis de fronteira, construído em %.3f s\n",
+               resolucao_raster, resolucao_raster, mapa.bytes / 1024,
+               100.0 * fronteira / ((double) resolucao_raster * resolucao_raster), (trace_now() - t_inicio) / 1e6);
+        fflush(stdout);
+    }
+    const Raster *raster = resolucao_raster > 0 ? &mapa : NULL;
+
+    // Varrimento por blocos com tabela de arestas ativas; substitui os caminhos --float e --raster
+    SweepPolygon varrimento_poligono = {NULL, 0, NULL, 0};
+    if (varrimento && !sweep_build(&varrimento_poligono, polygon, n)) {
+        char warning[] = "Aviso: polígono fora do alcance do varrimento (x >= 2.5 ou arestas que se cruzam); a classificar amostra a amostra.\n";
+        write(STDERR_FILENO, warning, strlen(warning));
+        varrimento = false;
+    }
+    const SweepPolygon *sweep = varrimento ? &varrimento_poligono : NULL;
+    if (sweep != NULL && (edges != NULL || raster != NULL)) {
+        char warning[] = "Aviso: --float e --raster ignorados com --sweep.\n";
+        write(STDERR_FILENO, warning, strlen(warning));
+    }
+    if (sweep != NULL && morton) {
+        // O varrimento já ordena cada bloco por y
+        char warning[] = "Aviso: --morton ignorado com --sweep.\n";
+        write(STDERR_FILENO, warning, strlen(warning));
+        morton = false;
     }
 
     int fd[num_processos_filho][2];
     pid_t pids[num_processos_filho];
 
+    // Plano de colocação dos filhos nos CPUs (no modo híbrido, das threads de cada filho)
+    int trabalhadores_por_filho = num_threads > 0 ? num_threads : 1;
+    int cpus[num_processos_filho * trabalhadores_por_filho];
+    if (afinidade != NULL && !affinity_plan(afinidade, num_processos_filho * trabalhadores_por_filho, cpus)) {
+        char error[] = "Erro: Política de afinidade inválida.\n";
+        write(STDERR_FILENO, error, strlen(error));
+        exit(EXIT_FAILURE);
+    }
+    // CPU em que cada filho (ou thread) correu de facto, medido por ele próprio: um sched_setaffinity falhado fica à vista
+    int *cpus_reais = NULL;
+    size_t cpus_reais_size = num_processos_filho * trabalhadores_por_filho * sizeof(int);
+    if (afinidade != NULL) {
+        cpus_reais = mmap(NULL, cpus_reais_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+        if (cpus_reais == MAP_FAILED) {
+            perror("Erro ao mapear os CPUs dos filhos");
+            exit(EXIT_FAILURE);
+        }
+        for (int i = 0; i < num_processos_filho * trabalhadores_por_filho; i++) cpus_reais[i] = -1;
+    }
+
     for (int i = 0; i < num_processos_filho; i++) {
         if (pipe(fd[i]) == -1) {
             perror("Erro ao criar pipe");
@@ -191,33 +1781,145 @@ int main(int argc, char* argv[]) {
             exit(EXIT_FAILURE);
         }
         // Cria um processo filho
+        t_inicio = trace_now();
         pid_t pid = fork();
         if (pid == 0) {
+            trace.count = 0; // Os eventos herdados pertencem ao pai
             close(fd[i][0]);
             int pontos_por_filho = num_pontos_aleatorios / num_processos_filho;
             int pontos_extra = num_pontos_aleatorios % num_processos_filho;
             int pontos_a_processar = pontos_por_filho + (i < pontos_extra ? 1 : 0);
             int pontos_dentro = 0;
+            int inicio = i * pontos_por_filho + (i < pontos_extra ? i : pontos_extra);
+            Point *amostras = pontos + inicio;
+            Point *poligono_local = polygon;
 
-            // Verifica quais pontos estão dentro do polígono
-            for (int j = i * pontos_por_filho + (i < pontos_extra ? i : pontos_extra); j < i * pontos_por_filho + (i < pontos_extra ? i : pontos_extra) + pontos_a_processar; j++) {
-                if (isInsidePolygon(polygon, n, pontos[j])) {
-                    pontos_dentro++;
-                    if (strcmp(modo, "verboso") == 0) {
+            // Com afinidade, o filho fixa-se no CPU e copia o polígono e as suas amostras
+            // para memória própria, tocada primeiro no nó local
+            if (afinidade != NULL && num_threads == 0 && pin_to_cpu(cpus[i])) {
+                Point *copia_amostras = malloc(pontos_a_processar * sizeof(Point));
+                Point *copia_poligono = malloc(n * sizeof(Point));
+                if (copia_amostras != NULL && copia_poligono != NULL) {
+                    memcpy(copia_amostras, amostras, pontos_a_processar * sizeof(Point));
+                    memcpy(copia_poligono, polygon, n * sizeof(Point));
+                    amostras = copia_amostras;
+                    poligono_local = copia_poligono;
+                }
+            }
+
+            long reavaliadas = 0;
+            BitWriter escritor = {bits, -1, 0};
+
+            // Contadores de hardware da classificação, herdados pelas threads do filho
+            int falhas_cache = -1, falhas_l1 = -1;
+            if (contadores) {
+                falhas_cache = perf_open(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES);
+                falhas_l1 = perf_open(PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                                                          (PERF_COUNT_HW_CACHE_RESULT_MISS << 16));
+                if (falhas_cache >= 0) ioctl(falhas_cache, PERF_EVENT_IOC_ENABLE, 0);
+                if (falhas_l1 >= 0) ioctl(falhas_l1, PERF_EVENT_IOC_ENABLE, 0);
+            }
+            long long t_classificar = trace_now();
+            if (num_threads > 0) {
+                pontos_dentro = classify_hybrid(poligono_local, n, kernel, edges, raster, sweep, morton, amostras,
+                                                pontos_a_processar, num_threads, afinidade != NULL ? &cpus[i * num_threads] : NULL,
+                                                afinidade != NULL ? &cpus_reais[i * num_threads] : NULL,
+                                                strcmp(modo, "verboso") == 0, stream, fd[i][1], &reavaliadas,
+                                                bits, inicio);
+            }
+            stream.countdown = stream_countdown(&stream);
+            stream.last_time = trace_now();
+
+            // Verifica quais pontos estão dentro do polígono, em blocos para o trace
+            unsigned char *dentro_bloco = (sweep != NULL || morton) && num_threads == 0 ? malloc(TRACE_CHUNK) : NULL;
+            MortonKey *ordem = morton && num_threads == 0 ? malloc(2 * TRACE_CHUNK * sizeof(MortonKey)) : NULL;
+            Point *ordenados = morton && num_threads == 0 ? malloc(TRACE_CHUNK * sizeof(Point)) : NULL;
+            if (num_threads == 0 && ((dentro_bloco == NULL && (sweep != NULL || morton)) ||
+                                     (morton && (ordem == NULL || ordenados == NULL)))) {
+                perror("Erro ao alocar memória para os blocos de amostras");
+                exit(EXIT_FAILURE);
+            }
+            for (int bloco = 0; num_threads == 0 && bloco < pontos_a_processar; bloco += TRACE_CHUNK) {
+                int fim_bloco = bloco + TRACE_CHUNK < pontos_a_processar ? bloco + TRACE_CHUNK : pontos_a_processar;
+                long long t_bloco = trace_now();
+                if (sweep != NULL) {
+                    sweep_classify(sweep, poligono_local, n, kernel, amostras + bloco, fim_bloco - bloco, dentro_bloco,
+                                   &reavaliadas);
+                }
+                // Com --morton o bloco é percorrido pela curva em Z: amostras seguidas caem em células vizinhas
+                if (ordem != NULL) morton_order(amostras + bloco, fim_bloco - bloco, ordem, ordem + TRACE_CHUNK, ordenados);
+                for (int j = bloco; j < fim_bloco; j++) {
+                    int k = ordem != NULL ? bloco + (int) ordem[j - bloco].index : j;
+                    Point p = ordem != NULL ? ordenados[j - bloco] : amostras[j];
+                    bool dentro = sweep != NULL ? dentro_bloco[k - bloco]
+                                                : classify_sample(raster, edges, poligono_local, n, kernel, p, &reavaliadas);
+                    if (ordem != NULL) dentro_bloco[k - bloco] = dentro;
+                    else bitwriter_put(&escritor, inicio + k, dentro);
+                    if (dentro) {
+                        pontos_dentro++;
+                        if (ordem == NULL && strcmp(modo, "verboso") == 0) {
+                            char output[128];
+                            snprintf(output, sizeof(output), "%d;%6lf;%6lf\n", getpid(), amostras[k].x, amostras[k].y);
+                            write(fd[i][1], output, strlen(output)); // Utiliza a função write para escrever no pipe
+                        }
+                    }
+                    if (streaming && --stream.countdown == 0) stream_update(&stream, fd[i][1], j + 1, pontos_dentro);
+                }
+                // Com --morton os bits e as linhas do modo verboso seguem a ordem dos índices
+                for (int j = bloco; ordem != NULL && j < fim_bloco; j++) {
+                    bitwriter_put(&escritor, inicio + j, dentro_bloco[j - bloco]);
+                    if (dentro_bloco[j - bloco] && strcmp(modo, "verboso") == 0) {
                         char output[128];
-                        snprintf(output, sizeof(output), "%d;%6lf;%6lf\n", getpid(), pontos[j].x, pontos[j].y);
-                        write(fd[i][1], output, strlen(output)); // Utiliza a função write para escrever no pipe
+                        snprintf(output, sizeof(output), "%d;%6lf;%6lf\n", getpid(), amostras[j].x, amostras[j].y);
+                        write(fd[i][1], output, strlen(output));
                     }
                 }
+                trace_add("classificar", t_bloco, fim_bloco - bloco);
+            }
+            bitwriter_flush(&escritor);
+            if (afinidade != NULL && num_threads == 0) cpus_reais[i] = sched_getcpu();
+            free(ordenados);
+            free(ordem);
+            free(dentro_bloco);
+
+            if (contadores) {
+                double segundos = (trace_now() - t_classificar) / 1e6;
+                if (falhas_cache >= 0) ioctl(falhas_cache, PERF_EVENT_IOC_DISABLE, 0);
+                if (falhas_l1 >= 0) ioctl(falhas_l1, PERF_EVENT_IOC_DISABLE, 0);
+                long long cache = perf_read(falhas_cache), l1 = perf_read(falhas_l1);
+                char output[200];
+                int len = snprintf(output, sizeof(output), "Filho %d (pid %d): %.2f ns/amostra%s", i, getpid(),
+                                   1e9 * segundos / pontos_a_processar, morton ? " (ordem de Morton)" : "");
+                if (cache >= 0) len += snprintf(output + len, sizeof(output) - len, ", %.4f falhas de cache/amostra", (double) cache / pontos_a_processar);
+                if (l1 >= 0) len += snprintf(output + len, sizeof(output) - len, ", %.4f falhas L1d/amostra", (double) l1 / pontos_a_processar);
+                if (cache < 0 && l1 < 0) len += snprintf(output + len, sizeof(output) - len, ", contadores de hardware indisponíveis");
+                snprintf(output + len, sizeof(output) - len, "\n");
+                write(STDOUT_FILENO, output, strlen(output));
+                if (falhas_cache >= 0) close(falhas_cache);
+                if (falhas_l1 >= 0) close(falhas_l1);
+            }
+
+            if (usar_float || raster != NULL || sweep != NULL) {
+                double segundos = (trace_now() - t_classificar) / 1e6;
+                char output[160];
+                snprintf(output, sizeof(output), "Filho %d (pid %d): %ld de %d amostras classificadas pelo núcleo double (%.4f%%), %.2f Mamostras/s\n",
+                         i, getpid(), reavaliadas, pontos_a_processar, 100.0 * reavaliadas / pontos_a_processar,
+                         segundos > 0 ? pontos_a_processar / segundos / 1e6 : 0.0);
+                write(STDOUT_FILENO, output, strlen(output));
             }
 
             if (strcmp(modo, "normal") == 0) {
+                long long t_envio = trace_now();
                 char output[128];
                 snprintf(output, sizeof(output), "%d;%d;%d\n", getpid(), pontos_a_processar, pontos_dentro);
                 write(fd[i][1], output, strlen(output)); // Utiliza a função write para escrever no pipe
+                trace_add("enviar_resultado", t_envio, -1);
             }
 
             close(fd[i][1]);
+            char track[32];
+            snprintf(track, sizeof(track), "filho %d", i);
+            trace_flush_child(track);
             free(pontos);
             free(polygon);
             exit(EXIT_FAILURE);
@@ -229,15 +1931,79 @@ int main(int argc, char* argv[]) {
         } else {
             pids[i] = pid;
             close(fd[i][1]);
+            trace_add("fork", t_inicio, pid);
         }
     }
     // Aguarda a finalização dos processos filhos
     int total_pontos_dentro = 0;
     int total_pontos_processados = 0;
 
-    for (int i = 0; i < num_processos_filho; i++) {
+    if (streaming) {
+        // Lê todos os pipes em simultâneo para refinar a estimativa à medida que chegam os parciais
+        char linhas[num_processos_filho][256];
+        size_t tamanhos[num_processos_filho];
+        long long parciais[num_processos_filho][2];
+        long long vivos_processados = 0, vivos_dentro = 0;
+        int abertos = num_processos_filho;
+        memset(tamanhos, 0, sizeof(tamanhos));
+        memset(parciais, 0, sizeof(parciais));
+
+        while (abertos > 0) {
+            struct pollfd fds[num_processos_filho];
+            for (int i = 0; i < num_processos_filho; i++) {
+                fds[i].fd = fd[i][0];
+                fds[i].events = POLLIN;
+            }
+            if (poll(fds, num_processos_filho, -1) < 0) {
+                if (errno == EINTR) continue;
+                perror("Erro no poll");
+                break;
+            }
+            for (int i = 0; i < num_processos_filho; i++) {
+                if (fds[i].fd < 0 || !(fds[i].revents & (POLLIN | POLLHUP))) continue;
+                t_inicio = trace_now();
+                ssize_t lidos = read(fd[i][0], linhas[i] + tamanhos[i], sizeof(linhas[i]) - 1 - tamanhos[i]);
+                if (lidos <= 0) {
+                    close(fd[i][0]);
+                    fd[i][0] = -1;
+                    abertos--;
+                    continue;
+                }
+                tamanhos[i] += lidos;
+                linhas[i][tamanhos[i]] = '\0';
+
+                char *fim_linha;
+                while ((fim_linha = strchr(linhas[i], '\n')) != NULL) {
+                    *fim_linha = '\0';
+                    long long processed, inside;
+                    int pid;
+                    if (sscanf(linhas[i], "+%lld;%lld", &processed, &inside) == 2) {
+                        parciais[i][0] += processed;
+                        parciais[i][1] += inside;
+                        vivos_processados += processed;
+                        vivos_dentro += inside;
+                    } else if (sscanf(linhas[i], "%d;%lld;%lld", &pid, &processed, &inside) == 3) {
+                        // O resultado final substitui os parciais deste filho
+                        printf("\r%d;%lld;%lld\n", pid, processed, inside);
+                        vivos_processados += processed - parciais[i][0];
+                        vivos_dentro += inside - parciais[i][1];
+                        total_pontos_processados += processed;
+                        total_pontos_dentro += inside;
+                    }
+                    tamanhos[i] -= fim_linha + 1 - linhas[i];
+                    memmove(linhas[i], fim_linha + 1, tamanhos[i] + 1);
+                }
+                trace_add("ler_pipe", t_inicio, pids[i]);
+            }
+            print_estimate(vivos_processados, vivos_dentro, num_pontos_aleatorios);
+        }
+        printf("\n");
+    }
+
+    for (int i = 0; !streaming && i < num_processos_filho; i++) {
         char buffer[1024];
         ssize_t bytesRead;
+        t_inicio = trace_now();
     // Lê os resultados dos processos filhos
         while ((bytesRead = read(fd[i][0], buffer, sizeof(buffer) - 1)) > 0) {
             buffer[bytesRead] = '\0';
@@ -257,15 +2023,53 @@ int main(int argc, char* argv[]) {
             }
         }
         close(fd[i][0]);
+        trace_add("ler_pipe", t_inicio, pids[i]);
     }
     while (wait(NULL) > 0);
 
+    // Saída binária: contagem a partir do bitset e, com --inside-points, os pontos dentro
+    if (bitset != NULL) {
+        t_inicio = trace_now();
+        uint64_t dentro = 0;
+        for (size_t w = 0; w < ((size_t) num_pontos_aleatorios + 63) / 64; w++) dentro += __builtin_popcountll(bits[w]);
+        bitset->inside = dentro;
+        if (inside_path != NULL && !write_inside_points(inside_path, pontos, bits, num_pontos_aleatorios, dentro))
+            perror("Erro ao escrever os pontos dentro do polígono");
+        if (bitset_path != NULL)
+            printf("Bitset: %s (%d amostras, %zu bytes, semente %llu)\n", bitset_path, num_pontos_aleatorios,
+                   bitset_size, (unsigned long long) semente);
+        munmap(bitset, bitset_size);
+        trace_add("saida_binaria", t_inicio, (long long) dentro);
+    }
+
+    t_inicio = trace_now();
     if (total_pontos_dentro > 0) {
         double area_of_reference = 4.0;
         double estimated_area = ((double)total_pontos_dentro / num_pontos_aleatorios) * area_of_reference;
         printf("Área estimada do polígono: %.6f unidades quadradas\n", estimated_area);
     }
+    if (afinidade != NULL) {
+        for (int i = 0; i < num_processos_filho; i++) {
+            if (num_threads == 0) {
+                printf("Filho %d (pid %d): CPU %d (nó %d), planeado CPU %d%s\n", i, pids[i], cpus_reais[i],
+                       cpu_node(cpus_reais[i]), cpus[i], cpus_reais[i] != cpus[i] ? " (afinidade não aplicada)" : "");
+                continue;
+            }
+            for (int t = 0; t < num_threads; t++) {
+                int cpu = cpus_reais[i * num_threads + t], planeado = cpus[i * num_threads + t];
+                printf("Filho %d (pid %d), thread %d: CPU %d (nó %d), planeado CPU %d%s\n", i, pids[i], t, cpu,
+                       cpu_node(cpu), planeado, cpu != planeado ? " (afinidade não aplicada)" : "");
+            }
+        }
+        munmap(cpus_reais, cpus_reais_size);
+    }
+    trace_add("agregacao", t_inicio, -1);
+    fflush(stdout);
+    trace_merge(pids, num_processos_filho);
 
+    if (raster != NULL) munmap(mapa.cells, mapa.bytes);
+    free(float_edges.x);
+    free(float_edges.y);
     free(pontos);
     free(polygon);
     exit(EXIT_FAILURE);
@@ -1,25 +1,164 @@
 
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdint.h>
 #include <stdbool.h>
 #include <time.h>
 #include <unistd.h>
 #include <fcntl.h>
 #include <math.h>
+#include <float.h>
 #include <sys/wait.h>
+#include <sched.h>
 #include <sys/socket.h>
 #include <sys/un.h>
+#include <sys/uio.h>
+#include <sys/stat.h>
+#include <limits.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+#include <poll.h>
+#include <pthread.h>
 #include <string.h>
 #include <errno.h>
 
 #define SOCKET_PATH "/tmp/polygon_socket"
 #define BUFFER_SIZE 1024
+#define TRACE_CHUNK 65536
+#define LEASE_CHUNK 16384
+#define STREAM_CHECK 1024
+#define SINK_BLOCK (256 * 1024)
+#define SINK_BATCH 64
+
+// Limite de erro relativo do determinante de orientação em double (Shewchuk, ccwerrboundA)
+#define ORIENT_ERRBOUND ((3.0 + 8.0 * DBL_EPSILON) * DBL_EPSILON / 2.0)
 
 typedef struct {
     double x;
     double y;
 } Point;
 
+typedef struct {
+    const char *name;
+    long long ts;
+    long long dur;
+    long long arg;
+} TraceEvent;
+
+typedef struct {
+    const char *path;
+    TraceEvent *events;
+    int count;
+    int capacity;
+} Trace;
+
+static Trace trace = {NULL, NULL, 0, 0};
+
+typedef struct {
+    long long every;
+    long long every_ms;
+    int countdown;
+    long long last_time;
+    long long sent_processed;
+    long long sent_inside;
+} Stream;
+
+typedef struct {
+    long long start;
+    long long count;
+} Lease;
+
+typedef struct {
+    int fd;
+    int pid;
+    char buffer[128];
+    size_t len;
+    Lease lease;
+    long long processed;
+    long long inside;
+    int chunks;
+} LeaseClient;
+
+typedef struct {
+    long long num_points;
+    long long chunk;
+    long long next;
+    Lease *requeued;
+    int num_requeued;
+    long long done;
+    long long inside;
+} LeaseJob;
+
+// Anel io_uring mínimo, configurado com as chamadas de sistema diretas
+typedef struct {
+    int fd;
+    void *sq_ptr, *cq_ptr;
+    size_t sq_len, cq_len, sqes_len;
+    unsigned *sq_tail, *sq_mask, *sq_array;
+    unsigned *cq_head, *cq_tail, *cq_mask;
+    struct io_uring_sqe *sqes;
+    struct io_uring_cqe *cqes;
+} Ring;
+
+typedef struct SinkBlock {
+    struct SinkBlock *next;
+    size_t len;
+    char data[SINK_BLOCK];
+} SinkBlock;
+
+// Saída assíncrona de um trabalhador: blocos preenchidos pelo trabalhador, escritos por ordem por uma thread
+typedef struct {
+    int fd;
+    SinkBlock *current;                 // Bloco a ser preenchido pelo trabalhador
+    SinkBlock *queue_head, *queue_tail; // Blocos cheios à espera de escrita, por ordem
+    SinkBlock *free_list;               // Blocos já escritos, para reutilizar
+    bool closing;
+    bool use_ring;
+    bool line_chunks;                   // Destino partilhado que não é ficheiro regular: escritas de até PIPE_BUF
+    Ring ring;
+    pthread_t thread;
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+} OutSink;
+
+/**
+ * @brief Exact sign of the orientation determinant, used when the floating-point filter is inconclusive.
+ *
+ * The determinant is expanded into six products of input coordinates. Each product is split exactly
+ * with fma and the twelve terms are accumulated into a non-overlapping expansion (two_sum), whose
+ * most significant nonzero component has the sign of the exact result.
+ *
+ * @param p First point of the triplet.
+ * @param q Second point of the triplet.
+ * @param r Third point of the triplet.
+ * @return 0 if p, q, and r are colinear, 1 if clockwise, 2 if counterclockwise.
+ */
+int orientation_exact(Point p, Point q, Point r) {
+    double a[6] = {q.y, -p.y, p.y, -q.x, p.x, -p.x};
+    double b[6] = {r.x, r.x, q.x, r.y, r.y, q.y};
+    double e[12];
+    int m = 0;
+
+    for (int k = 0; k < 12; k++) {
+        double product = a[k / 2] * b[k / 2];
+        double term = (k % 2 == 0) ? product : fma(a[k / 2], b[k / 2], -product);
+        for (int i = 0; i < m; i++) {
+            double s = term + e[i];
+            double bv = s - term;
+            e[i] = (term - (s - bv)) + (e[i] - bv);
+            term = s;
+        }
+        e[m++] = term;
+    }
+
+    for (int i = m - 1; i >= 0; i--) {
+        if (e[i] != 0.0) return (e[i] > 0) ? 1 : 2;
+    }
+    return 0;
+}
+
 /**
  * @brief Determines the orientation of an ordered triplet (p, q, r).
  * @param p First point of the triplet.
@@ -28,10 +167,15 @@ typedef struct {
  * @return 0 if p, q, and r are colinear, 1 if clockwise, 2 if counterclockwise.
  */
 int orientation(Point p, Point q, Point r) {
-    double val = (q.y - p.y) * (r.x - q.x) - (q.x - p.x) * (r.y - q.y);
+    double left = (q.y - p.y) * (r.x - q.x);
+    double right = (q.x - p.x) * (r.y - q.y);
+    double val = left - right;
 
-    if (val == 0) return 0;
-    return (val > 0) ? 1 : 2;
+    // Filtro: o sinal em double é garantido fora do limite de erro; caso contrário, aritmética exata
+    double bound = ORIENT_ERRBOUND * (fabs(left) + fabs(right));
+    if (val > bound) return 1;
+    if (-val > bound) return 2;
+    return orientation_exact(p, q, r);
 }
 
 /**
@@ -43,7 +187,7 @@ int orientation(Point p, Point q, Point r) {
  */
 bool onSegment(Point p, Point q, Point r) {
     if (q.x <= fmax(p.x, r.x) && q.x >= fmin(p.x, r.x) &&
-        q.y <= fmax(p.y, r.y) && q.y >= fmin(p.x, r.x))
+        q.y <= fmax(p.y, r.y) && q.y >= fmin(p.y, r.y))
         return true;
 
     return false;
@@ -101,13 +245,364 @@ bool isInsidePolygon(Point polygon[], int n, Point p) {
     return count & 1;
 }
 
+/**
+ * @brief Writes v with six decimal places, rounded exactly like printf("%.6f").
+ *
+ * The product v * 1e6 is split with fma into its rounded value and exact residual, so the
+ * rounding decision is taken on the exact scaled value instead of the rounded product.
+ *
+ * @param out Output buffer (at least 32 bytes).
+ * @param v Value to format.
+ * @return Number of characters written.
+ */
+int format_fixed6(char *out, double v) {
+    if (!(fabs(v) < 1e9)) return sprintf(out, "%.6f", v);
+
+    char *p = out;
+    if (signbit(v)) {
+        *p++ = '-';
+        v = -v;
+    }
+    double scaled = v * 1e6;
+    double residual = fma(v, 1e6, -scaled);
+    double k = floor(scaled);
+    double d = (scaled - k) - 0.5;
+    // Acima de meio (ou exatamente meio com resíduo positivo, ou empate exato com k ímpar): arredonda para cima
+    if (d > 0 || (d == 0 && (residual > 0 || (residual == 0 && fmod(k, 2.0) != 0)))) k += 1;
+
+    unsigned long long q = (unsigned long long) k;
+    unsigned long long integer = q / 1000000, fraction = q % 1000000;
+    char digits[20];
+    int nd = 0;
+    do {
+        digits[nd++] = (char) ('0' + integer % 10);
+        integer /= 10;
+    } while (integer > 0);
+    while (nd > 0) *p++ = digits[--nd];
+    *p++ = '.';
+    for (int i = 5; i >= 0; i--) {
+        p[i] = (char) ('0' + fraction % 10);
+        fraction /= 10;
+    }
+    return (int) (p + 6 - out);
+}
+
+/**
+ * @brief Sets up an io_uring instance through the raw system calls (no liburing).
+ * @param ring Ring to fill.
+ * @param entries Number of submission entries.
+ * @return true on success; false if io_uring is unavailable or lacks current-position writes.
+ */
+bool ring_setup(Ring *ring, unsigned entries) {
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    ring->fd = (int) syscall(__NR_io_uring_setup, entries, &params);
+    if (ring->fd < 0) return false;
+    if (!(params.features & IORING_FEAT_RW_CUR_POS)) {
+        close(ring->fd);
+        return false;
+    }
+
+    ring->sq_len = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    ring->cq_len = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        if (ring->cq_len > ring->sq_len) ring->sq_len = ring->cq_len;
+        ring->cq_len = ring->sq_len;
+    }
+    ring->sqes_len = params.sq_entries * sizeof(struct io_uring_sqe);
+
+    ring->sq_ptr = mmap(NULL, ring->sq_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd,
+                        IORING_OFF_SQ_RING);
+    ring->cq_ptr = (params.features & IORING_FEAT_SINGLE_MMAP) ? ring->sq_ptr :
+                   mmap(NULL, ring->cq_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd,
+                        IORING_OFF_CQ_RING);
+    ring->sqes = mmap(NULL, ring->sqes_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd,
+                      IORING_OFF_SQES);
+    if (ring->sq_ptr == MAP_FAILED || ring->cq_ptr == MAP_FAILED || ring->sqes == MAP_FAILED) {
+        close(ring->fd);
+        return false;
+    }
+
+    char *sq = ring->sq_ptr, *cq = ring->cq_ptr;
+    ring->sq_tail = (unsigned *) (sq + params.sq_off.tail);
+    ring->sq_mask = (unsigned *) (sq + params.sq_off.ring_mask);
+    ring->sq_array = (unsigned *) (sq + params.sq_off.array);
+    ring->cq_head = (unsigned *) (cq + params.cq_off.head);
+    ring->cq_tail = (unsigned *) (cq + params.cq_off.tail);
+    ring->cq_mask = (unsigned *) (cq + params.cq_off.ring_mask);
+    ring->cqes = (struct io_uring_cqe *) (cq + params.cq_off.cqes);
+    return true;
+}
+
+void ring_close(Ring *ring) {
+    munmap(ring->sqes, ring->sqes_len);
+    if (ring->cq_ptr != ring->sq_ptr) munmap(ring->cq_ptr, ring->cq_len);
+    munmap(ring->sq_ptr, ring->sq_len);
+    close(ring->fd);
+}
+
+/**
+ * @brief Submits one IORING_OP_WRITEV at the current file position and waits for its completion.
+ * @param ring Ring set up by ring_setup.
+ * @param fd Destination descriptor.
+ * @param iov Buffers to write.
+ * @param iovcnt Number of buffers.
+ * @return Bytes written, or -errno.
+ */
+ssize_t ring_writev(Ring *ring, int fd, const struct iovec *iov, int iovcnt) {
+    unsigned tail = *ring->sq_tail;
+    unsigned index = tail & *ring->sq_mask;
+    struct io_uring_sqe *sqe = &ring->sqes[index];
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = IORING_OP_WRITEV;
+    sqe->fd = fd;
+    sqe->addr = (uint64_t) (uintptr_t) iov;
+    sqe->len = (unsigned) iovcnt;
+    sqe->off = (uint64_t) -1; // Posição atual do ficheiro, como write()
+    ring->sq_array[index] = index;
+    __atomic_store_n(ring->sq_tail, tail + 1, __ATOMIC_RELEASE);
+
+    int submitted;
+    do {
+        submitted = (int) syscall(__NR_io_uring_enter, ring->fd, 1, 1, IORING_ENTER_GETEVENTS, NULL, 0);
+    } while (submitted < 0 && errno == EINTR);
+    if (submitted < 0) return -errno;
+
+    unsigned head = *ring->cq_head;
+    while (head == __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE)) {
+        if (syscall(__NR_io_uring_enter, ring->fd, 0, 1, IORING_ENTER_GETEVENTS, NULL, 0) < 0 && errno != EINTR)
+            return -errno;
+    }
+    ssize_t result = ring->cqes[head & *ring->cq_mask].res;
+    __atomic_store_n(ring->cq_head, head + 1, __ATOMIC_RELEASE);
+    return result;
+}
+
+/**
+ * @brief Writes the whole iovec array, resuming after short writes; io_uring first, writev as fallback.
+ * @param sink Output sink.
+ * @param iov Buffers to write (modified as they are consumed).
+ * @param iovcnt Number of buffers.
+ */
+void sink_write_all(OutSink *sink, struct iovec *iov, int iovcnt) {
+    while (iovcnt > 0) {
+        ssize_t written;
+        if (sink->use_ring) {
+            written = ring_writev(&sink->ring, sink->fd, iov, iovcnt);
+            if (written < 0 && written != -EINTR && written != -EAGAIN) {
+                // O kernel recusou a operação: o resto da saída segue por writev
+                sink->use_ring = false;
+                continue;
+            }
+        } else {
+            written = writev(sink->fd, iov, iovcnt);
+            if (written < 0 && errno != EINTR && errno != EAGAIN) return;
+        }
+        if (written < 0) continue;
+
+        while (iovcnt > 0 && (size_t) written >= iov->iov_len) {
+            written -= iov->iov_len;
+            iov++;
+            iovcnt--;
+        }
+        if (iovcnt > 0) {
+            iov->iov_base = (char *) iov->iov_base + written;
+            iov->iov_len -= written;
+        }
+    }
+}
+
+/**
+ * @brief Writes a block in pieces of at most PIPE_BUF bytes, each ending at a line break.
+ *
+ * Several processes share the same pipe or terminal; a pipe write of at most PIPE_BUF bytes is atomic,
+ * so whole lines of different children never get mixed.
+ *
+ * @param sink Output sink.
+ * @param data Whole lines to write.
+ * @param len Number of bytes.
+ */
+void sink_write_lines(OutSink *sink, char *data, size_t len) {
+    while (len > 0) {
+        size_t chunk = len;
+        if (chunk > PIPE_BUF) {
+            chunk = PIPE_BUF;
+            while (chunk > 0 && data[chunk - 1] != '\n') chunk--;
+            if (chunk == 0) chunk = PIPE_BUF;
+        }
+        struct iovec iov = {data, chunk};
+        sink_write_all(sink, &iov, 1);
+        data += chunk;
+        len -= chunk;
+    }
+}
+
+// Thread de escrita: esvazia a fila de blocos cheios, por ordem, em lotes de até SINK_BATCH blocos
+void *sink_thread(void *arg) {
+    OutSink *sink = (OutSink *) arg;
+    struct iovec iov[SINK_BATCH];
+
+    pthread_mutex_lock(&sink->mutex);
+    for (;;) {
+        while (sink->queue_head == NULL && !sink->closing) pthread_cond_wait(&sink->cond, &sink->mutex);
+        if (sink->queue_head == NULL) break;
+        SinkBlock *batch = sink->queue_head;
+        sink->queue_head = sink->queue_tail = NULL;
+        pthread_mutex_unlock(&sink->mutex);
+
+        SinkBlock *block = batch, *last = batch;
+        for (; sink->line_chunks && block != NULL; block = block->next) {
+            sink_write_lines(sink, block->data, block->len);
+            last = block;
+        }
+        while (block != NULL) {
+            int count = 0;
+            for (; block != NULL && count < SINK_BATCH; block = block->next) {
+                iov[count].iov_base = block->data;
+                iov[count].iov_len = block->len;
+                count++;
+                last = block;
+            }
+            sink_write_all(sink, iov, count);
+        }
+
+        pthread_mutex_lock(&sink->mutex);
+        last->next = sink->free_list;
+        sink->free_list = batch;
+        pthread_cond_broadcast(&sink->cond);
+    }
+    pthread_mutex_unlock(&sink->mutex);
+    return NULL;
+}
+
+/**
+ * @brief Opens an asynchronous output sink on fd, with its own writer thread.
+ * @param sink Sink to initialize.
+ * @param fd Destination descriptor (usually STDOUT_FILENO).
+ * @return true on success, else false.
+ */
+bool sink_open(OutSink *sink, int fd) {
+    memset(sink, 0, sizeof(*sink));
+    sink->fd = fd;
+    // Blocos grandes só num ficheiro regular; pipes e terminais recebem linhas inteiras em escritas atómicas
+    struct stat st;
+    sink->line_chunks = fstat(fd, &st) < 0 || !S_ISREG(st.st_mode);
+    sink->current = malloc(sizeof(SinkBlock));
+    if (sink->current == NULL) return false;
+    sink->current->len = 0;
+    sink->current->next = NULL;
+    sink->use_ring = ring_setup(&sink->ring, 8);
+    pthread_mutex_init(&sink->mutex, NULL);
+    pthread_cond_init(&sink->cond, NULL);
+    if (pthread_create(&sink->thread, NULL, sink_thread, sink) != 0) {
+        if (sink->use_ring) ring_close(&sink->ring);
+        free(sink->current);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Returns room for at least len bytes in the current block, queueing the block if it is full.
+ *
+ * Full blocks go to the writer thread and a free (or new) block takes their place, so the
+ * worker never waits for the terminal or the disk; it only waits if memory runs out.
+ *
+ * @param sink Output sink.
+ * @param len Bytes about to be written (at most SINK_BLOCK).
+ * @return Where to write; confirm with sink_commit.
+ */
+char *sink_reserve(OutSink *sink, size_t len) {
+    if (sink->current->len + len > SINK_BLOCK) {
+        pthread_mutex_lock(&sink->mutex);
+        if (sink->queue_tail != NULL)
+            sink->queue_tail->next = sink->current;
+        else
+            sink->queue_head = sink->current;
+        sink->queue_tail = sink->current;
+        pthread_cond_broadcast(&sink->cond);
+
+        SinkBlock *block = sink->free_list;
+        if (block != NULL) sink->free_list = block->next;
+        pthread_mutex_unlock(&sink->mutex);
+
+        if (block == NULL) block = malloc(sizeof(SinkBlock));
+        if (block == NULL) {
+            pthread_mutex_lock(&sink->mutex);
+            while (sink->free_list == NULL) pthread_cond_wait(&sink->cond, &sink->mutex);
+            block = sink->free_list;
+            sink->free_list = block->next;
+            pthread_mutex_unlock(&sink->mutex);
+        }
+        block->len = 0;
+        block->next = NULL;
+        sink->current = block;
+    }
+    return sink->current->data + sink->current->len;
+}
+
+void sink_commit(OutSink *sink, size_t len) {
+    sink->current->len += len;
+}
+
+/**
+ * @brief Queues the last block, waits for the writer thread to drain everything and frees the sink.
+ * @param sink Output sink.
+ */
+void sink_close(OutSink *sink) {
+    pthread_mutex_lock(&sink->mutex);
+    if (sink->current->len > 0) {
+        if (sink->queue_tail != NULL)
+            sink->queue_tail->next = sink->current;
+        else
+            sink->queue_head = sink->current;
+        sink->queue_tail = sink->current;
+    } else {
+        sink->current->next = sink->free_list;
+        sink->free_list = sink->current;
+    }
+    sink->current = NULL;
+    sink->closing = true;
+    pthread_cond_broadcast(&sink->cond);
+    pthread_mutex_unlock(&sink->mutex);
+    pthread_join(sink->thread, NULL);
+
+    while (sink->free_list != NULL) {
+        SinkBlock *next = sink->free_list->next;
+        free(sink->free_list);
+        sink->free_list = next;
+    }
+    if (sink->use_ring) ring_close(&sink->ring);
+    pthread_mutex_destroy(&sink->mutex);
+    pthread_cond_destroy(&sink->cond);
+}
+
+/**
+ * @brief Appends the verbose line "<pid>;<x>;<y>" of an inside point to the sink.
+ * @param sink Output sink.
+ * @param prefix "<pid>;" of the worker, formatted once.
+ * @param prefix_len Length of prefix.
+ * @param p Point inside the polygon.
+ */
+void sink_point(OutSink *sink, const char *prefix, int prefix_len, Point p) {
+    char *start = sink_reserve(sink, prefix_len + 80);
+    char *out = start;
+    memcpy(out, prefix, prefix_len);
+    out += prefix_len;
+    out += format_fixed6(out, p.x);
+    *out++ = ';';
+    out += format_fixed6(out, p.y);
+    *out++ = '\n';
+    sink_commit(sink, out - start);
+}
+
 ssize_t writen2(int fd, const void *buffer, size_t n) {
     size_t left = n;
     ssize_t written_bytes;
     const char *ptr = (const char *) buffer;
 
     while (left > 0) {
-        written_bytes = write(fd, ptr, left);
+        written_bytes = send(fd, ptr, left, MSG_NOSIGNAL); // Um par que caiu dá EPIPE em vez de SIGPIPE
         if (written_bytes <= 0) {
             if (errno == EINTR) continue;
             perror("Erro ao escrever no socket");
@@ -139,9 +634,631 @@ ssize_t readn2(int fd, void *buffer, size_t n) {
     return (n - left);
 }
 
+/**
+ * @brief Returns the current monotonic time in microseconds.
+ * @return Microseconds since an arbitrary fixed point, shared by all processes.
+ */
+long long trace_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long) ts.tv_sec * 1000000LL + ts.tv_nsec / 1000;
+}
+
+/**
+ * @brief Records a complete event that started at start and ends now.
+ * @param name Name of the phase shown in the timeline.
+ * @param start Start timestamp obtained from trace_now().
+ * @param arg Optional numeric argument (e.g. number of points), or -1.
+ */
+void trace_add(const char *name, long long start, long long arg) {
+    if (trace.path == NULL) return;
+    if (trace.count >= trace.capacity) {
+        int capacity = trace.capacity ? trace.capacity * 2 : 256;
+        TraceEvent *events = realloc(trace.events, capacity * sizeof(TraceEvent));
+        if (events == NULL) return;
+        trace.events = events;
+        trace.capacity = capacity;
+    }
+    TraceEvent *e = &trace.events[trace.count++];
+    e->name = name;
+    e->ts = start;
+    e->dur = trace_now() - start;
+    e->arg = arg;
+}
+
+/**
+ * @brief Writes the buffered events of this process as trace-event JSON objects.
+ * @param fd Destination file descriptor.
+ * @param track Name of the track (process) shown in the viewer.
+ * @param first true if no event was written before to fd (controls the comma).
+ */
+void trace_write_events(int fd, const char *track, bool first) {
+    char line[256];
+    int len = snprintf(line, sizeof(line),
+                       "%s{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%d,\"args\":{\"name\":\"%s\"}}",
+                       first ? "" : ",\n", getpid(), getpid(), track);
+    write(fd, line, len);
+    for (int i = 0; i < trace.count; i++) {
+        TraceEvent *e = &trace.events[i];
+        len = snprintf(line, sizeof(line),
+                       ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":%d,\"tid\":%d,\"ts\":%lld,\"dur\":%lld",
+                       e->name, getpid(), getpid(), e->ts, e->dur);
+        if (e->arg >= 0)
+            len += snprintf(line + len, sizeof(line) - len, ",\"args\":{\"n\":%lld}}", e->arg);
+        else
+            len += snprintf(line + len, sizeof(line) - len, "}");
+        write(fd, line, len);
+    }
+}
+
+/**
+ * @brief Dumps the events buffered by a child into <trace>.<pid>.part for the parent to merge.
+ * @param track Name of the child's track.
+ */
+void trace_flush_child(const char *track) {
+    if (trace.path == NULL) return;
+    char part[512];
+    snprintf(part, sizeof(part), "%s.%d.part", trace.path, getpid());
+    int fd = open(part, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        perror("Erro ao criar o ficheiro parcial de trace");
+        return;
+    }
+    trace_write_events(fd, track, true);
+    close(fd);
+}
+
+/**
+ * @brief Merges the parent's events and the children's part files into the final trace file.
+ * @param pids Process ids of the children.
+ * @param num_children Number of children.
+ */
+void trace_merge(pid_t pids[], int num_children) {
+    if (trace.path == NULL) return;
+    int fd = open(trace.path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        perror("Erro ao criar o ficheiro de trace");
+        return;
+    }
+    char header[] = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    write(fd, header, strlen(header));
+    trace_write_events(fd, "pai", true);
+
+    for (int i = 0; i < num_children; i++) {
+        char part[512];
+        snprintf(part, sizeof(part), "%s.%d.part", trace.path, pids[i]);
+        int part_fd = open(part, O_RDONLY);
+        if (part_fd < 0) continue;
+        write(fd, ",\n", 2);
+        char buffer[4096];
+        ssize_t bytesRead;
+        while ((bytesRead = read(part_fd, buffer, sizeof(buffer))) > 0) {
+            write(fd, buffer, bytesRead);
+        }
+        close(part_fd);
+        unlink(part);
+    }
+
+    char footer[] = "\n]}\n";
+    write(fd, footer, strlen(footer));
+    close(fd);
+    free(trace.events);
+    trace.events = NULL;
+}
+
+/**
+ * @brief Parses a CPU list such as "0-3,8,10-11".
+ * @param list Text to parse.
+ * @param cpus Output array of CPU numbers.
+ * @param max Capacity of cpus.
+ * @return Number of CPUs parsed.
+ */
+int parse_cpu_list(const char *list, int cpus[], int max) {
+    int count = 0;
+    const char *p = list;
+    while (*p != '\0' && count < max) {
+        char *end;
+        long first = strtol(p, &end, 10);
+        if (end == p) break;
+        long last = first;
+        if (*end == '-') {
+            p = end + 1;
+            last = strtol(p, &end, 10);
+        }
+        for (long c = first; c <= last && count < max; c++) cpus[count++] = (int) c;
+        p = (*end == ',') ? end + 1 : end;
+        if (*end != ',') break;
+    }
+    return count;
+}
+
+/**
+ * @brief Returns the NUMA node of a CPU, read from /sys/devices/system/node.
+ * @param cpu CPU number.
+ * @return Node number, or 0 if the topology is not available.
+ */
+int cpu_node(int cpu) {
+    for (int node = 0; node < 64; node++) {
+        char path[64], list[256];
+        snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist", node);
+        int fd = open(path, O_RDONLY);
+        if (fd < 0) continue;
+        ssize_t len = read(fd, list, sizeof(list) - 1);
+        close(fd);
+        if (len <= 0) continue;
+        list[len] = '\0';
+        int cpus[CPU_SETSIZE];
+        int count = parse_cpu_list(list, cpus, CPU_SETSIZE);
+        for (int i = 0; i < count; i++) {
+            if (cpus[i] == cpu) return node;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Computes the CPU of each worker for an affinity policy.
+ * @param policy "compact", "scatter" or an explicit CPU list.
+ * @param workers Number of workers.
+ * @param cpus Output array with one CPU per worker.
+ * @return true on success, false if the policy is invalid.
+ */
+bool affinity_plan(const char *policy, int workers, int cpus[]) {
+    int allowed[CPU_SETSIZE];
+    int count = 0;
+
+    if (strcmp(policy, "compact") != 0 && strcmp(policy, "scatter") != 0) {
+        count = parse_cpu_list(policy, allowed, CPU_SETSIZE);
+        if (count == 0) return false;
+        for (int i = 0; i < workers; i++) cpus[i] = allowed[i % count];
+        return true;
+    }
+
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (sched_getaffinity(0, sizeof(set), &set) < 0) return false;
+
+    // CPUs permitidos ordenados por nó, para que "compact" encha um nó de cada vez
+    int nodes[CPU_SETSIZE];
+    int num_nodes = 0;
+    for (int c = 0; c < CPU_SETSIZE; c++) {
+        if (!CPU_ISSET(c, &set)) continue;
+        int node = cpu_node(c);
+        int k = count++;
+        while (k > 0 && nodes[k - 1] > node) {
+            allowed[k] = allowed[k - 1];
+            nodes[k] = nodes[k - 1];
+            k--;
+        }
+        allowed[k] = c;
+        nodes[k] = node;
+        if (node + 1 > num_nodes) num_nodes = node + 1;
+    }
+    if (count == 0) return false;
+
+    if (strcmp(policy, "compact") == 0) {
+        for (int i = 0; i < workers; i++) cpus[i] = allowed[i % count];
+        return true;
+    }
+
+    // scatter: distribui os trabalhadores pelos nós de forma alternada
+    int used[CPU_SETSIZE] = {0};
+    for (int i = 0; i < workers; i++) {
+        int node = i % num_nodes;
+        int best = -1;
+        for (int k = 0; k < count; k++) {
+            if (nodes[k] == node && (best < 0 || used[k] < used[best])) best = k;
+        }
+        if (best < 0) best = i % count;
+        used[best]++;
+        cpus[i] = allowed[best];
+    }
+    return true;
+}
+
+/**
+ * @brief Pins the calling thread (or process) to a single CPU.
+ * @param cpu CPU number.
+ * @return true on success, else false.
+ */
+bool pin_to_cpu(int cpu) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    if (sched_setaffinity(0, sizeof(set), &set) < 0) {
+        perror("Erro ao definir a afinidade de CPU");
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Number of samples to classify before the next stream_update() check.
+ * @param s Streaming settings.
+ * @return Samples until the next check.
+ */
+int stream_countdown(Stream *s) {
+    if (s->every > 0 && (s->every_ms == 0 || s->every < STREAM_CHECK)) return (int) s->every;
+    return STREAM_CHECK;
+}
+
+/**
+ * @brief Sends a "+processed;inside" delta line if K samples or T ms passed since the last one.
+ * @param s Streaming state of the worker.
+ * @param fd Pipe/socket to the parent.
+ * @param processed Samples classified so far by the worker.
+ * @param inside Samples found inside so far by the worker.
+ */
+void stream_update(Stream *s, int fd, long long processed, long long inside) {
+    s->countdown = stream_countdown(s);
+    long long now = 0;
+    bool due = s->every > 0 && processed - s->sent_processed >= s->every;
+    if (!due && s->every_ms > 0) {
+        now = trace_now();
+        due = now - s->last_time >= s->every_ms * 1000;
+    }
+    if (!due) return;
+
+    char line[64];
+    int len = snprintf(line, sizeof(line), "+%lld;%lld\n", processed - s->sent_processed, inside - s->sent_inside);
+    write(fd, line, len); // Linha curta: escrita atómica mesmo com várias threads no mesmo pipe
+    s->sent_processed = processed;
+    s->sent_inside = inside;
+    s->last_time = now ? now : trace_now();
+}
+
+/**
+ * @brief Prints the running area estimate and its standard error on the progress line.
+ * @param processed Samples classified so far by all the children.
+ * @param inside Samples found inside so far.
+ * @param total_points Total number of samples of the job.
+ */
+void print_estimate(long long processed, long long inside, long long total_points) {
+    if (processed == 0) return;
+    double p = (double) inside / processed;
+    double area = 4.0 * p;
+    double erro = 4.0 * sqrt(p * (1.0 - p) / processed);
+    printf("\rProgresso: %lld%% | Área ≈ %.6f ± %.6f", processed * 100 / total_points, area, erro);
+    fflush(stdout);
+}
+
+/**
+ * @brief Sends the next chunk lease to a child, or "FIM" when there is no work left.
+ *
+ * While other leases are still out the child is left idle (lease.count == 0,
+ * no message), so it can take a chunk requeued by a child that dies.
+ *
+ * @param job State of the job.
+ * @param c Child connection.
+ * @return 0 if the child got a chunk or was left idle, 1 if it was sent FIM,
+ *         -1 if it could not be reached (its lease goes back to the queue).
+ */
+int lease_next(LeaseJob *job, LeaseClient *c) {
+    char msg[64];
+    int len;
+    if (job->num_requeued > 0) {
+        c->lease = job->requeued[--job->num_requeued];
+    } else if (job->next < job->num_points) {
+        c->lease.start = job->next;
+        c->lease.count = job->num_points - job->next < job->chunk ? job->num_points - job->next : job->chunk;
+        job->next += c->lease.count;
+    } else {
+        c->lease.count = 0;
+        if (job->done < job->num_points) return 0; // Ainda há blocos fora: o filho espera
+        writen2(c->fd, "FIM\n", 4);
+        return 1;
+    }
+    len = snprintf(msg, sizeof(msg), "LEASE %lld %lld\n", c->lease.start, c->lease.count);
+    if (writen2(c->fd, msg, len) < 0) {
+        // O filho não recebeu o bloco: volta para a fila (cada filho perde no máximo um bloco)
+        job->requeued[job->num_requeued++] = c->lease;
+        c->lease.count = 0;
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Parent side of the pull mode: hands out chunk leases until every sample is classified.
+ * @param server_sock Listening socket.
+ * @param num_children Number of children that will connect.
+ * @param job State of the job; done and inside hold the totals on return.
+ * @param live true to print the running estimate after every chunk report.
+ */
+void serve_leases(int server_sock, int num_children, LeaseJob *job, bool live) {
+    LeaseClient clients[num_children];
+    int num_clients = 0, accepted = 0;
+
+    while (job->done < job->num_points) {
+        struct pollfd fds[num_children + 1];
+        fds[0].fd = accepted < num_children ? server_sock : -1;
+        fds[0].events = POLLIN;
+        for (int i = 0; i < num_clients; i++) {
+            fds[i + 1].fd = clients[i].fd;
+            fds[i + 1].events = POLLIN;
+        }
+        if (num_clients == 0 && accepted == num_children) {
+            fprintf(stderr, "Aviso: todos os filhos terminaram com %lld de %lld amostras processadas\n",
+                    job->done, job->num_points);
+            break;
+        }
+        if (poll(fds, num_clients + 1, -1) < 0) {
+            if (errno == EINTR) continue;
+            perror("Erro no poll");
+            break;
+        }
+
+        // Só as ligações já existentes foram vigiadas pelo poll
+        int polled = num_clients;
+
+        if (fds[0].revents & POLLIN) {
+            long long t_inicio = trace_now();
+            int sock = accept(server_sock, NULL, NULL);
+            if (sock >= 0) {
+                trace_add("accept", t_inicio, -1);
+                accepted++;
+                LeaseClient *c = &clients[num_clients];
+                memset(c, 0, sizeof(*c));
+                c->fd = sock;
+                if (lease_next(job, c) == 0) {
+                    num_clients++;
+                } else {
+                    close(sock);
+                }
+            }
+        }
+
+        for (int i = 0; i < polled; i++) {
+            LeaseClient *c = &clients[i];
+            if (!(fds[i + 1].revents & (POLLIN | POLLHUP | POLLERR))) continue;
+
+            long long t_inicio = trace_now();
+            ssize_t r = read(c->fd, c->buffer + c->len, sizeof(c->buffer) - 1 - c->len);
+            if (r <= 0) {
+                // Filho perdido: o seu bloco volta para a fila
+                if (c->lease.count > 0) job->requeued[job->num_requeued++] = c->lease;
+                close(c->fd);
+                c->fd = -1;
+                continue;
+            }
+            c->len += r;
+            c->buffer[c->len] = '\0';
+
+            char *newline;
+            while (c->fd >= 0 && (newline = strchr(c->buffer, '\n')) != NULL) {
+                *newline = '\0';
+                int pid;
+                long long processed, inside;
+                if (sscanf(c->buffer, "%d;%lld;%lld", &pid, &processed, &inside) == 3) {
+                    c->pid = pid;
+                    c->processed += processed;
+                    c->inside += inside;
+                    c->chunks++;
+                    job->done += processed;
+                    job->inside += inside;
+                    c->lease.count = 0;
+                    if (lease_next(job, c) != 0) {
+                        close(c->fd);
+                        c->fd = -1;
+                    }
+                }
+                c->len -= newline + 1 - c->buffer;
+                memmove(c->buffer, newline + 1, c->len + 1);
+            }
+            trace_add("ler_socket", t_inicio, c->pid);
+        }
+
+        // Blocos devolvidos por filhos que caíram vão para os que estão à espera
+        for (int i = 0; i < num_clients && job->num_requeued > 0; i++) {
+            LeaseClient *c = &clients[i];
+            if (c->fd < 0 || c->lease.count > 0) continue;
+            if (lease_next(job, c) != 0) {
+                close(c->fd);
+                c->fd = -1;
+            }
+        }
+
+        for (int i = 0; i < num_clients; i++) {
+            if (clients[i].fd >= 0) continue;
+            if (clients[i].processed > 0) {
+                printf("%s%d;%lld;%lld\n", live ? "\r" : "", clients[i].pid, clients[i].processed, clients[i].inside);
+            }
+            clients[i--] = clients[--num_clients];
+        }
+        if (live) print_estimate(job->done, job->inside, job->num_points);
+    }
+    if (live) printf("\n");
+
+    for (int i = 0; i < num_clients; i++) {
+        writen2(clients[i].fd, "FIM\n", 4);
+        close(clients[i].fd);
+        if (clients[i].processed > 0) {
+            printf("%d;%lld;%lld\n", clients[i].pid, clients[i].processed, clients[i].inside);
+        }
+    }
+}
+
+/**
+ * @brief Parent side of the streaming mode: reads the partial deltas of all the children at once.
+ *
+ * Each child connects before classifying and sends "+processed;inside" deltas,
+ * followed by its final pid;processed;inside line; the running estimate is
+ * refreshed after every batch of updates.
+ *
+ * @param server_sock Listening socket.
+ * @param num_children Number of children that will connect.
+ * @param num_points Total number of samples of the job.
+ * @param total_processed Output: samples processed according to the final lines.
+ * @param total_inside Output: samples inside according to the final lines.
+ */
+void serve_stream(int server_sock, int num_children, long long num_points, int *total_processed, int *total_inside) {
+    LeaseClient clients[num_children];
+    int num_clients = 0, accepted = 0;
+    long long live_processed = 0, live_inside = 0;
+
+    while (accepted < num_children || num_clients > 0) {
+        struct pollfd fds[num_children + 1];
+        fds[0].fd = accepted < num_children ? server_sock : -1;
+        fds[0].events = POLLIN;
+        for (int i = 0; i < num_clients; i++) {
+            fds[i + 1].fd = clients[i].fd;
+            fds[i + 1].events = POLLIN;
+        }
+        if (poll(fds, num_clients + 1, -1) < 0) {
+            if (errno == EINTR) continue;
+            perror("Erro no poll");
+            break;
+        }
+
+        // Só as ligações já existentes foram vigiadas pelo poll
+        int polled = num_clients;
+
+        if (fds[0].revents & POLLIN) {
+            long long t_inicio = trace_now();
+            int sock = accept(server_sock, NULL, NULL);
+            if (sock >= 0) {
+                trace_add("accept", t_inicio, -1);
+                accepted++;
+                memset(&clients[num_clients], 0, sizeof(LeaseClient));
+                clients[num_clients++].fd = sock;
+            }
+        }
+
+        for (int i = 0; i < polled; i++) {
+            LeaseClient *c = &clients[i];
+            if (!(fds[i + 1].revents & (POLLIN | POLLHUP | POLLERR))) continue;
+
+            long long t_inicio = trace_now();
+            ssize_t r = read(c->fd, c->buffer + c->len, sizeof(c->buffer) - 1 - c->len);
+            if (r <= 0) {
+                close(c->fd);
+                c->fd = -1;
+                continue;
+            }
+            c->len += r;
+            c->buffer[c->len] = '\0';
+
+            char *newline;
+            while ((newline = strchr(c->buffer, '\n')) != NULL) {
+                *newline = '\0';
+                int pid;
+                long long processed, inside;
+                if (sscanf(c->buffer, "+%lld;%lld", &processed, &inside) == 2) {
+                    c->processed += processed;
+                    c->inside += inside;
+                    live_processed += processed;
+                    live_inside += inside;
+                } else if (sscanf(c->buffer, "%d;%lld;%lld", &pid, &processed, &inside) == 3) {
+                    // O resultado final substitui os parciais deste filho
+                    printf("\r%d;%lld;%lld\n", pid, processed, inside);
+                    live_processed += processed - c->processed;
+                    live_inside += inside - c->inside;
+                    *total_processed += processed;
+                    *total_inside += inside;
+                }
+                c->len -= newline + 1 - c->buffer;
+                memmove(c->buffer, newline + 1, c->len + 1);
+            }
+            trace_add("ler_socket", t_inicio, -1);
+        }
+
+        for (int i = 0; i < num_clients; i++) {
+            if (clients[i].fd < 0) clients[i--] = clients[--num_clients];
+        }
+        print_estimate(live_processed, live_inside, num_points);
+    }
+    printf("\n");
+}
+
+/**
+ * @brief Connects a child to the parent's socket.
+ * @param server_addr Address of the parent's socket.
+ * @return Connected socket, or -1 on error.
+ */
+int connect_server(struct sockaddr_un *server_addr) {
+    long long t_inicio = trace_now();
+    int sock = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (sock < 0) {
+        perror("Erro ao criar socket do cliente");
+        return -1;
+    }
+    //O socket cria um socket do cliente e connect estabelece a conexão com o servidor.
+    if (connect(sock, (struct sockaddr *) server_addr, sizeof(struct sockaddr_un)) < 0) {
+        perror("Erro ao conectar ao socket do servidor");
+        close(sock);
+        return -1;
+    }
+    trace_add("conectar", t_inicio, -1);
+    return sock;
+}
+
+/**
+ * @brief Child side of the pull mode: connects once and classifies chunk leases until the parent answers "FIM".
+ * @param server_addr Address of the parent's socket.
+ * @param polygon Polygon vertices.
+ * @param n Number of vertices.
+ * @param pontos Samples shared with the parent.
+ * @param verbose true to print every inside point.
+ * @return EXIT_SUCCESS or EXIT_FAILURE.
+ */
+int pull_worker(struct sockaddr_un *server_addr, Point *polygon, int n, Point *pontos, bool verbose) {
+    long long t_inicio;
+    int sock = connect_server(server_addr);
+    if (sock < 0) return EXIT_FAILURE;
+
+    FILE *in = fdopen(dup(sock), "r");
+    if (in == NULL) {
+        perror("Erro ao abrir o socket para leitura");
+        close(sock);
+        return EXIT_FAILURE;
+    }
+
+    // No modo verboso, as linhas dos pontos seguem por uma saída assíncrona com blocos grandes
+    OutSink sink;
+    char prefixo[16];
+    int len_prefixo = snprintf(prefixo, sizeof(prefixo), "%d;", getpid());
+    if (verbose && !sink_open(&sink, STDOUT_FILENO)) verbose = false;
+
+    int status = EXIT_FAILURE;
+    char line[128];
+    while (fgets(line, sizeof(line), in) != NULL) {
+        long long start, count;
+        if (strncmp(line, "FIM", 3) == 0) {
+            status = EXIT_SUCCESS;
+            break;
+        }
+        if (sscanf(line, "LEASE %lld %lld", &start, &count) != 2) break;
+
+        t_inicio = trace_now();
+        long long inside = 0;
+        for (long long j = start; j < start + count; j++) {
+            if (isInsidePolygon(polygon, n, pontos[j])) {
+                inside++;
+                if (verbose) sink_point(&sink, prefixo, len_prefixo, pontos[j]);
+            }
+        }
+        trace_add("classificar", t_inicio, count);
+
+        // As contagens parciais do bloco servem também de pedido do bloco seguinte
+        t_inicio = trace_now();
+        char output[128];
+        int len = snprintf(output, sizeof(output), "%d;%lld;%lld\n", getpid(), count, inside);
+        if (writen2(sock, output, len) < 0) break;
+        trace_add("enviar_resultado", t_inicio, -1);
+    }
+
+    if (verbose) sink_close(&sink);
+    fclose(in);
+    close(sock);
+    return status;
+}
+
 int main(int argc, char *argv[]) {
-    if (argc != 5) {
-        fprintf(stderr, "Uso: %s <arquivo_do_poligono> <num_processos_filho> <num_pontos_aleatorios> <modo>\n", argv[0]);
+    const char *uso = "Uso: %s <arquivo_do_poligono> <num_processos_filho> <num_pontos_aleatorios> <modo> "
+                      "[--trace <saida.json>] [--affinity <compact|scatter|lista_de_cpus>] [--pull [amostras_por_bloco]] "
+                      "[--stream <amostras>] [--stream-ms <ms>]\n";
+    if (argc < 5) {
+        fprintf(stderr, uso, argv[0]);
         return EXIT_FAILURE;
     }
 
@@ -149,12 +1266,37 @@ int main(int argc, char *argv[]) {
     int num_processos_filho = atoi(argv[2]);
     int num_pontos_aleatorios = atoi(argv[3]);
     char *modo = argv[4];
+    char *afinidade = NULL;
+    long long bloco_pull = 0; // >0: os filhos pedem blocos de amostras ao pai (modo pull)
+    Stream stream = {0, 0, 0, 0, 0, 0}; // Resultados parciais a cada K amostras e/ou T ms
+
+    // Opções adicionais
+    for (int a = 5; a < argc; a++) {
+        if (strcmp(argv[a], "--trace") == 0 && a + 1 < argc) {
+            trace.path = argv[++a];
+        } else if (strcmp(argv[a], "--affinity") == 0 && a + 1 < argc) {
+            afinidade = argv[++a];
+        } else if (strcmp(argv[a], "--pull") == 0) {
+            bloco_pull = (a + 1 < argc && argv[a + 1][0] != '-') ? atoll(argv[++a]) : LEASE_CHUNK;
+        } else if (strcmp(argv[a], "--stream") == 0 && a + 1 < argc) {
+            stream.every = atoll(argv[++a]);
+        } else if (strcmp(argv[a], "--stream-ms") == 0 && a + 1 < argc) {
+            stream.every_ms = atoll(argv[++a]);
+        } else {
+            fprintf(stderr, uso, argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
 
-    if (num_processos_filho <= 0 || num_pontos_aleatorios <= 0) {
+    // Os resultados parciais só fazem sentido no modo normal
+    bool streaming = (stream.every > 0 || stream.every_ms > 0) && strcmp(modo, "normal") == 0;
+
+    if (num_processos_filho <= 0 || num_pontos_aleatorios <= 0 || bloco_pull < 0) {
         fprintf(stderr, "Erro: Números de processos e pontos devem ser maiores que 0.\n");
         return EXIT_FAILURE;
     }
 
+    long long t_inicio = trace_now();
     int arquivo = open(poligono, O_RDONLY);
     if (arquivo < 0) {
         perror("Erro ao abrir o arquivo do polígono");
@@ -170,11 +1312,18 @@ int main(int argc, char *argv[]) {
     int capacity = 100;
     int n = 0;
     char buffer[128];
+    size_t pending = 0;
     ssize_t bytesRead;
     char *line, *saveptr;
 
-    while ((bytesRead = read(arquivo, buffer, sizeof(buffer) - 1)) > 0) {
-        buffer[bytesRead] = '\0';
+    // Uma linha partida entre duas leituras fica no início do buffer e é completada pela leitura seguinte
+    while ((bytesRead = read(arquivo, buffer + pending, sizeof(buffer) - 1 - pending)) >= 0) {
+        size_t len = pending + bytesRead;
+        buffer[len] = '\0';
+        char *cut = bytesRead > 0 ? strrchr(buffer, '\n') : NULL;
+        size_t used = cut != NULL ? (size_t) (cut - buffer) + 1 : len;
+        char saved = buffer[used];
+        buffer[used] = '\0';
         line = strtok_r(buffer, "\n", &saveptr);
         while (line != NULL) {
             if (sscanf(line, "%6lf %6lf", &polygon[n].x, &polygon[n].y) == 2) {
@@ -191,9 +1340,14 @@ int main(int argc, char *argv[]) {
             }
             line = strtok_r(NULL, "\n", &saveptr);
         }
+        if (bytesRead == 0) break;
+        buffer[used] = saved;
+        pending = len - used;
+        memmove(buffer, buffer + used, pending);
     }
 
     close(arquivo);
+    trace_add("carregar_poligono", t_inicio, n);
 
     if (n < 3) {
         fprintf(stderr, "Polígono inválido ou dados insuficientes no arquivo.\n");
@@ -207,11 +1361,13 @@ int main(int argc, char *argv[]) {
         free(polygon);
         return EXIT_FAILURE;
     }
+    t_inicio = trace_now();
     srand((unsigned int) time(NULL) + getpid());
     for (int i = 0; i < num_pontos_aleatorios; i++) {
         pontos[i].x = (double) rand() / RAND_MAX * 3.0 - 1.5;
         pontos[i].y = (double) rand() / RAND_MAX * 3.0 - 1.5;
     }
+    trace_add("gerar_amostras", t_inicio, num_pontos_aleatorios);
 
 
 
@@ -258,38 +1414,106 @@ int main(int argc, char *argv[]) {
 
     pid_t pids[num_processos_filho];
 
+    // Plano de colocação dos filhos nos CPUs
+    int cpus[num_processos_filho];
+    if (afinidade != NULL && !affinity_plan(afinidade, num_processos_filho, cpus)) {
+        fprintf(stderr, "Erro: Política de afinidade inválida.\n");
+        free(pontos);
+        free(polygon);
+        close(server_sock);
+        return EXIT_FAILURE;
+    }
+    // CPU em que cada filho correu de facto, medido por ele próprio: um sched_setaffinity falhado fica à vista
+    int *cpus_reais = NULL;
+    if (afinidade != NULL) {
+        cpus_reais = mmap(NULL, num_processos_filho * sizeof(int), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+        if (cpus_reais == MAP_FAILED) {
+            perror("Erro ao mapear os CPUs dos filhos");
+            free(pontos);
+            free(polygon);
+            close(server_sock);
+            return EXIT_FAILURE;
+        }
+        for (int i = 0; i < num_processos_filho; i++) cpus_reais[i] = -1;
+    }
+
     for (int i = 0; i < num_processos_filho; i++) {
+        t_inicio = trace_now();
         pid_t pid = fork();
         if (pid == 0) {  // Processo filho
+            trace.count = 0; // Os eventos herdados pertencem ao pai
             int pontos_por_filho = num_pontos_aleatorios / num_processos_filho;
             int pontos_extra = num_pontos_aleatorios % num_processos_filho;
             int pontos_a_processar = pontos_por_filho + (i < pontos_extra ? 1 : 0);
             int pontos_dentro = 0;
+            int inicio = i * pontos_por_filho + (i < pontos_extra ? i : pontos_extra);
+            Point *amostras = pontos + inicio;
+            Point *poligono_local = polygon;
 
-            for (int j = i * pontos_por_filho + (i < pontos_extra ? i : pontos_extra); j < i * pontos_por_filho + (i < pontos_extra ? i : pontos_extra) + pontos_a_processar; j++) {
-                if (isInsidePolygon(polygon, n, pontos[j])) {
-                    pontos_dentro++;
-                    if (strcmp(modo, "verboso") == 0) {
-                        char output[128];
-                        snprintf(output, sizeof(output), "%d;%6lf;%6lf\n", getpid(), pontos[j].x, pontos[j].y);
-                        write(STDOUT_FILENO, output, strlen(output));  // Escreve diretamente no terminal
-                    }
+            // Com afinidade, o filho fixa-se no CPU e copia o polígono e as suas amostras
+            // para memória própria, tocada primeiro no nó local
+            if (afinidade != NULL && pin_to_cpu(cpus[i])) {
+                Point *copia_poligono = malloc(n * sizeof(Point));
+                if (copia_poligono != NULL) {
+                    memcpy(copia_poligono, polygon, n * sizeof(Point));
+                    poligono_local = copia_poligono;
+                }
+                // No modo pull os blocos só são conhecidos durante a execução
+                Point *copia_amostras = bloco_pull == 0 ? malloc(pontos_a_processar * sizeof(Point)) : NULL;
+                if (copia_amostras != NULL) {
+                    memcpy(copia_amostras, amostras, pontos_a_processar * sizeof(Point));
+                    amostras = copia_amostras;
                 }
             }
-            //Criação e Conexão do Socket do Cliente
-            int client_sock = socket(AF_UNIX, SOCK_STREAM, 0);
-            if (client_sock < 0) {
-                perror("Erro ao criar socket do cliente");
-                exit(EXIT_FAILURE);
+
+            if (bloco_pull > 0) {
+                int status = pull_worker(&server_addr, poligono_local, n, pontos, strcmp(modo, "verboso") == 0);
+                if (afinidade != NULL) cpus_reais[i] = sched_getcpu();
+                char track[32];
+                snprintf(track, sizeof(track), "filho %d", i);
+                trace_flush_child(track);
+                free(pontos);
+                free(polygon);
+                exit(status);
             }
-            //O socket cria um socket do cliente e connect estabelece a conexão com o servidor.
-            if (connect(client_sock, (struct sockaddr *) &server_addr, sizeof(struct sockaddr_un)) < 0) {
-                perror("Erro ao conectar ao socket do servidor");
-                close(client_sock);
-                exit(EXIT_FAILURE);
+
+            // No modo streaming a ligação é aberta antes, para enviar os parciais durante a classificação
+            int client_sock = -1;
+            if (streaming) {
+                client_sock = connect_server(&server_addr);
+                if (client_sock < 0) exit(EXIT_FAILURE);
+                stream.countdown = stream_countdown(&stream);
+                stream.last_time = trace_now();
             }
 
+            // No modo verboso, as linhas dos pontos seguem por uma saída assíncrona com blocos grandes
+            bool verboso = strcmp(modo, "verboso") == 0;
+            OutSink sink;
+            char prefixo[16];
+            int len_prefixo = snprintf(prefixo, sizeof(prefixo), "%d;", getpid());
+            if (verboso && !sink_open(&sink, STDOUT_FILENO)) verboso = false;
+
+            // Classificação em blocos para o trace
+            for (int bloco = 0; bloco < pontos_a_processar; bloco += TRACE_CHUNK) {
+                int fim_bloco = bloco + TRACE_CHUNK < pontos_a_processar ? bloco + TRACE_CHUNK : pontos_a_processar;
+                long long t_bloco = trace_now();
+                for (int j = bloco; j < fim_bloco; j++) {
+                    if (isInsidePolygon(poligono_local, n, amostras[j])) {
+                        pontos_dentro++;
+                        if (verboso) sink_point(&sink, prefixo, len_prefixo, amostras[j]);
+                    }
+                    if (streaming && --stream.countdown == 0) stream_update(&stream, client_sock, j + 1, pontos_dentro);
+                }
+                trace_add("classificar", t_bloco, fim_bloco - bloco);
+            }
+            if (afinidade != NULL) cpus_reais[i] = sched_getcpu();
+            if (verboso) sink_close(&sink);
+            //Criação e Conexão do Socket do Cliente
+            if (client_sock < 0) client_sock = connect_server(&server_addr);
+            if (client_sock < 0) exit(EXIT_FAILURE);
+
             if (strcmp(modo, "normal") == 0) {
+                long long t_envio = trace_now();
                 char output[128];
                 snprintf(output, sizeof(output), "%d;%d;%d\n", getpid(), pontos_a_processar, pontos_dentro);
                 if (writen2(client_sock, output, strlen(output)) < 0) { // Escreve no socket
@@ -297,9 +1521,13 @@ int main(int argc, char *argv[]) {
                     close(client_sock);
                     exit(EXIT_FAILURE);
                 }
+                trace_add("enviar_resultado", t_envio, -1);
             }
 
             close(client_sock);
+            char track[32];
+            snprintf(track, sizeof(track), "filho %d", i);
+            trace_flush_child(track);
             free(pontos);
             free(polygon);
             exit(EXIT_SUCCESS);
@@ -311,18 +1539,35 @@ int main(int argc, char *argv[]) {
             return EXIT_FAILURE;
         } else {
             pids[i] = pid;
+            trace_add("fork", t_inicio, pid);
         }
     }
     //Aceitação de Conexões e Leitura dos Dados no Processo Pai
     int total_pontos_dentro = 0;
     int total_pontos_processados = 0;
 
-    for (int i = 0; i < num_processos_filho; i++) {
+    if (bloco_pull > 0) {
+        LeaseJob job = {num_pontos_aleatorios, bloco_pull, 0, NULL, 0, 0, 0};
+        job.requeued = malloc(num_processos_filho * sizeof(Lease));
+        serve_leases(server_sock, num_processos_filho, &job, streaming);
+        total_pontos_dentro = job.inside;
+        total_pontos_processados = job.done;
+        free(job.requeued);
+    }
+
+    if (bloco_pull == 0 && streaming) {
+        serve_stream(server_sock, num_processos_filho, num_pontos_aleatorios, &total_pontos_processados, &total_pontos_dentro);
+    }
+
+    for (int i = 0; bloco_pull == 0 && !streaming && i < num_processos_filho; i++) {
+        t_inicio = trace_now();
         client_sock = accept(server_sock, (struct sockaddr *) &client_addr, &client_addr_len); // Aceita conexão do cliente
         if (client_sock < 0) {
             perror("Erro ao aceitar conexão do cliente");
             continue;
         }
+        trace_add("accept", t_inicio, -1);
+        t_inicio = trace_now();
 
         char buffer[BUFFER_SIZE];
         ssize_t bytesRead;
@@ -343,15 +1588,27 @@ int main(int argc, char *argv[]) {
             }
         }
         close(client_sock);
+        trace_add("ler_socket", t_inicio, -1);
     }
 
     while (wait(NULL) > 0);
 
+    t_inicio = trace_now();
     if (total_pontos_dentro > 0) {
         double area_of_reference = 4.0;
         double estimated_area = ((double) total_pontos_dentro / num_pontos_aleatorios) * area_of_reference;
         printf("Área estimada do polígono: %.6f unidades quadradas\n", estimated_area);
     }
+    if (afinidade != NULL) {
+        for (int i = 0; i < num_processos_filho; i++) {
+            printf("Filho %d (pid %d): CPU %d (nó %d), planeado CPU %d%s\n", i, pids[i], cpus_reais[i],
+                   cpu_node(cpus_reais[i]), cpus[i], cpus_reais[i] != cpus[i] ? " (afinidade não aplicada)" : "");
+        }
+        munmap(cpus_reais, num_processos_filho * sizeof(int));
+    }
+    trace_add("agregacao", t_inicio, -1);
+    fflush(stdout);
+    trace_merge(pids, num_processos_filho);
 
     free(pontos);
     free(polygon);
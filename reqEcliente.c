@@ -1,34 +1,112 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdint.h>
 #include <stdbool.h>
 #include <time.h>
 #include <unistd.h>
 #include <fcntl.h>
 #include <math.h>
+#include <float.h>
 #include <sys/socket.h>
 #include <sys/un.h>
+#include <sys/uio.h>
+#include <sys/stat.h>
+#include <limits.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+#include <netdb.h>
+#include <pthread.h>
 #include <string.h>
 #include <errno.h>
 #include <sys/wait.h>
 
 #define SOCKET_PATH "/tmp/polygon_socket"
 #define BUFFER_SIZE 1024
+#define SINK_BLOCK (256 * 1024)
+#define SINK_BATCH 64
+
+// Limite de erro relativo do determinante de orientação em double (Shewchuk, ccwerrboundA)
+#define ORIENT_ERRBOUND ((3.0 + 8.0 * DBL_EPSILON) * DBL_EPSILON / 2.0)
 
 typedef struct {
     double x;
     double y;
 } Point;
 
-int orientation(Point p, Point q, Point r) {
-    double val = (q.y - p.y) * (r.x - q.x) - (q.x - p.x) * (r.y - q.y);
+// Anel io_uring mínimo, configurado com as chamadas de sistema diretas
+typedef struct {
+    int fd;
+    void *sq_ptr, *cq_ptr;
+    size_t sq_len, cq_len, sqes_len;
+    unsigned *sq_tail, *sq_mask, *sq_array;
+    unsigned *cq_head, *cq_tail, *cq_mask;
+    struct io_uring_sqe *sqes;
+    struct io_uring_cqe *cqes;
+} Ring;
+
+typedef struct SinkBlock {
+    struct SinkBlock *next;
+    size_t len;
+    char data[SINK_BLOCK];
+} SinkBlock;
+
+// Saída assíncrona de um trabalhador: blocos preenchidos pelo trabalhador, escritos por ordem por uma thread
+typedef struct {
+    int fd;
+    SinkBlock *current;                 // Bloco a ser preenchido pelo trabalhador
+    SinkBlock *queue_head, *queue_tail; // Blocos cheios à espera de escrita, por ordem
+    SinkBlock *free_list;               // Blocos já escritos, para reutilizar
+    bool closing;
+    bool use_ring;
+    bool line_chunks;                   // Destino partilhado que não é ficheiro regular: escritas de até PIPE_BUF
+    Ring ring;
+    pthread_t thread;
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+} OutSink;
+
+// Sinal exato do determinante de orientação (produtos separados com fma, soma em expansão
+// não sobreposta com two_sum); só é chamado quando o filtro em double não é conclusivo
+int orientation_exact(Point p, Point q, Point r) {
+    double a[6] = {q.y, -p.y, p.y, -q.x, p.x, -p.x};
+    double b[6] = {r.x, r.x, q.x, r.y, r.y, q.y};
+    double e[12];
+    int m = 0;
+
+    for (int k = 0; k < 12; k++) {
+        double product = a[k / 2] * b[k / 2];
+        double term = (k % 2 == 0) ? product : fma(a[k / 2], b[k / 2], -product);
+        for (int i = 0; i < m; i++) {
+            double s = term + e[i];
+            double bv = s - term;
+            e[i] = (term - (s - bv)) + (e[i] - bv);
+            term = s;
+        }
+        e[m++] = term;
+    }
+
+    for (int i = m - 1; i >= 0; i--) {
+        if (e[i] != 0.0) return (e[i] > 0) ? 1 : 2;
+    }
+    return 0;
+}
 
-    if (val == 0) return 0;
-    return (val > 0) ? 1 : 2;
+int orientation(Point p, Point q, Point r) {
+    double left = (q.y - p.y) * (r.x - q.x);
+    double right = (q.x - p.x) * (r.y - q.y);
+    double val = left - right;
+
+    // Filtro: o sinal em double é garantido fora do limite de erro; caso contrário, aritmética exata
+    double bound = ORIENT_ERRBOUND * (fabs(left) + fabs(right));
+    if (val > bound) return 1;
+    if (-val > bound) return 2;
+    return orientation_exact(p, q, r);
 }
 
 bool onSegment(Point p, Point q, Point r) {
     if (q.x <= fmax(p.x, r.x) && q.x >= fmin(p.x, r.x) &&
-        q.y <= fmax(p.y, r.y) && q.y >= fmin(p.x, r.x))
+        q.y <= fmax(p.y, r.y) && q.y >= fmin(p.y, r.y))
         return true;
 
     return false;
@@ -71,10 +149,545 @@ bool isInsidePolygon(Point polygon[], int n, Point p) {
     return count & 1;
 }
 
+/**
+ * @brief Writes v with six decimal places, rounded exactly like printf("%.6f").
+ *
+ * The product v * 1e6 is split with fma into its rounded value and exact residual, so the
+ * rounding decision is taken on the exact scaled value instead of the rounded product.
+ *
+ * @param out Output buffer (at least 32 bytes).
+ * @param v Value to format.
+ * @return Number of characters written.
+ */
+int format_fixed6(char *out, double v) {
+    if (!(fabs(v) < 1e9)) return sprintf(out, "%.6f", v);
+
+    char *p = out;
+    if (signbit(v)) {
+        *p++ = '-';
+        v = -v;
+    }
+    double scaled = v * 1e6;
+    double residual = fma(v, 1e6, -scaled);
+    double k = floor(scaled);
+    double d = (scaled - k) - 0.5;
+    // Acima de meio (ou exatamente meio com resíduo positivo, ou empate exato com k ímpar): arredonda para cima
+    if (d > 0 || (d == 0 && (residual > 0 || (residual == 0 && fmod(k, 2.0) != 0)))) k += 1;
+
+    unsigned long long q = (unsigned long long) k;
+    unsigned long long integer = q / 1000000, fraction = q % 1000000;
+    char digits[20];
+    int nd = 0;
+    do {
+        digits[nd++] = (char) ('0' + integer % 10);
+        integer /= 10;
+    } while (integer > 0);
+    while (nd > 0) *p++ = digits[--nd];
+    *p++ = '.';
+    for (int i = 5; i >= 0; i--) {
+        p[i] = (char) ('0' + fraction % 10);
+        fraction /= 10;
+    }
+    return (int) (p + 6 - out);
+}
+
+/**
+ * @brief Sets up an io_uring instance through the raw system calls (no liburing).
+ * @param ring Ring to fill.
+ * @param entries Number of submission entries.
+ * @return true on success; false if io_uring is unavailable or lacks current-position writes.
+ */
+bool ring_setup(Ring *ring, unsigned entries) {
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    ring->fd = (int) syscall(__NR_io_uring_setup, entries, &params);
+    if (ring->fd < 0) return false;
+    if (!(params.features & IORING_FEAT_RW_CUR_POS)) {
+        close(ring->fd);
+        return false;
+    }
+
+    ring->sq_len = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    ring->cq_len = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        if (ring->cq_len > ring->sq_len) ring->sq_len = ring->cq_len;
+        ring->cq_len = ring->sq_len;
+    }
+    ring->sqes_len = params.sq_entries * sizeof(struct io_uring_sqe);
+
+    ring->sq_ptr = mmap(NULL, ring->sq_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd,
+                        IORING_OFF_SQ_RING);
+    ring->cq_ptr = (params.features & IORING_FEAT_SINGLE_MMAP) ? ring->sq_ptr :
+                   mmap(NULL, ring->cq_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd,
+                        IORING_OFF_CQ_RING);
+    ring->sqes = mmap(NULL, ring->sqes_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd,
+                      IORING_OFF_SQES);
+    if (ring->sq_ptr == MAP_FAILED || ring->cq_ptr == MAP_FAILED || ring->sqes == MAP_FAILED) {
+        close(ring->fd);
+        return false;
+    }
+
+    char *sq = ring->sq_ptr, *cq = ring->cq_ptr;
+    ring->sq_tail = (unsigned *) (sq + params.sq_off.tail);
+    ring->sq_mask = (unsigned *) (sq + params.sq_off.ring_mask);
+    ring->sq_array = (unsigned *) (sq + params.sq_off.array);
+    ring->cq_head = (unsigned *) (cq + params.cq_off.head);
+    ring->cq_tail = (unsigned *) (cq + params.cq_off.tail);
+    ring->cq_mask = (unsigned *) (cq + params.cq_off.ring_mask);
+    ring->cqes = (struct io_uring_cqe *) (cq + params.cq_off.cqes);
+    return true;
+}
+
+void ring_close(Ring *ring) {
+    munmap(ring->sqes, ring->sqes_len);
+    if (ring->cq_ptr != ring->sq_ptr) munmap(ring->cq_ptr, ring->cq_len);
+    munmap(ring->sq_ptr, ring->sq_len);
+    close(ring->fd);
+}
+
+/**
+ * @brief Submits one IORING_OP_WRITEV at the current file position and waits for its completion.
+ * @param ring Ring set up by ring_setup.
+ * @param fd Destination descriptor.
+ * @param iov Buffers to write.
+ * @param iovcnt Number of buffers.
+ * @return Bytes written, or -errno.
+ */
+ssize_t ring_writev(Ring *ring, int fd, const struct iovec *iov, int iovcnt) {
+    unsigned tail = *ring->sq_tail;
+    unsigned index = tail & *ring->sq_mask;
+    struct io_uring_sqe *sqe = &ring->sqes[index];
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = IORING_OP_WRITEV;
+    sqe->fd = fd;
+    sqe->addr = (uint64_t) (uintptr_t) iov;
+    sqe->len = (unsigned) iovcnt;
+    sqe->off = (uint64_t) -1; // Posição atual do ficheiro, como write()
+    ring->sq_array[index] = index;
+    __atomic_store_n(ring->sq_tail, tail + 1, __ATOMIC_RELEASE);
+
+    int submitted;
+    do {
+        submitted = (int) syscall(__NR_io_uring_enter, ring->fd, 1, 1, IORING_ENTER_GETEVENTS, NULL, 0);
+    } while (submitted < 0 && errno == EINTR);
+    if (submitted < 0) return -errno;
+
+    unsigned head = *ring->cq_head;
+    while (head == __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE)) {
+        if (syscall(__NR_io_uring_enter, ring->fd, 0, 1, IORING_ENTER_GETEVENTS, NULL, 0) < 0 && errno != EINTR)
+            return -errno;
+    }
+    ssize_t result = ring->cqes[head & *ring->cq_mask].res;
+    __atomic_store_n(ring->cq_head, head + 1, __ATOMIC_RELEASE);
+    return result;
+}
+
+/**
+ * @brief Writes the whole iovec array, resuming after short writes; io_uring first, writev as fallback.
+ * @param sink Output sink.
+ * @param iov Buffers to write (modified as they are consumed).
+ * @param iovcnt Number of buffers.
+ */
+void sink_write_all(OutSink *sink, struct iovec *iov, int iovcnt) {
+    while (iovcnt > 0) {
+        ssize_t written;
+        if (sink->use_ring) {
+            written = ring_writev(&sink->ring, sink->fd, iov, iovcnt);
+            if (written < 0 && written != -EINTR && written != -EAGAIN) {
+                // O kernel recusou a operação: o resto da saída segue por writev
+                sink->use_ring = false;
+                continue;
+            }
+        } else {
+            written = writev(sink->fd, iov, iovcnt);
+            if (written < 0 && errno != EINTR && errno != EAGAIN) return;
+        }
+        if (written < 0) continue;
+
+        while (iovcnt > 0 && (size_t) written >= iov->iov_len) {
+            written -= iov->iov_len;
+            iov++;
+            iovcnt--;
+        }
+        if (iovcnt > 0) {
+            iov->iov_base = (char *) iov->iov_base + written;
+            iov->iov_len -= written;
+        }
+    }
+}
+
+/**
+ * @brief Writes a block in pieces of at most PIPE_BUF bytes, each ending at a line break.
+ *
+ * Several processes share the same pipe or terminal; a pipe write of at most PIPE_BUF bytes is atomic,
+ * so whole lines of different children never get mixed.
+ *
+ * @param sink Output sink.
+ * @param data Whole lines to write.
+ * @param len Number of bytes.
+ */
+void sink_write_lines(OutSink *sink, char *data, size_t len) {
+    while (len > 0) {
+        size_t chunk = len;
+        if (chunk > PIPE_BUF) {
+            chunk = PIPE_BUF;
+            while (chunk > 0 && data[chunk - 1] != '\n') chunk--;
+            if (chunk == 0) chunk = PIPE_BUF;
+        }
+        struct iovec iov = {data, chunk};
+        sink_write_all(sink, &iov, 1);
+        data += chunk;
+        len -= chunk;
+    }
+}
+
+// Thread de escrita: esvazia a fila de blocos cheios, por ordem, em lotes de até SINK_BATCH blocos
+void *sink_thread(void *arg) {
+    OutSink *sink = (OutSink *) arg;
+    struct iovec iov[SINK_BATCH];
+
+    pthread_mutex_lock(&sink->mutex);
+    for (;;) {
+        while (sink->queue_head == NULL && !sink->closing) pthread_cond_wait(&sink->cond, &sink->mutex);
+        if (sink->queue_head == NULL) break;
+        SinkBlock *batch = sink->queue_head;
+        sink->queue_head = sink->queue_tail = NULL;
+        pthread_mutex_unlock(&sink->mutex);
+
+        SinkBlock *block = batch, *last = batch;
+        for (; sink->line_chunks && block != NULL; block = block->next) {
+            sink_write_lines(sink, block->data, block->len);
+            last = block;
+        }
+        while (block != NULL) {
+            int count = 0;
+            for (; block != NULL && count < SINK_BATCH; block = block->next) {
+                iov[count].iov_base = block->data;
+                iov[count].iov_len = block->len;
+                count++;
+                last = block;
+            }
+            sink_write_all(sink, iov, count);
+        }
+
+        pthread_mutex_lock(&sink->mutex);
+        last->next = sink->free_list;
+        sink->free_list = batch;
+        pthread_cond_broadcast(&sink->cond);
+    }
+    pthread_mutex_unlock(&sink->mutex);
+    return NULL;
+}
+
+/**
+ * @brief Opens an asynchronous output sink on fd, with its own writer thread.
+ * @param sink Sink to initialize.
+ * @param fd Destination descriptor (usually STDOUT_FILENO).
+ * @return true on success, else false.
+ */
+bool sink_open(OutSink *sink, int fd) {
+    memset(sink, 0, sizeof(*sink));
+    sink->fd = fd;
+    // Blocos grandes só num ficheiro regular; pipes e terminais recebem linhas inteiras em escritas atómicas
+    struct stat st;
+    sink->line_chunks = fstat(fd, &st) < 0 || !S_ISREG(st.st_mode);
+    sink->current = malloc(sizeof(SinkBlock));
+    if (sink->current == NULL) return false;
+    sink->current->len = 0;
+    sink->current->next = NULL;
+    sink->use_ring = ring_setup(&sink->ring, 8);
+    pthread_mutex_init(&sink->mutex, NULL);
+    pthread_cond_init(&sink->cond, NULL);
+    if (pthread_create(&sink->thread, NULL, sink_thread, sink) != 0) {
+        if (sink->use_ring) ring_close(&sink->ring);
+        free(sink->current);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Returns room for at least len bytes in the current block, queueing the block if it is full.
+ *
+ * Full blocks go to the writer thread and a free (or new) block takes their place, so the
+ * worker never waits for the terminal or the disk; it only waits if memory runs out.
+ *
+ * @param sink Output sink.
+ * @param len Bytes about to be written (at most SINK_BLOCK).
+ * @return Where to write; confirm with sink_commit.
+ */
+char *sink_reserve(OutSink *sink, size_t len) {
+    if (sink->current->len + len > SINK_BLOCK) {
+        pthread_mutex_lock(&sink->mutex);
+        if (sink->queue_tail != NULL)
+            sink->queue_tail->next = sink->current;
+        else
+            sink->queue_head = sink->current;
+        sink->queue_tail = sink->current;
+        pthread_cond_broadcast(&sink->cond);
+
+        SinkBlock *block = sink->free_list;
+        if (block != NULL) sink->free_list = block->next;
+        pthread_mutex_unlock(&sink->mutex);
+
+        if (block == NULL) block = malloc(sizeof(SinkBlock));
+        if (block == NULL) {
+            pthread_mutex_lock(&sink->mutex);
+            while (sink->free_list == NULL) pthread_cond_wait(&sink->cond, &sink->mutex);
+            block = sink->free_list;
+            sink->free_list = block->next;
+            pthread_mutex_unlock(&sink->mutex);
+        }
+        block->len = 0;
+        block->next = NULL;
+        sink->current = block;
+    }
+    return sink->current->data + sink->current->len;
+}
+
+void sink_commit(OutSink *sink, size_t len) {
+    sink->current->len += len;
+}
+
+/**
+ * @brief Queues the last block, waits for the writer thread to drain everything and frees the sink.
+ * @param sink Output sink.
+ */
+void sink_close(OutSink *sink) {
+    pthread_mutex_lock(&sink->mutex);
+    if (sink->current->len > 0) {
+        if (sink->queue_tail != NULL)
+            sink->queue_tail->next = sink->current;
+        else
+            sink->queue_head = sink->current;
+        sink->queue_tail = sink->current;
+    } else {
+        sink->current->next = sink->free_list;
+        sink->free_list = sink->current;
+    }
+    sink->current = NULL;
+    sink->closing = true;
+    pthread_cond_broadcast(&sink->cond);
+    pthread_mutex_unlock(&sink->mutex);
+    pthread_join(sink->thread, NULL);
+
+    while (sink->free_list != NULL) {
+        SinkBlock *next = sink->free_list->next;
+        free(sink->free_list);
+        sink->free_list = next;
+    }
+    if (sink->use_ring) ring_close(&sink->ring);
+    pthread_mutex_destroy(&sink->mutex);
+    pthread_cond_destroy(&sink->cond);
+}
+
+/**
+ * @brief Appends the verbose line "<pid>;<x>;<y>" of an inside point to the sink.
+ * @param sink Output sink.
+ * @param prefix "<pid>;" of the worker, formatted once.
+ * @param prefix_len Length of prefix.
+ * @param p Point inside the polygon.
+ */
+void sink_point(OutSink *sink, const char *prefix, int prefix_len, Point p) {
+    char *start = sink_reserve(sink, prefix_len + 80);
+    char *out = start;
+    memcpy(out, prefix, prefix_len);
+    out += prefix_len;
+    out += format_fixed6(out, p.x);
+    *out++ = ';';
+    out += format_fixed6(out, p.y);
+    *out++ = '\n';
+    sink_commit(sink, out - start);
+}
+
+
+/**
+ * @brief splitmix64 output function for the state seed + (index + 1) * golden ratio.
+ * @param seed Seed of the stream.
+ * @param index Position in the stream.
+ * @return 64 random bits; any position can be computed directly (counter-based).
+ */
+uint64_t splitmix64_at(uint64_t seed, uint64_t index) {
+    uint64_t z = seed + (index + 1) * 0x9E3779B97F4A7C15ULL;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+/**
+ * @brief Returns sample number k of a lease stream, uniform in [-1, 1] x [-1, 1].
+ * @param seed Seed of the job.
+ * @param k Global index of the sample.
+ * @return The sample; the same (seed, k) always gives the same point.
+ */
+Point lease_sample(uint64_t seed, uint64_t k) {
+    Point p;
+    p.x = (double) (splitmix64_at(seed, 2 * k) >> 11) * 0x1.0p-53 * 2.0 - 1.0;
+    p.y = (double) (splitmix64_at(seed, 2 * k + 1) >> 11) * 0x1.0p-53 * 2.0 - 1.0;
+    return p;
+}
+
+/**
+ * @brief FNV-1a hash of the polygon vertices, used to check the polygon sent to the workers.
+ * @param polygon Polygon vertices.
+ * @param n Number of vertices.
+ * @return 64-bit hash.
+ */
+uint64_t polygon_hash(Point polygon[], int n) {
+    uint64_t h = 0xcbf29ce484222325ULL;
+    const unsigned char *bytes = (const unsigned char *) polygon;
+    for (size_t i = 0; i < n * sizeof(Point); i++) {
+        h ^= bytes[i];
+        h *= 0x100000001b3ULL;
+    }
+    return h;
+}
+
+/**
+ * @brief Connects to a TCP coordinator given as host:port.
+ * @param endpoint Address of the coordinator, e.g. "127.0.0.1:5000".
+ * @return Connected socket, or -1 on error.
+ */
+int connect_tcp(const char *endpoint) {
+    char host[256];
+    const char *sep = strrchr(endpoint, ':');
+    if (sep == NULL || sep - endpoint >= (long) sizeof(host)) {
+        fprintf(stderr, "Endereço inválido: %s (esperado host:porta)\n", endpoint);
+        return -1;
+    }
+    memcpy(host, endpoint, sep - endpoint);
+    host[sep - endpoint] = '\0';
+
+    struct addrinfo hints, *res;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    int err = getaddrinfo(host, sep + 1, &hints, &res);
+    if (err != 0) {
+        fprintf(stderr, "Erro ao resolver %s: %s\n", host, gai_strerror(err));
+        return -1;
+    }
+
+    int sock = -1;
+    for (struct addrinfo *ai = res; ai != NULL; ai = ai->ai_next) {
+        sock = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+        if (sock < 0) continue;
+        if (connect(sock, ai->ai_addr, ai->ai_addrlen) == 0) break;
+        close(sock);
+        sock = -1;
+    }
+    freeaddrinfo(res);
+    if (sock < 0) perror("Erro ao conectar ao coordenador");
+    return sock;
+}
+
+/**
+ * @brief TCP worker: receives the polygon, then pulls chunk leases and reports the counts of each one until told to stop.
+ * @param endpoint Address of the coordinator (host:port).
+ * @return EXIT_SUCCESS or EXIT_FAILURE.
+ */
+int run_tcp_worker(const char *endpoint) {
+    int sock = connect_tcp(endpoint);
+    if (sock < 0) return EXIT_FAILURE;
+
+    FILE *in = fdopen(dup(sock), "r");
+    if (in == NULL) {
+        perror("Erro ao abrir o socket para leitura");
+        close(sock);
+        return EXIT_FAILURE;
+    }
+
+    char line[256];
+    int n;
+    unsigned long long hash;
+    if (fgets(line, sizeof(line), in) == NULL || sscanf(line, "POLIGONO %d %llu", &n, &hash) != 2 || n < 3) {
+        fprintf(stderr, "Mensagem inválida do coordenador\n");
+        fclose(in);
+        close(sock);
+        return EXIT_FAILURE;
+    }
+
+    Point *polygon = malloc(n * sizeof(Point));
+    if (polygon == NULL) {
+        perror("Erro ao alocar memória para o polígono");
+        fclose(in);
+        close(sock);
+        return EXIT_FAILURE;
+    }
+    int received = 0;
+    while (received < n && fgets(line, sizeof(line), in) != NULL) {
+        if (sscanf(line, "%lf %lf", &polygon[received].x, &polygon[received].y) == 2) received++;
+    }
+    if (received != n || polygon_hash(polygon, n) != hash) {
+        fprintf(stderr, "Polígono recebido não corresponde ao hash do coordenador\n");
+        free(polygon);
+        fclose(in);
+        close(sock);
+        return EXIT_FAILURE;
+    }
+
+    // Cada resposta com as contagens parciais de um bloco serve de pedido do bloco seguinte
+    int status = EXIT_FAILURE;
+    while (fgets(line, sizeof(line), in) != NULL) {
+        if (strncmp(line, "FIM", 3) == 0) {
+            status = EXIT_SUCCESS;
+            break;
+        }
+        unsigned long long seed;
+        long long start, count;
+        if (sscanf(line, "LEASE %llu %lld %lld", &seed, &start, &count) != 3) {
+            fprintf(stderr, "Lease inválido do coordenador\n");
+            break;
+        }
+
+        // As amostras são geradas localmente a partir da semente e do índice: não viajam pela rede
+        long long inside = 0;
+        for (long long k = start; k < start + count; k++) {
+            if (isInsidePolygon(polygon, n, lease_sample(seed, k))) inside++;
+        }
+
+        char output[128];
+        int len = snprintf(output, sizeof(output), "%d;%lld;%lld\n", getpid(), count, inside);
+        if (write(sock, output, len) != len) {
+            perror("Erro ao escrever no socket");
+            break;
+        }
+    }
+
+    free(polygon);
+    fclose(in);
+    close(sock);
+    return status;
+}
 
 int main(int argc, char *argv[]) {
+    // Modo distribuído: reqEcliente --tcp <host:porta> <num_trabalhadores>
+    if (argc == 4 && strcmp(argv[1], "--tcp") == 0) {
+        int num_trabalhadores = atoi(argv[3]);
+        if (num_trabalhadores <= 0) {
+            char error[] = "Erro: Número de trabalhadores deve ser maior que 0.\n";
+            write(STDERR_FILENO, error, strlen(error));
+            exit(EXIT_FAILURE);
+        }
+        for (int i = 0; i < num_trabalhadores; i++) {
+            pid_t pid = fork();
+            if (pid == 0) {
+                exit(run_tcp_worker(argv[2]));
+            } else if (pid < 0) {
+                perror("Erro ao fazer fork");
+                exit(EXIT_FAILURE);
+            }
+        }
+        int status, falhas = 0;
+        while (wait(&status) > 0) {
+            if (!WIFEXITED(status) || WEXITSTATUS(status) != EXIT_SUCCESS) falhas++;
+        }
+        exit(falhas == 0 ? EXIT_SUCCESS : EXIT_FAILURE);
+    }
+
     if (argc != 5) {
-        char usage[] = "Uso: <arquivo_do_poligono> <num_processos_filho> <num_pontos_aleatorios> <modo>\n";
+        char usage[] = "Uso: <arquivo_do_poligono> <num_processos_filho> <num_pontos_aleatorios> <modo>\n"
+                       "     --tcp <host:porta> <num_trabalhadores>\n";
         write(STDERR_FILENO, usage, strlen(usage));
         exit(EXIT_FAILURE);
     }
@@ -105,11 +718,18 @@ int main(int argc, char *argv[]) {
     int capacity = 100;
     int n = 0;
     char buffer[128];
+    size_t pending = 0;
     ssize_t bytesRead;
     char *line, *saveptr;
 
-    while ((bytesRead = read(arquivo, buffer, sizeof(buffer) - 1)) > 0) {
-        buffer[bytesRead] = '\0';
+    // Uma linha partida entre duas leituras fica no início do buffer e é completada pela leitura seguinte
+    while ((bytesRead = read(arquivo, buffer + pending, sizeof(buffer) - 1 - pending)) >= 0) {
+        size_t len = pending + bytesRead;
+        buffer[len] = '\0';
+        char *cut = bytesRead > 0 ? strrchr(buffer, '\n') : NULL;
+        size_t used = cut != NULL ? (size_t) (cut - buffer) + 1 : len;
+        char saved = buffer[used];
+        buffer[used] = '\0';
         line = strtok_r(buffer, "\n", &saveptr);
         while (line != NULL) {
             if (sscanf(line, "%lf %lf", &polygon[n].x, &polygon[n].y) == 2) {
@@ -126,6 +746,10 @@ int main(int argc, char *argv[]) {
             }
             line = strtok_r(NULL, "\n", &saveptr);
         }
+        if (bytesRead == 0) break;
+        buffer[used] = saved;
+        pending = len - used;
+        memmove(buffer, buffer + used, pending);
     }
 
     close(arquivo);
@@ -158,16 +782,20 @@ int main(int argc, char *argv[]) {
             int pontos_a_processar = pontos_por_filho + (i < pontos_extra ? 1 : 0);
             int pontos_dentro = 0;
 
+            // No modo verboso, as linhas dos pontos seguem por uma saída assíncrona com blocos grandes
+            bool verboso = strcmp(modo, "verboso") == 0;
+            OutSink sink;
+            char prefixo[16];
+            int len_prefixo = snprintf(prefixo, sizeof(prefixo), "%d;", getpid());
+            if (verboso && !sink_open(&sink, STDOUT_FILENO)) verboso = false;
+
             for (int j = i * pontos_por_filho + (i < pontos_extra ? i : pontos_extra); j < i * pontos_por_filho + (i < pontos_extra ? i : pontos_extra) + pontos_a_processar; j++) {
                 if (isInsidePolygon(polygon, n, pontos[j])) {
                     pontos_dentro++;
-                    if (strcmp(modo, "verboso") == 0) {
-                        char output[128];
-                        snprintf(output, sizeof(output), "%d;%6lf;%6lf\n", getpid(), pontos[j].x, pontos[j].y);
-                        write(STDOUT_FILENO, output, strlen(output));
-                    }
+                    if (verboso) sink_point(&sink, prefixo, len_prefixo, pontos[j]);
                 }
             }
+            if (verboso) sink_close(&sink);
 
             int client_sock = socket(AF_UNIX, SOCK_STREAM, 0);
             if (client_sock < 0) {
@@ -1,24 +1,340 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdint.h>
+#include <time.h>
 #include <unistd.h>
 #include <fcntl.h>
 #include <sys/wait.h>
 #include <sys/socket.h>
 #include <sys/un.h>
+#include <netinet/in.h>
+#include <poll.h>
 #include <string.h>
 #include <errno.h>
 
 #define SOCKET_PATH "/tmp/polygon_socket"
 #define BUFFER_SIZE 1024
+#define LEASE_CHUNK 65536
 
 typedef struct {
     double x;
     double y;
 } Point;
 
+typedef struct {
+    long long start;
+    long long count;
+} Lease;
+
+typedef struct {
+    int fd;
+    int pid;
+    char buffer[128];
+    size_t len;
+    Lease lease;
+    long long processed;
+    long long inside;
+    int chunks;
+} LeaseClient;
+
+typedef struct {
+    uint64_t seed;
+    long long num_points;
+    long long chunk;
+    long long next;
+    Lease *requeued;
+    int num_requeued;
+    long long done;
+    long long inside;
+} LeaseJob;
+
+/**
+ * @brief splitmix64 output function for the state seed + (index + 1) * golden ratio.
+ * @param seed Seed of the stream.
+ * @param index Position in the stream.
+ * @return 64 random bits; any position can be computed directly (counter-based).
+ */
+uint64_t splitmix64_at(uint64_t seed, uint64_t index) {
+    uint64_t z = seed + (index + 1) * 0x9E3779B97F4A7C15ULL;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+/**
+ * @brief Returns sample number k of a lease stream, uniform in [-1, 1] x [-1, 1].
+ * @param seed Seed of the job.
+ * @param k Global index of the sample.
+ * @return The sample; the same (seed, k) always gives the same point.
+ */
+Point lease_sample(uint64_t seed, uint64_t k) {
+    Point p;
+    p.x = (double) (splitmix64_at(seed, 2 * k) >> 11) * 0x1.0p-53 * 2.0 - 1.0;
+    p.y = (double) (splitmix64_at(seed, 2 * k + 1) >> 11) * 0x1.0p-53 * 2.0 - 1.0;
+    return p;
+}
+
+/**
+ * @brief FNV-1a hash of the polygon vertices, used to check the polygon sent to the workers.
+ * @param polygon Polygon vertices.
+ * @param n Number of vertices.
+ * @return 64-bit hash.
+ */
+uint64_t polygon_hash(Point polygon[], int n) {
+    uint64_t h = 0xcbf29ce484222325ULL;
+    const unsigned char *bytes = (const unsigned char *) polygon;
+    for (size_t i = 0; i < n * sizeof(Point); i++) {
+        h ^= bytes[i];
+        h *= 0x100000001b3ULL;
+    }
+    return h;
+}
+
+ssize_t writen2(int fd, const void *buffer, size_t n) {
+    size_t left = n;
+    ssize_t written_bytes;
+    const char *ptr = (const char *) buffer;
+
+    while (left > 0) {
+        written_bytes = send(fd, ptr, left, MSG_NOSIGNAL); // Um par que caiu dá EPIPE em vez de SIGPIPE
+        if (written_bytes <= 0) {
+            if (errno == EINTR) continue;
+            perror("Erro ao escrever no socket");
+            return -1;
+        }
+        left -= written_bytes;
+        ptr += written_bytes;
+    }
+    return (n - left);
+}
+
+/**
+ * @brief Sends the polygon to a TCP worker, preceded by its hash.
+ * @param sock Connected worker socket.
+ * @param polygon Polygon vertices.
+ * @param n Number of vertices.
+ * @return 0 on success, -1 on error.
+ */
+int send_polygon(int sock, Point polygon[], int n) {
+    size_t size = 64 + (size_t) n * 64;
+    char *msg = malloc(size);
+    if (msg == NULL) return -1;
+
+    // Cabeçalho com o hash para o trabalhador validar o polígono recebido
+    size_t len = snprintf(msg, size, "POLIGONO %d %llu\n", n, (unsigned long long) polygon_hash(polygon, n));
+    for (int i = 0; i < n; i++) {
+        len += snprintf(msg + len, size - len, "%.17g %.17g\n", polygon[i].x, polygon[i].y);
+    }
+
+    ssize_t sent = writen2(sock, msg, len);
+    free(msg);
+    return sent < 0 ? -1 : 0;
+}
+
+/**
+ * @brief Hands the next chunk of samples to a worker, or tells it the job is over.
+ *
+ * While other leases are still out the job is not over: with nothing left to
+ * hand out the worker is left idle (lease.count == 0, no message), so it can
+ * take a chunk requeued by a worker that dies.
+ *
+ * @param job State of the job.
+ * @param c Worker connection.
+ * @return 0 if the worker got a chunk or was left idle, 1 if it was sent FIM,
+ *         -1 if it could not be reached (its lease goes back to the queue).
+ */
+int lease_next(LeaseJob *job, LeaseClient *c) {
+    char msg[128];
+    int len;
+    if (job->num_requeued > 0) {
+        // Intervalos perdidos por trabalhadores que caíram têm prioridade
+        Lease l = job->requeued[--job->num_requeued];
+        c->lease = l;
+    } else if (job->next < job->num_points) {
+        c->lease.start = job->next;
+        c->lease.count = job->num_points - job->next < job->chunk ? job->num_points - job->next : job->chunk;
+        job->next += c->lease.count;
+    } else {
+        c->lease.count = 0;
+        if (job->done < job->num_points) return 0; // Ainda há blocos fora: o trabalhador espera
+        len = snprintf(msg, sizeof(msg), "FIM\n");
+        writen2(c->fd, msg, len);
+        return 1;
+    }
+    len = snprintf(msg, sizeof(msg), "LEASE %llu %lld %lld\n",
+                   (unsigned long long) job->seed, c->lease.start, c->lease.count);
+    if (writen2(c->fd, msg, len) < 0) {
+        // O trabalhador não recebeu o bloco: volta para a fila
+        job->requeued = realloc(job->requeued, (job->num_requeued + 1) * sizeof(Lease));
+        job->requeued[job->num_requeued++] = c->lease;
+        c->lease.count = 0;
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Coordinator of the TCP distributed mode.
+ *
+ * Workers connect once, receive the polygon and then pull chunk leases: each
+ * partial count they report is answered with the next chunk, until all the
+ * samples are done. Faster workers therefore end up with more chunks.
+ *
+ * @param polygon Polygon vertices.
+ * @param n Number of vertices.
+ * @param port TCP port to listen on.
+ * @param backlog Expected number of workers (listen backlog).
+ * @param num_points Total number of samples of the job.
+ * @param chunk Number of samples per lease.
+ * @param seed Seed of the job.
+ * @return Number of samples inside the polygon, or -1 on error.
+ */
+long long run_tcp_coordinator(Point polygon[], int n, int port, int backlog, long long num_points, long long chunk, uint64_t seed) {
+    int server_sock = socket(AF_INET, SOCK_STREAM, 0);
+    if (server_sock < 0) {
+        perror("Erro ao criar socket TCP do servidor");
+        return -1;
+    }
+    int opt = 1;
+    setsockopt(server_sock, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+
+    struct sockaddr_in server_addr;
+    memset(&server_addr, 0, sizeof(server_addr));
+    server_addr.sin_family = AF_INET;
+    server_addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    server_addr.sin_port = htons(port);
+
+    if (bind(server_sock, (struct sockaddr *) &server_addr, sizeof(server_addr)) < 0 ||
+        listen(server_sock, backlog) < 0) {
+        perror("Erro ao preparar o socket TCP do servidor");
+        close(server_sock);
+        return -1;
+    }
+
+    printf("Coordenador TCP à escuta na porta %d (semente %llu, blocos de %lld amostras)...\n",
+           port, (unsigned long long) seed, chunk);
+    fflush(stdout);
+
+    LeaseJob job = {seed, num_points, chunk, 0, NULL, 0, 0, 0};
+    LeaseClient *clients = NULL;
+    int num_clients = 0, capacity = 0;
+
+    while (job.done < job.num_points) {
+        struct pollfd fds[num_clients + 1];
+        fds[0].fd = server_sock;
+        fds[0].events = POLLIN;
+        for (int i = 0; i < num_clients; i++) {
+            fds[i + 1].fd = clients[i].fd;
+            fds[i + 1].events = POLLIN;
+        }
+        if (poll(fds, num_clients + 1, -1) < 0) {
+            if (errno == EINTR) continue;
+            perror("Erro no poll");
+            break;
+        }
+
+        // Só as ligações já existentes foram vigiadas pelo poll
+        int polled = num_clients;
+
+        // Novo trabalhador: recebe o polígono e o primeiro bloco (ou espera por um bloco devolvido)
+        if (fds[0].revents & POLLIN) {
+            int sock = accept(server_sock, NULL, NULL);
+            if (sock >= 0) {
+                if (num_clients == capacity) {
+                    capacity = capacity ? capacity * 2 : 8;
+                    clients = realloc(clients, capacity * sizeof(LeaseClient));
+                }
+                LeaseClient *c = &clients[num_clients];
+                memset(c, 0, sizeof(*c));
+                c->fd = sock;
+                if (send_polygon(sock, polygon, n) == 0 && lease_next(&job, c) == 0) {
+                    num_clients++;
+                } else {
+                    close(sock);
+                }
+            }
+        }
+
+        for (int i = 0; i < polled; i++) {
+            LeaseClient *c = &clients[i];
+            if (!(fds[i + 1].revents & (POLLIN | POLLHUP | POLLERR))) continue;
+
+            ssize_t r = read(c->fd, c->buffer + c->len, sizeof(c->buffer) - 1 - c->len);
+            if (r <= 0) {
+                // Trabalhador perdido: o seu bloco volta para a fila
+                if (c->lease.count > 0) {
+                    job.requeued = realloc(job.requeued, (job.num_requeued + 1) * sizeof(Lease));
+                    job.requeued[job.num_requeued++] = c->lease;
+                }
+                close(c->fd);
+                c->fd = -1;
+                continue;
+            }
+            c->len += r;
+            c->buffer[c->len] = '\0';
+
+            char *newline;
+            while (c->fd >= 0 && (newline = strchr(c->buffer, '\n')) != NULL) {
+                *newline = '\0';
+                int pid;
+                long long processed, inside;
+                if (sscanf(c->buffer, "%d;%lld;%lld", &pid, &processed, &inside) == 3) {
+                    c->pid = pid;
+                    c->processed += processed;
+                    c->inside += inside;
+                    c->chunks++;
+                    job.done += processed;
+                    job.inside += inside;
+                    c->lease.count = 0;
+                    if (lease_next(&job, c) != 0) {
+                        close(c->fd);
+                        c->fd = -1;
+                    }
+                }
+                c->len -= newline + 1 - c->buffer;
+                memmove(c->buffer, newline + 1, c->len + 1);
+            }
+        }
+
+        // Blocos devolvidos por trabalhadores que caíram vão para os que estão à espera
+        for (int i = 0; i < num_clients && job.num_requeued > 0; i++) {
+            LeaseClient *c = &clients[i];
+            if (c->fd < 0 || c->lease.count > 0) continue;
+            if (lease_next(&job, c) != 0) {
+                close(c->fd);
+                c->fd = -1;
+            }
+        }
+
+        // Fecha as ligações terminadas, guardando o resumo de cada trabalhador
+        for (int i = 0; i < num_clients; i++) {
+            LeaseClient *c = &clients[i];
+            if (c->fd >= 0) continue;
+            if (c->processed > 0) {
+                printf("%d;%lld;%lld (%d blocos)\n", c->pid, c->processed, c->inside, c->chunks);
+            }
+            clients[i--] = clients[--num_clients];
+        }
+    }
+
+    for (int i = 0; i < num_clients; i++) {
+        if (clients[i].fd >= 0) {
+            writen2(clients[i].fd, "FIM\n", 4);
+            close(clients[i].fd);
+        }
+        if (clients[i].processed > 0) {
+            printf("%d;%lld;%lld (%d blocos)\n", clients[i].pid, clients[i].processed, clients[i].inside, clients[i].chunks);
+        }
+    }
+    close(server_sock);
+    free(clients);
+    free(job.requeued);
+    return job.inside;
+}
+
 int main(int argc, char *argv[]) {
-    if (argc != 4) {
-        char usage[] = "Uso: <arquivo_do_poligono> <num_processos_filho> <num_pontos_aleatorios>\n";
+    char usage[] = "Uso: <arquivo_do_poligono> <num_processos_filho> <num_pontos_aleatorios> [--tcp <porta>] [--seed <semente>] [--chunk <amostras_por_bloco>]\n";
+    if (argc < 4) {
         write(STDERR_FILENO, usage, strlen(usage));
         exit(EXIT_FAILURE);
     }
@@ -26,9 +342,26 @@ int main(int argc, char *argv[]) {
     char *poligono = argv[1];
     int num_processos_filho = atoi(argv[2]);
     int num_pontos_aleatorios = atoi(argv[3]);
+    int porta_tcp = 0;
+    long long bloco = LEASE_CHUNK;
+    uint64_t semente = (uint64_t) time(NULL) ^ ((uint64_t) getpid() << 32);
 
-    if (num_processos_filho <= 0 || num_pontos_aleatorios <= 0) {
-        char error[] = "Erro: Números de processos e pontos devem ser maiores que 0.\n";
+    // Opções adicionais
+    for (int a = 4; a < argc; a++) {
+        if (strcmp(argv[a], "--tcp") == 0 && a + 1 < argc) {
+            porta_tcp = atoi(argv[++a]);
+        } else if (strcmp(argv[a], "--seed") == 0 && a + 1 < argc) {
+            semente = strtoull(argv[++a], NULL, 10);
+        } else if (strcmp(argv[a], "--chunk") == 0 && a + 1 < argc) {
+            bloco = atoll(argv[++a]);
+        } else {
+            write(STDERR_FILENO, usage, strlen(usage));
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    if (num_processos_filho <= 0 || num_pontos_aleatorios <= 0 || bloco <= 0) {
+        char error[] = "Erro: Números de processos, pontos e tamanho de bloco devem ser maiores que 0.\n";
         write(STDERR_FILENO, error, strlen(error));
         exit(EXIT_FAILURE);
     }
@@ -48,11 +381,18 @@ int main(int argc, char *argv[]) {
     int capacity = 100;
     int n = 0;
     char buffer[128];
+    size_t pending = 0;
     ssize_t bytesRead;
     char *line, *saveptr;
 
-    while ((bytesRead = read(arquivo, buffer, sizeof(buffer) - 1)) > 0) {
-        buffer[bytesRead] = '\0';
+    // Uma linha partida entre duas leituras fica no início do buffer e é completada pela leitura seguinte
+    while ((bytesRead = read(arquivo, buffer + pending, sizeof(buffer) - 1 - pending)) >= 0) {
+        size_t len = pending + bytesRead;
+        buffer[len] = '\0';
+        char *cut = bytesRead > 0 ? strrchr(buffer, '\n') : NULL;
+        size_t used = cut != NULL ? (size_t) (cut - buffer) + 1 : len;
+        char saved = buffer[used];
+        buffer[used] = '\0';
         line = strtok_r(buffer, "\n", &saveptr);
         while (line != NULL) {
             if (sscanf(line, "%lf %lf", &polygon[n].x, &polygon[n].y) == 2) {
@@ -69,6 +409,10 @@ int main(int argc, char *argv[]) {
             }
             line = strtok_r(NULL, "\n", &saveptr);
         }
+        if (bytesRead == 0) break;
+        buffer[used] = saved;
+        pending = len - used;
+        memmove(buffer, buffer + used, pending);
     }
 
     close(arquivo);
@@ -80,6 +424,17 @@ int main(int argc, char *argv[]) {
         exit(EXIT_FAILURE);
     }
 
+    // Modo distribuído: os trabalhadores remotos recebem o polígono e pedem blocos de amostras
+    if (porta_tcp > 0) {
+        long long dentro = run_tcp_coordinator(polygon, n, porta_tcp, num_processos_filho, num_pontos_aleatorios, bloco, semente);
+        free(polygon);
+        if (dentro < 0) exit(EXIT_FAILURE);
+        double area_of_reference = 4.0;
+        double estimated_area = ((double) dentro / num_pontos_aleatorios) * area_of_reference;
+        printf("Área estimada do polígono: %.6f unidades quadradas\n", estimated_area);
+        exit(EXIT_SUCCESS);
+    }
+
     if (unlink(SOCKET_PATH) == -1 && errno != ENOENT) {
         perror("Erro ao remover socket antigo");
         free(polygon);